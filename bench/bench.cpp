@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "bench.h"
+
+namespace bench {
+
+struct Benchmark {
+	const char* name;
+	BenchmarkFunc func;
+};
+
+static std::vector<Benchmark>& Benchmarks()
+{
+	// Registrars run during static initialization, in no particular order across files
+	static std::vector<Benchmark> benchmarks;
+	return benchmarks;
+}
+
+static double g_minSeconds = 0.5;
+
+Registrar::Registrar(const char* name, BenchmarkFunc func)
+{
+	Benchmarks().push_back({name, func});
+}
+
+double MinSeconds()
+{
+	return g_minSeconds;
+}
+
+double Time(const std::function<void(uint64_t iterations)>& run)
+{
+	uint64_t iterations = 1;
+	double seconds = 0.0;
+	for (;;) {
+		auto start = std::chrono::steady_clock::now();
+		run(iterations);
+		seconds = SecondsSince(start);
+		if (seconds >= g_minSeconds / 3) {
+			break;
+		}
+		// Aim straight for the minimum time once a run is long enough to extrapolate from
+		uint64_t next = seconds > 0.001 ? static_cast<uint64_t>(iterations * (g_minSeconds / 3) / seconds * 1.2) : iterations * 10;
+		iterations = std::max(next, iterations + 1);
+	}
+
+	double best = seconds;
+	for (int i = 0; i < 2; i++) {
+		auto start = std::chrono::steady_clock::now();
+		run(iterations);
+		best = std::min(best, SecondsSince(start));
+	}
+	return best * 1e9 / iterations;
+}
+
+void Report(const std::string& name, double nanoseconds, const std::string& note)
+{
+	printf("  %-44s %12.1f ns/op  %s\n", name.c_str(), nanoseconds, note.c_str());
+	fflush(stdout);
+}
+
+void ReportValue(const std::string& name, double value, const char* unit, const std::string& note)
+{
+	printf("  %-44s %12.1f %-6s %s\n", name.c_str(), value, unit, note.c_str());
+	fflush(stdout);
+}
+
+} // namespace bench
+
+static void Usage(const char* program)
+{
+	printf("Usage: %s [--quick] [--list] [filter ...]\n", program);
+	printf("Runs every benchmark whose name contains one of the filters, or all of them.\n");
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> filters;
+	bool list = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--quick") == 0) {
+			bench::g_minSeconds = 0.1;
+		} else if (strcmp(argv[i], "--list") == 0) {
+			list = true;
+		} else if (strcmp(argv[i], "--help") == 0) {
+			Usage(argv[0]);
+			return 0;
+		} else if (argv[i][0] == '-') {
+			Usage(argv[0]);
+			return 1;
+		} else {
+			filters.push_back(argv[i]);
+		}
+	}
+
+	auto& benchmarks = bench::Benchmarks();
+	std::sort(benchmarks.begin(), benchmarks.end(), [](const bench::Benchmark& a, const bench::Benchmark& b) {
+		return strcmp(a.name, b.name) < 0;
+	});
+
+	if (!list) {
+		printf("discord_bench: %u hardware threads\n", std::thread::hardware_concurrency());
+	}
+	int ran = 0;
+	for (const auto& benchmark : benchmarks) {
+		bool selected = filters.empty() || std::any_of(filters.begin(), filters.end(), [&](const std::string& filter) {
+			return strstr(benchmark.name, filter.c_str()) != nullptr;
+		});
+		if (!selected) {
+			continue;
+		}
+		if (list) {
+			printf("%s\n", benchmark.name);
+			continue;
+		}
+		printf("%s\n", benchmark.name);
+		fflush(stdout);
+		benchmark.func();
+		ran++;
+	}
+
+	if (!list && ran == 0) {
+		printf("No benchmark matches\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef _INCLUDE_BENCH_H
+#define _INCLUDE_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * @brief A minimal benchmark harness, so the benchmarks need nothing beyond DPP and the
+ * extension's own sources.
+ *
+ * Each benchmark is a function registered with BENCHMARK(name). It measures what it wants
+ * with Time() or its own clock and prints lines with Report(). The runner runs every
+ * benchmark whose name contains one of the filters given on the command line.
+ */
+namespace bench {
+
+typedef void (*BenchmarkFunc)();
+
+/**
+ * @brief Registers a benchmark, see BENCHMARK.
+ */
+class Registrar {
+public:
+	Registrar(const char* name, BenchmarkFunc func);
+};
+
+/**
+ * @brief Runs a piece of code for long enough to time it.
+ *
+ * The iteration count grows until one run takes the minimum time. The fastest of three runs
+ * at that count is kept, which filters out most noise from the rest of the machine.
+ *
+ * @param run Runs the code being measured the given number of times.
+ * @return Nanoseconds per iteration.
+ */
+double Time(const std::function<void(uint64_t iterations)>& run);
+
+/**
+ * @brief Prints the time one operation takes.
+ *
+ * @param name Name of the measurement.
+ * @param nanoseconds Nanoseconds per operation.
+ * @param note Extra detail printed after the result.
+ */
+void Report(const std::string& name, double nanoseconds, const std::string& note = "");
+
+/**
+ * @brief Prints any other value, such as a throughput or a size.
+ *
+ * @param name Name of the measurement.
+ * @param value The value.
+ * @param unit Unit printed after the value.
+ * @param note Extra detail printed after the result.
+ */
+void ReportValue(const std::string& name, double value, const char* unit, const std::string& note = "");
+
+/**
+ * @brief Minimum time one run is measured for, shorter with --quick.
+ */
+double MinSeconds();
+
+/**
+ * @brief Seconds elapsed since a steady clock time point.
+ */
+inline double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Keeps the compiler from optimizing away a value that is otherwise unused.
+ */
+template <class T> inline void Keep(const T& value)
+{
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace bench
+
+#define BENCHMARK(name) \
+	static void bench_##name(); \
+	static bench::Registrar registrar_##name(#name, bench_##name); \
+	static void bench_##name()
+
+#endif //_INCLUDE_BENCH_H
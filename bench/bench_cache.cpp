@@ -0,0 +1,179 @@
+#include <atomic>
+#include <cstdio>
+#include <malloc.h>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "bench.h"
+#include "member_cache.h"
+#include "dpp/dpp.h"
+
+namespace {
+
+struct CachedObject : public dpp::managed {
+	CachedObject(dpp::snowflake id) : dpp::managed(id) {}
+};
+
+uint64_t NextRandom(uint64_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+void FreeDeletionQueue()
+{
+	std::lock_guard<std::mutex> lock(dpp::deletion_mutex);
+	for (auto& entry : dpp::deletion_queue) {
+		delete entry.first;
+	}
+	dpp::deletion_queue.clear();
+}
+
+/**
+ * Readers look up random objects while writers replace random objects, as event handlers and
+ * REST callbacks read the user, guild and role caches while the gateway thread updates them.
+ */
+template <class Cache> void Contention(const char* name, int readers, int writers)
+{
+	const uint64_t objects = 100000;
+
+	Cache cache;
+	for (uint64_t id = 1; id <= objects; id++) {
+		cache.store(new CachedObject(id));
+	}
+
+	// Runs for a fixed time rather than a fixed number of writes, as writers may starve
+	std::atomic<bool> go{false};
+	std::atomic<bool> stop{false};
+	std::atomic<uint64_t> finds{0};
+	std::atomic<uint64_t> stores{0};
+	std::vector<std::thread> threads;
+	for (int t = 0; t < readers + writers; t++) {
+		threads.emplace_back([&, t] {
+			bool writer = t >= readers;
+			uint64_t state = 0x9E3779B97F4A7C15ULL + t, count = 0;
+			while (!go.load(std::memory_order_acquire)) {
+				std::this_thread::yield();
+			}
+			while (!stop.load(std::memory_order_relaxed)) {
+				for (int i = 0; i < 64; i++) {
+					dpp::snowflake id = 1 + NextRandom(state) % objects;
+					if (writer) {
+						cache.store(new CachedObject(id));
+					} else {
+						bench::Keep(cache.find(id));
+					}
+				}
+				count += 64;
+			}
+			(writer ? stores : finds) += count;
+		});
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	go.store(true, std::memory_order_release);
+	std::this_thread::sleep_for(std::chrono::duration<double>(bench::MinSeconds()));
+	stop = true;
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	double seconds = bench::SecondsSince(start);
+
+	char label[96], note[64];
+	snprintf(label, sizeof(label), "%s, %d reader(s), %d writer(s)", name, readers, writers);
+	snprintf(note, sizeof(note), "reads, writes %.2f M/s", stores / seconds / 1e6);
+	bench::ReportValue(label, finds / seconds / 1e6, "M/s", note);
+
+	for (uint64_t id = 1; id <= objects; id++) {
+		delete cache.find(id);
+	}
+	FreeDeletionQueue();
+}
+
+size_t HeapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+	return mallinfo2().uordblks;
+#else
+	return 0;
+#endif
+}
+
+const dpp::snowflake GUILD_ID = 1102283733871329300ULL;
+
+void MakeMember(uint64_t i, dpp::guild_member& member, dpp::user& user)
+{
+	static const char* const clans[] = {"TF", "GG", "EU", "NA", "OPS"};
+
+	user = dpp::user();
+	user.id = 400000000000000000ULL + i * 7919;
+	user.username = "player_" + std::to_string(i);
+	if (i % 3) {
+		user.global_name = "Player " + std::to_string(i);
+	}
+	if (i % 4) {
+		user.avatar = dpp::utility::iconhash(i * 0x9E3779B97F4A7C15ULL, ~i);
+	}
+
+	member = dpp::guild_member();
+	member.guild_id = GUILD_ID;
+	member.user_id = user.id;
+	member.joined_at = 1682942522 + i;
+	if (i % 5 == 0) {
+		member.set_nickname(std::string("[") + clans[i / 5 % 5] + "] nick " + std::to_string(i));
+	}
+	// Most members share one of a handful of role combinations
+	std::vector<dpp::snowflake> roles = {1102289473402146887ULL};
+	for (uint64_t r = 0; r < i % 4; r++) {
+		roles.push_back(1102291007284310026ULL + r * 97);
+	}
+	member.set_roles(roles);
+}
+
+} // namespace
+
+BENCHMARK(cache_contention)
+{
+	// Before: one map and one lock per cache. After: the striped cache DPP's global caches use now.
+	// Writers alone first, as a baseline without contention
+	for (auto threads : {std::make_pair(0, 1), std::make_pair(4, 1), std::make_pair(8, 2)}) {
+		Contention<dpp::cache<CachedObject>>("cache", threads.first, threads.second);
+		Contention<dpp::sharded_cache<CachedObject>>("sharded_cache", threads.first, threads.second);
+	}
+}
+
+BENCHMARK(member_cache_memory)
+{
+	const uint64_t members = 100000;
+	std::vector<std::pair<dpp::guild_member, dpp::user>> source(members);
+	for (uint64_t i = 0; i < members; i++) {
+		MakeMember(i, source[i].first, source[i].second);
+	}
+
+	size_t before = HeapInUse();
+	auto cache = std::make_unique<MemberCache>(members, 3600);
+	auto start = std::chrono::steady_clock::now();
+	for (const auto& entry : source) {
+		cache->Store(entry.first, entry.second);
+	}
+	double storeNs = bench::SecondsSince(start) * 1e9 / members;
+	size_t cacheBytes = HeapInUse() - before;
+
+	if (before) {
+		bench::ReportValue("member cache, heap", static_cast<double>(cacheBytes) / members, "B/mem");
+	}
+	bench::ReportValue("member cache, GetStats().bytes", static_cast<double>(cache->GetStats().bytes) / members, "B/mem");
+	bench::Report("store into member cache", storeNs);
+
+	MemberCache::Entry entry;
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+	double ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			const dpp::user& user = source[NextRandom(state) % members].second;
+			bench::Keep(cache->Find(GUILD_ID, user.id, entry));
+		}
+	});
+	bench::Report("find in member cache", ns, "copies the member and user");
+}
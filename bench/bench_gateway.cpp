@@ -0,0 +1,91 @@
+#include <string>
+#include "bench.h"
+#include "dpp/dpp.h"
+#include "dpp/etf.h"
+#include "dpp/json_scan.h"
+#include "payloads.h"
+
+static void TimeHeaderScan(const char* name, std::string_view frame)
+{
+	bool simd = dpp::json_scan::simd_enabled();
+	for (bool enable : {false, true}) {
+		if (enable && !dpp::json_scan::simd_supported()) {
+			continue;
+		}
+		dpp::json_scan::set_simd(enable);
+		double ns = bench::Time([&](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; i++) {
+				dpp::json_scan::frame_header header;
+				dpp::json_scan::read_frame_header(frame, header);
+				bench::Keep(header);
+			}
+		});
+		bench::Report(std::string(name) + (enable ? ", SSE2" : ", scalar"), ns, std::to_string(frame.size()) + " bytes");
+	}
+	dpp::json_scan::set_simd(simd);
+}
+
+BENCHMARK(gateway_header_scan)
+{
+	// Every JSON frame is scanned for op, s and t before anything else
+	TimeHeaderScan("MESSAGE_CREATE", MESSAGE_CREATE_FRAME);
+	TimeHeaderScan("PRESENCE_UPDATE", PRESENCE_UPDATE_FRAME);
+	TimeHeaderScan("heartbeat ack", HEARTBEAT_ACK_FRAME);
+}
+
+BENCHMARK(gateway_decode)
+{
+	std::string json = MESSAGE_CREATE_FRAME;
+	dpp::etf_parser etf;
+	std::string encoded = etf.build(nlohmann::json::parse(json));
+
+	double ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(nlohmann::json::parse(json));
+		}
+	});
+	double jsonMb = json.size() / ns * 1e3;
+	bench::Report("MESSAGE_CREATE from JSON", ns, std::to_string(json.size()) + " bytes, " + std::to_string(static_cast<int>(jsonMb)) + " MB/s");
+
+	ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(etf.parse(encoded));
+		}
+	});
+	double etfMb = encoded.size() / ns * 1e3;
+	bench::Report("MESSAGE_CREATE from ETF", ns, std::to_string(encoded.size()) + " bytes, " + std::to_string(static_cast<int>(etfMb)) + " MB/s");
+}
+
+BENCHMARK(gateway_dispatch)
+{
+	// A handled event is scanned, then decoded whole; an unhandled one stops after the scan
+	std::string_view frame = MESSAGE_CREATE_FRAME;
+	double ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			dpp::json_scan::frame_header header;
+			dpp::json_scan::read_frame_header(frame, header);
+			nlohmann::json j = nlohmann::json::parse(frame);
+			dpp::message msg;
+			msg.fill_from_json(&j["d"], {dpp::cp_none, dpp::cp_none, dpp::cp_none, dpp::cp_none, dpp::cp_none});
+			bench::Keep(msg);
+		}
+	});
+	bench::Report("MESSAGE_CREATE, scanned and decoded", ns);
+
+	frame = PRESENCE_UPDATE_FRAME;
+	ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			dpp::json_scan::frame_header header;
+			dpp::json_scan::read_frame_header(frame, header);
+			bench::Keep(header);
+		}
+	});
+	bench::Report("PRESENCE_UPDATE, dropped after the scan", ns);
+
+	ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(nlohmann::json::parse(frame));
+		}
+	});
+	bench::Report("PRESENCE_UPDATE, if it were parsed", ns);
+}
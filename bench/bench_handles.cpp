@@ -0,0 +1,59 @@
+#include <vector>
+#include "bench.h"
+#include "embed.h"
+
+static void RegisterEmbedType()
+{
+	if (!g_DiscordEmbedHandler.HandleType) {
+		g_DiscordEmbedHandler.HandleType = handlesys->CreateType("DiscordEmbed", &g_DiscordEmbedHandler, 0, nullptr, nullptr, myself->GetIdentity(), nullptr);
+	}
+}
+
+BENCHMARK(handle_create_free)
+{
+	RegisterEmbedType();
+	HandleSecurity sec(myself->GetIdentity(), myself->GetIdentity());
+
+	double ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			HandleError err;
+			Handle_t handle = g_DiscordEmbedHandler.CreateHandle(new DiscordEmbed(), &sec, &err);
+			handlesys->FreeHandle(handle, &sec);
+		}
+	});
+	bench::Report("create and free an embed handle", ns, "includes new/delete of the embed");
+}
+
+BENCHMARK(handle_read)
+{
+	RegisterEmbedType();
+	HandleSecurity sec(myself->GetIdentity(), myself->GetIdentity());
+
+	// Enough live handles that reads don't all hit the same slot
+	std::vector<Handle_t> handles;
+	for (int i = 0; i < 1024; i++) {
+		HandleError err;
+		handles.push_back(g_DiscordEmbedHandler.CreateHandle(new DiscordEmbed(), &sec, &err));
+	}
+
+	double ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(g_DiscordEmbedHandler.ReadHandle(handles[i & 1023]));
+		}
+	});
+	bench::Report("read a live handle", ns);
+
+	Handle_t freed = handles.back();
+	handles.pop_back();
+	handlesys->FreeHandle(freed, &sec);
+	ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(g_DiscordEmbedHandler.ReadHandle(freed));
+		}
+	});
+	bench::Report("read a freed handle", ns);
+
+	for (Handle_t handle : handles) {
+		handlesys->FreeHandle(handle, &sec);
+	}
+}
@@ -0,0 +1,110 @@
+#include <string>
+#include "bench.h"
+#include "embed.h"
+#include "message.h"
+#include "payloads.h"
+
+// Keeps DPP's global caches out of the measurement
+static const dpp::cache_policy_t NO_CACHE = {dpp::cp_none, dpp::cp_none, dpp::cp_none, dpp::cp_none, dpp::cp_none};
+
+static void FillEmbed(DiscordEmbed& embed)
+{
+	embed.SetTitle("Server status");
+	embed.SetDescription("Back up after the map change. Join with the address below.");
+	embed.SetColor(0x2ECC71);
+	embed.AddField("Map", "pl_upward", true);
+	embed.AddField("Players", "18/24", true);
+	embed.AddField("Address", "203.0.113.24:27015", false);
+	embed.SetFooter("Updated every minute", "https://cdn.discordapp.com/icons/1102283733871329300/a_4f2e6c8b0a1d3f5e7c9b1d3f5a7c9e1b.png");
+}
+
+BENCHMARK(embed_build)
+{
+	double ns = bench::Time([](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			DiscordEmbed embed;
+			FillEmbed(embed);
+			bench::Keep(embed);
+		}
+	});
+	bench::Report("build an embed with 3 fields", ns);
+
+	ns = bench::Time([](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			DiscordEmbed embed;
+			FillEmbed(embed);
+			bench::Keep(embed.GetJson());
+		}
+	});
+	bench::Report("build and serialize it", ns);
+
+	DiscordEmbed embed;
+	FillEmbed(embed);
+	embed.GetJson();
+	ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(embed.GetJson());
+		}
+	});
+	bench::Report("serialize it again, cached", ns);
+}
+
+BENCHMARK(message_send_json)
+{
+	DiscordEmbed embed;
+	FillEmbed(embed);
+	dpp::message msg(1102283734563377162ULL, "Server is back up, 18 players online");
+	msg.set_allowed_mentions(false, false, false, false, {}, {});
+
+	// What every SendMessageEmbed did before embeds were cached
+	double ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			dpp::message withEmbed = msg;
+			withEmbed.add_embed(embed.GetEmbed());
+			bench::Keep(withEmbed.build_json(false));
+		}
+	});
+	bench::Report("message with embed, serialized whole", ns);
+
+	ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(embed.BuildMessageJson(msg, false));
+		}
+	});
+	bench::Report("message with cached embed spliced in", ns);
+
+	ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(msg.build_json(false));
+		}
+	});
+	bench::Report("message without embed", ns);
+}
+
+BENCHMARK(message_receive)
+{
+	nlohmann::json frame = nlohmann::json::parse(MESSAGE_CREATE_FRAME);
+	nlohmann::json& d = frame["d"];
+
+	double ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			dpp::message msg;
+			msg.fill_from_json(&d, NO_CACHE);
+			bench::Keep(msg);
+		}
+	});
+	bench::Report("dpp::message from parsed JSON", ns);
+
+	dpp::message msg;
+	msg.fill_from_json(&d, NO_CACHE);
+	// What OnMessage does before calling the forward: copy into a handle object, then read ids as strings
+	ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			DiscordMessage message(msg);
+			bench::Keep(message.GetMessageId());
+			bench::Keep(message.GetChannelId());
+			bench::Keep(message.GetAuthorId());
+		}
+	});
+	bench::Report("DiscordMessage copy and id getters", ns);
+}
@@ -0,0 +1,79 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "bench.h"
+#include "metrics.h"
+#include "queue.h"
+
+// g_TaskQueue's type: DPP threads push callbacks, the game frame pops and runs them
+typedef ThreadSafeQueue<std::function<void()>> TaskQueue;
+
+BENCHMARK(queue_single_thread)
+{
+	TaskQueue queue;
+	uint64_t sum = 0;
+	double ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			queue.Push([&sum, i] { sum += i; });
+			std::function<void()> task;
+			queue.TryPop(task);
+			task();
+		}
+	});
+	bench::Keep(sum);
+	bench::Report("push, pop and run", ns);
+}
+
+BENCHMARK(queue_contention)
+{
+	const uint64_t tasks = bench::MinSeconds() < 0.5 ? 200000 : 1000000;
+
+	for (int producers : {1, 2, 4, 8}) {
+		TaskQueue queue;
+		MetricHistogram latency;
+		std::atomic<bool> go{false};
+		uint64_t ran = 0;
+
+		std::vector<std::thread> threads;
+		for (int p = 0; p < producers; p++) {
+			threads.emplace_back([&, p] {
+				while (!go.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+				for (uint64_t i = p; i < tasks; i += producers) {
+					uint64_t pushed = MetricsRegistry::Now();
+					queue.Push([&latency, &ran, pushed] {
+						latency.Record(MetricsRegistry::Now() - pushed);
+						ran++;
+					});
+				}
+			});
+		}
+
+		// The consumer drains the queue as fast as it can, as the game frame does once per tick
+		auto start = std::chrono::steady_clock::now();
+		go.store(true, std::memory_order_release);
+		std::function<void()> task;
+		while (ran < tasks) {
+			if (queue.TryPop(task)) {
+				task();
+			} else {
+				std::this_thread::yield();
+			}
+		}
+		double seconds = bench::SecondsSince(start);
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		char note[96];
+		snprintf(note, sizeof(note), "latency p50 %.1f us, p99 %.1f us",
+			latency.Quantile(0.5) * 1e6, latency.Quantile(0.99) * 1e6);
+		bench::ReportValue(std::to_string(producers) + " producer(s), 1 consumer", tasks / seconds / 1e6, "M/s", note);
+	}
+}
@@ -0,0 +1,81 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "dpp/dpp.h"
+
+static std::vector<dpp::snowflake> MakeIds()
+{
+	// Realistic ids: a 2020s timestamp in the top bits and varying worker and sequence bits
+	std::vector<dpp::snowflake> ids;
+	uint64_t id = 1100000000000000000ULL;
+	for (int i = 0; i < 1024; i++) {
+		id += 4194304ULL * 1009 + i * 7;
+		ids.push_back(id);
+	}
+	return ids;
+}
+
+BENCHMARK(snowflake_to_string)
+{
+	std::vector<dpp::snowflake> ids = MakeIds();
+
+	// What the natives do for every id they hand to a plugin
+	double ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(std::to_string(ids[i & 1023]));
+		}
+	});
+	bench::Report("std::to_string", ns);
+
+	ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(ids[i & 1023].str());
+		}
+	});
+	bench::Report("snowflake::str", ns);
+
+	char buffer[32];
+	ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(static_cast<uint64_t>(ids[i & 1023])));
+			bench::Keep(buffer[0]);
+		}
+	});
+	bench::Report("snprintf into a buffer", ns);
+}
+
+BENCHMARK(snowflake_from_string)
+{
+	std::vector<std::string> strings;
+	for (dpp::snowflake id : MakeIds()) {
+		strings.push_back(std::to_string(id));
+	}
+
+	// What the natives do with ids plugins pass in
+	double ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(dpp::snowflake(std::stoull(strings[i & 1023])));
+		}
+	});
+	bench::Report("std::stoull", ns);
+
+	ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(dpp::snowflake(strings[i & 1023]));
+		}
+	});
+	bench::Report("snowflake(string_view)", ns);
+
+	// What DPP does for every id in a gateway payload
+	std::vector<nlohmann::json> objects;
+	for (const std::string& string : strings) {
+		objects.push_back({{"id", string}});
+	}
+	ns = bench::Time([&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			bench::Keep(dpp::snowflake_not_null(&objects[i & 1023], "id"));
+		}
+	});
+	bench::Report("snowflake_not_null from JSON", ns);
+}
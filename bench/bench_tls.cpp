@@ -0,0 +1,198 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include "bench.h"
+#include "dpp/dpp.h"
+
+namespace {
+
+/**
+ * A server on the loopback interface that reads a fixed number of bytes from one client and
+ * then answers with a single byte, so the client can tell everything it queued has arrived.
+ */
+class SinkServer {
+	int m_listener = -1;
+	uint16_t m_port = 0;
+	SSL_CTX* m_context = nullptr;
+	std::thread m_thread;
+
+	static SSL_CTX* MakeContext()
+	{
+		// A throwaway self-signed certificate; ssl_client doesn't verify the peer
+		EVP_PKEY* key = nullptr;
+		EVP_PKEY_CTX* keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+		EVP_PKEY_keygen_init(keyContext);
+		EVP_PKEY_CTX_set_rsa_keygen_bits(keyContext, 2048);
+		EVP_PKEY_keygen(keyContext, &key);
+		EVP_PKEY_CTX_free(keyContext);
+
+		X509* cert = X509_new();
+		ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+		X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+		X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+		X509_set_pubkey(cert, key);
+		X509_NAME* name = X509_get_subject_name(cert);
+		X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+		X509_set_issuer_name(cert, name);
+		X509_sign(cert, key, EVP_sha256());
+
+		SSL_CTX* context = SSL_CTX_new(TLS_server_method());
+		SSL_CTX_use_certificate(context, cert);
+		SSL_CTX_use_PrivateKey(context, key);
+		X509_free(cert);
+		EVP_PKEY_free(key);
+		return context;
+	}
+
+	void Serve(uint64_t expected)
+	{
+		int fd = accept(m_listener, nullptr, nullptr);
+		if (fd < 0) {
+			return;
+		}
+		SSL* ssl = nullptr;
+		if (m_context) {
+			ssl = SSL_new(m_context);
+			SSL_set_fd(ssl, fd);
+			if (SSL_accept(ssl) != 1) {
+				SSL_free(ssl);
+				close(fd);
+				return;
+			}
+		}
+
+		std::unique_ptr<char[]> buffer(new char[256 * 1024]);
+		uint64_t received = 0;
+		while (received < expected) {
+			int r = ssl ? SSL_read(ssl, buffer.get(), 256 * 1024) : static_cast<int>(recv(fd, buffer.get(), 256 * 1024, 0));
+			if (r <= 0) {
+				break;
+			}
+			received += r;
+		}
+		if (ssl) {
+			SSL_write(ssl, "k", 1);
+			SSL_shutdown(ssl);
+			SSL_free(ssl);
+		} else {
+			send(fd, "k", 1, 0);
+		}
+		close(fd);
+	}
+
+public:
+	SinkServer(bool tls)
+	{
+		if (tls) {
+			m_context = MakeContext();
+		}
+		m_listener = socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+		socklen_t length = sizeof(address);
+		getsockname(m_listener, reinterpret_cast<sockaddr*>(&address), &length);
+		m_port = ntohs(address.sin_port);
+		listen(m_listener, 1);
+	}
+
+	~SinkServer()
+	{
+		if (m_thread.joinable()) {
+			// The client never connected, so wake the accept
+			shutdown(m_listener, SHUT_RDWR);
+			m_thread.join();
+		}
+		close(m_listener);
+		if (m_context) {
+			SSL_CTX_free(m_context);
+		}
+	}
+
+	void Start(uint64_t expected)
+	{
+		m_thread = std::thread(&SinkServer::Serve, this, expected);
+	}
+
+	void Wait()
+	{
+		m_thread.join();
+	}
+
+	std::string Port() const { return std::to_string(m_port); }
+};
+
+/**
+ * Queues a payload on an ssl_client in fixed size writes, as websocket and HTTPS sends do, and
+ * runs the client's own loop until the server has read it all.
+ */
+class UploadClient : public dpp::ssl_client {
+public:
+	UploadClient(const std::string& port, bool plaintext) : dpp::ssl_client("127.0.0.1", port, plaintext, false) {}
+
+	void Upload(const std::string& payload, size_t writeSize)
+	{
+		prepare_loop();
+		for (size_t offset = 0; offset < payload.size(); offset += writeSize) {
+			socket_write(std::string_view(payload).substr(offset, writeSize));
+		}
+		read_loop();
+	}
+
+	bool handle_buffer(std::string& buffer) override
+	{
+		return buffer.empty();
+	}
+
+	void log(dpp::loglevel severity, const std::string& msg) const override
+	{
+		fprintf(stderr, "ssl_client: %s\n", msg.c_str());
+	}
+};
+
+void Upload(bool tls, size_t writeSize)
+{
+	const std::string payload(bench::MinSeconds() < 0.5 ? 16 << 20 : 64 << 20, 'x');
+
+	try {
+		SinkServer server(tls);
+		server.Start(payload.size());
+		auto start = std::chrono::steady_clock::now();
+		{
+			UploadClient client(server.Port(), !tls);
+			client.Upload(payload, writeSize);
+		}
+		server.Wait();
+		double seconds = bench::SecondsSince(start);
+
+		char label[64];
+		snprintf(label, sizeof(label), "%s, %zu byte writes", tls ? "TLS" : "plaintext", writeSize);
+		std::string note = std::to_string(payload.size() >> 20) + " MB" + (tls ? ", including the handshake" : "");
+		bench::ReportValue(label, payload.size() / seconds / (1 << 20), "MB/s", note);
+	}
+	catch (const std::exception& e) {
+		fprintf(stderr, "  upload failed: %s\n", e.what());
+	}
+}
+
+} // namespace
+
+BENCHMARK(ssl_client_upload)
+{
+	for (bool tls : {true, false}) {
+		for (size_t writeSize : {static_cast<size_t>(1024), static_cast<size_t>(64 * 1024), static_cast<size_t>(4 << 20)}) {
+			Upload(tls, writeSize);
+		}
+	}
+}
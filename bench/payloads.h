@@ -0,0 +1,17 @@
+#ifndef _INCLUDE_BENCH_PAYLOADS_H
+#define _INCLUDE_BENCH_PAYLOADS_H
+
+/**
+ * @brief Gateway frames as Discord sends them, for the parsing and message benchmarks.
+ */
+
+// A guild message with a reply, a mention and an embed, about 2.6 KB
+inline const char MESSAGE_CREATE_FRAME[] = R"({"t":"MESSAGE_CREATE","s":1842,"op":0,"d":{"type":19,"tts":false,"timestamp":"2024-05-14T18:22:41.512000+00:00","referenced_message":{"type":0,"tts":false,"timestamp":"2024-05-14T18:20:03.101000+00:00","pinned":false,"mentions":[],"mention_roles":[],"mention_everyone":false,"id":"1239986224157032488","flags":0,"embeds":[],"edited_timestamp":null,"content":"is the server back up yet? map changed and everyone got kicked","components":[],"channel_id":"1102283734563377162","author":{"username":"kestrel_77","public_flags":0,"id":"400349316342136832","global_name":"Kestrel","discriminator":"0","clan":null,"avatar_decoration_data":null,"avatar":"9c1d5a1b3e2f4a6b8c0d2e4f6a8b0c2d"},"attachments":[]},"pinned":false,"nonce":"1239986880460210176","message_reference":{"type":0,"message_id":"1239986224157032488","guild_id":"1102283733871329300","channel_id":"1102283734563377162"},"mentions":[{"username":"kestrel_77","public_flags":0,"member":{"roles":["1102289473402146887","1102291007284310026"],"premium_since":null,"pending":false,"nick":null,"mute":false,"joined_at":"2023-05-01T12:02:44.318000+00:00","flags":0,"deaf":false,"communication_disabled_until":null,"avatar":null},"id":"400349316342136832","global_name":"Kestrel","discriminator":"0","clan":null,"avatar_decoration_data":null,"avatar":"9c1d5a1b3e2f4a6b8c0d2e4f6a8b0c2d"}],"mention_roles":[],"mention_everyone":false,"member":{"roles":["1102289473402146887","1102291007284310026","1104437529011687474"],"premium_since":"2023-11-02T09:41:12.004000+00:00","pending":false,"nick":"Server Admin","mute":false,"joined_at":"2023-05-01T11:58:02.771000+00:00","flags":0,"deaf":false,"communication_disabled_until":null,"avatar":null},"id":"1239986880460210176","flags":0,"embeds":[{"type":"rich","title":"Server status","description":"Back up after the map change. Join with the address below.","color":3066993,"fields":[{"name":"Map","value":"pl_upward","inline":true},{"name":"Players","value":"18/24","inline":true},{"name":"Address","value":"203.0.113.24:27015","inline":false}],"footer":{"text":"Updated every minute","icon_url":"https://cdn.discordapp.com/icons/1102283733871329300/a_4f2e6c8b0a1d3f5e7c9b1d3f5a7c9e1b.png"},"timestamp":"2024-05-14T18:22:40.000000+00:00"}],"edited_timestamp":null,"content":"<@400349316342136832> yes, it's back","components":[],"channel_id":"1102283734563377162","author":{"username":"admin.ops","public_flags":64,"id":"283001374810718208","global_name":"Server Admin","discriminator":"0","clan":null,"avatar_decoration_data":null,"avatar":"a_1e3c5a7b9d1f3e5c7a9b1d3f5e7c9a1b"},"attachments":[],"guild_id":"1102283733871329300"}})";
+
+// An event with no handler attached, which the gateway drops without parsing d
+inline const char PRESENCE_UPDATE_FRAME[] = R"({"t":"PRESENCE_UPDATE","s":1843,"op":0,"d":{"user":{"id":"400349316342136832"},"status":"online","guild_id":"1102283733871329300","client_status":{"desktop":"online"},"activities":[{"type":0,"timestamps":{"start":1715710800000},"name":"Team Fortress 2","id":"4a1b2c3d4e5f6a7b","created_at":1715710803112,"application_id":"356875221078245376"}]}})";
+
+// A heartbeat acknowledgement, the smallest and most frequent frame
+inline const char HEARTBEAT_ACK_FRAME[] = R"({"t":null,"s":null,"op":11,"d":null})";
+
+#endif //_INCLUDE_BENCH_PAYLOADS_H
@@ -0,0 +1,90 @@
+#include "smsdk_ext.h"
+
+static IHandleSys g_HandleSys;
+static IExtension g_Extension;
+
+IHandleSys* handlesys = &g_HandleSys;
+IExtension* myself = &g_Extension;
+
+HandleType_t IHandleSys::CreateType(const char* name, IHandleTypeDispatch* dispatch, HandleType_t parent,
+	const TypeAccess* typeAccess, const HandleAccess* handleAccess, IdentityToken_t* ident, HandleError* err)
+{
+	m_types.push_back(dispatch);
+	return static_cast<HandleType_t>(m_types.size() - 1);
+}
+
+Handle_t IHandleSys::CreateHandleEx(HandleType_t type, void* object, const HandleSecurity* sec, const HandleAccess* access, HandleError* err)
+{
+	if (type == 0 || type >= m_types.size()) {
+		*err = HandleError_Parameter;
+		return BAD_HANDLE;
+	}
+
+	uint32_t index = m_freeHead;
+	if (index) {
+		m_freeHead = m_slots[index].nextFree;
+	} else if (m_slots.size() <= 0xFFFF) {
+		index = static_cast<uint32_t>(m_slots.size());
+		m_slots.emplace_back();
+	} else {
+		*err = HandleError_Limit;
+		return BAD_HANDLE;
+	}
+
+	if (++m_serial == 0) {
+		m_serial = 1;
+	}
+	Slot& slot = m_slots[index];
+	slot.object = object;
+	slot.type = type;
+	slot.owner = sec ? sec->pOwner : nullptr;
+	slot.serial = m_serial;
+	slot.used = true;
+	*err = HandleError_None;
+	return (static_cast<Handle_t>(m_serial) << 16) | index;
+}
+
+HandleError IHandleSys::ReadHandle(Handle_t handle, HandleType_t type, const HandleSecurity* sec, void** object)
+{
+	uint32_t index = handle & 0xFFFF;
+	if (index == 0 || index >= m_slots.size()) {
+		return HandleError_Index;
+	}
+	const Slot& slot = m_slots[index];
+	if (!slot.used) {
+		return HandleError_Freed;
+	}
+	if (slot.serial != (handle >> 16)) {
+		return HandleError_Changed;
+	}
+	if (slot.type != type) {
+		return HandleError_Type;
+	}
+	*object = slot.object;
+	return HandleError_None;
+}
+
+HandleError IHandleSys::FreeHandle(Handle_t handle, const HandleSecurity* sec)
+{
+	uint32_t index = handle & 0xFFFF;
+	if (index == 0 || index >= m_slots.size()) {
+		return HandleError_Index;
+	}
+	Slot& slot = m_slots[index];
+	if (!slot.used) {
+		return HandleError_Freed;
+	}
+	if (slot.serial != (handle >> 16)) {
+		return HandleError_Changed;
+	}
+	if (sec && sec->pOwner && slot.owner && sec->pOwner != slot.owner) {
+		return HandleError_Access;
+	}
+
+	slot.used = false;
+	m_types[slot.type]->OnHandleDestroy(slot.type, slot.object);
+	slot.object = nullptr;
+	slot.nextFree = m_freeHead;
+	m_freeHead = index;
+	return HandleError_None;
+}
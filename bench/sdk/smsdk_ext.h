@@ -0,0 +1,118 @@
+#ifndef _INCLUDE_BENCH_SMSDK_EXT_H
+#define _INCLUDE_BENCH_SMSDK_EXT_H
+
+/**
+ * @brief Just enough of the SourceMod SDK to build the extension's handle and embed code into
+ * the benchmarks, without srcds.
+ *
+ * This header shadows SourceMod's smsdk_ext.h for the benchmark target only. The handle
+ * system is a small but working handle table, laid out like SourceMod's (an index and a
+ * serial number in each handle, and a free list), so that creating, reading and freeing
+ * handles costs about what it does on a server.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+typedef int32_t cell_t;
+typedef uint32_t Handle_t;
+typedef uint32_t HandleType_t;
+
+#define BAD_HANDLE 0
+
+enum HandleError
+{
+	HandleError_None = 0,
+	HandleError_Changed,
+	HandleError_Type,
+	HandleError_Freed,
+	HandleError_Index,
+	HandleError_Access,
+	HandleError_Limit,
+	HandleError_Identity,
+	HandleError_Owner,
+	HandleError_Version,
+	HandleError_Parameter,
+	HandleError_NoInherit,
+};
+
+class IdentityToken_t;
+
+struct HandleSecurity
+{
+	HandleSecurity() : pOwner(nullptr), pIdentity(nullptr) {}
+	HandleSecurity(IdentityToken_t* owner, IdentityToken_t* identity) : pOwner(owner), pIdentity(identity) {}
+
+	IdentityToken_t* pOwner;
+	IdentityToken_t* pIdentity;
+};
+
+struct HandleAccess;
+struct TypeAccess;
+
+class IHandleTypeDispatch
+{
+public:
+	virtual ~IHandleTypeDispatch() = default;
+	virtual void OnHandleDestroy(HandleType_t type, void* object) = 0;
+};
+
+/**
+ * @brief Handle table standing in for SourceMod's handle system.
+ */
+class IHandleSys
+{
+public:
+	HandleType_t CreateType(const char* name, IHandleTypeDispatch* dispatch, HandleType_t parent,
+		const TypeAccess* typeAccess, const HandleAccess* handleAccess, IdentityToken_t* ident, HandleError* err);
+	Handle_t CreateHandleEx(HandleType_t type, void* object, const HandleSecurity* sec, const HandleAccess* access, HandleError* err);
+	HandleError ReadHandle(Handle_t handle, HandleType_t type, const HandleSecurity* sec, void** object);
+	HandleError FreeHandle(Handle_t handle, const HandleSecurity* sec);
+
+private:
+	struct Slot {
+		void* object = nullptr;
+		HandleType_t type = 0;
+		IdentityToken_t* owner = nullptr;
+		uint16_t serial = 0;
+		bool used = false;
+		uint32_t nextFree = 0;
+	};
+
+	std::vector<IHandleTypeDispatch*> m_types = {nullptr};
+	// Slot 0 is never used, so that no handle is 0
+	std::vector<Slot> m_slots = {Slot()};
+	uint32_t m_freeHead = 0;
+	uint16_t m_serial = 0;
+};
+
+class IPluginContext
+{
+public:
+	virtual ~IPluginContext() = default;
+	virtual int LocalToString(cell_t local_addr, char** addr) = 0;
+	virtual int StringToLocal(cell_t local_addr, size_t bytes, const char* source) = 0;
+	virtual int ThrowNativeError(const char* msg, ...) = 0;
+	virtual void ReportError(const char* fmt, ...) = 0;
+	virtual IdentityToken_t* GetIdentity() = 0;
+};
+
+typedef cell_t (*SPVM_NATIVE_FUNC)(IPluginContext*, const cell_t*);
+
+struct sp_nativeinfo_t
+{
+	const char* name;
+	SPVM_NATIVE_FUNC func;
+};
+
+class IExtension
+{
+public:
+	IdentityToken_t* GetIdentity() { return reinterpret_cast<IdentityToken_t*>(this); }
+};
+
+extern IHandleSys* handlesys;
+extern IExtension* myself;
+
+#endif //_INCLUDE_BENCH_SMSDK_EXT_H
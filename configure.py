@@ -17,6 +17,10 @@ parser.options.add_argument('--enable-debug', action='store_const', const='1', d
                        help='Enable debugging symbols')
 parser.options.add_argument('--enable-optimize', action='store_const', const='1', dest='opt',
                        help='Enable optimization')
+parser.options.add_argument('--enable-benchmarks', action='store_const', const='1', dest='benchmarks',
+                       help='Also build the discord_bench microbenchmarks (Linux only)')
+parser.options.add_argument('--vcpkg-root', type=str, dest='vcpkg_root', default=None,
+                       help='Path to a vcpkg tree with the static OpenSSL and zlib triplets (Windows only)')
 parser.options.add_argument('--targets', type=str, dest='targets', default=None,
                        help='Override the target architecture (use commas to separate multiple targets).')
 
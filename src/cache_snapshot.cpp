@@ -0,0 +1,396 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
+#include "cache_snapshot.h"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// "DCS1" in native byte order, so a file from a machine of the other endianness is ignored
+static constexpr uint32_t SNAPSHOT_MAGIC = 0x31534344;
+static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+namespace {
+
+class SnapshotWriter {
+public:
+	template<typename T>
+	void Put(T value) {
+		const char* bytes = reinterpret_cast<const char*>(&value);
+		m_buffer.append(bytes, sizeof(T));
+	}
+
+	void PutString(const std::string& value) {
+		Put<uint32_t>(static_cast<uint32_t>(value.size()));
+		m_buffer.append(value);
+	}
+
+	const std::string& Buffer() const { return m_buffer; }
+
+private:
+	std::string m_buffer;
+};
+
+class SnapshotReader {
+public:
+	SnapshotReader(const std::string& buffer) : m_data(buffer.data()), m_left(buffer.size()), m_ok(true) {}
+
+	template<typename T>
+	T Get() {
+		T value{};
+		if (m_left < sizeof(T)) {
+			m_ok = false;
+			return value;
+		}
+		memcpy(&value, m_data, sizeof(T));
+		m_data += sizeof(T);
+		m_left -= sizeof(T);
+		return value;
+	}
+
+	std::string GetString() {
+		uint32_t length = Get<uint32_t>();
+		if (m_left < length) {
+			m_ok = false;
+			return std::string();
+		}
+		std::string value(m_data, length);
+		m_data += length;
+		m_left -= length;
+		return value;
+	}
+
+	bool Ok() const { return m_ok; }
+
+private:
+	const char* m_data;
+	size_t m_left;
+	bool m_ok;
+};
+
+uint32_t ShardOf(dpp::snowflake guild_id, uint32_t maxShards)
+{
+	return maxShards ? static_cast<uint32_t>((static_cast<uint64_t>(guild_id) >> 22) % maxShards) : 0;
+}
+
+void WriteGuild(SnapshotWriter& out, const dpp::guild& guild)
+{
+	out.Put<uint64_t>(guild.id);
+	out.Put<uint64_t>(guild.owner_id);
+	out.Put<uint32_t>(guild.flags);
+	out.Put<uint16_t>(guild.flags_extra);
+	out.Put<uint32_t>(guild.member_count);
+	out.PutString(guild.name);
+	out.PutString(guild.description);
+	bool hasIcon = guild.icon.is_iconhash();
+	out.Put<uint8_t>(hasIcon);
+	if (hasIcon) {
+		out.Put<uint64_t>(guild.icon.as_iconhash().first);
+		out.Put<uint64_t>(guild.icon.as_iconhash().second);
+	}
+
+	std::vector<const dpp::role*> roles;
+	for (dpp::snowflake id : guild.roles) {
+		if (const dpp::role* role = dpp::find_role(id)) {
+			roles.push_back(role);
+		}
+	}
+	out.Put<uint32_t>(static_cast<uint32_t>(roles.size()));
+	for (const dpp::role* role : roles) {
+		out.Put<uint64_t>(role->id);
+		out.PutString(role->name);
+		out.Put<uint32_t>(role->colour);
+		out.Put<uint8_t>(role->position);
+		out.Put<uint64_t>(role->permissions);
+		out.Put<uint8_t>(role->flags);
+	}
+
+	std::vector<const dpp::channel*> channels;
+	for (dpp::snowflake id : guild.channels) {
+		if (const dpp::channel* channel = dpp::find_channel(id)) {
+			channels.push_back(channel);
+		}
+	}
+	out.Put<uint32_t>(static_cast<uint32_t>(channels.size()));
+	for (const dpp::channel* channel : channels) {
+		out.Put<uint64_t>(channel->id);
+		out.Put<uint64_t>(channel->parent_id);
+		out.Put<uint16_t>(channel->flags);
+		out.Put<uint16_t>(channel->position);
+		out.PutString(channel->name);
+		out.PutString(channel->topic);
+		out.Put<uint32_t>(static_cast<uint32_t>(channel->permission_overwrites.size()));
+		for (const auto& overwrite : channel->permission_overwrites) {
+			out.Put<uint64_t>(overwrite.id);
+			out.Put<uint8_t>(overwrite.type);
+			out.Put<uint64_t>(overwrite.allow);
+			out.Put<uint64_t>(overwrite.deny);
+		}
+	}
+}
+
+// Reads one guild into new objects, which the caller owns
+bool ReadGuild(SnapshotReader& in, dpp::guild*& guild, std::vector<dpp::role*>& roles, std::vector<dpp::channel*>& channels)
+{
+	guild = new dpp::guild();
+	guild->id = in.Get<uint64_t>();
+	guild->owner_id = in.Get<uint64_t>();
+	guild->flags = in.Get<uint32_t>();
+	guild->flags_extra = in.Get<uint16_t>();
+	guild->member_count = in.Get<uint32_t>();
+	guild->name = in.GetString();
+	guild->description = in.GetString();
+	if (in.Get<uint8_t>()) {
+		uint64_t first = in.Get<uint64_t>();
+		uint64_t second = in.Get<uint64_t>();
+		guild->icon = dpp::utility::iconhash(first, second);
+	}
+
+	uint32_t roleCount = in.Get<uint32_t>();
+	for (uint32_t i = 0; i < roleCount && in.Ok(); i++) {
+		dpp::role* role = new dpp::role();
+		role->id = in.Get<uint64_t>();
+		role->guild_id = guild->id;
+		role->name = in.GetString();
+		role->colour = in.Get<uint32_t>();
+		role->position = in.Get<uint8_t>();
+		role->permissions = in.Get<uint64_t>();
+		role->flags = in.Get<uint8_t>();
+		roles.push_back(role);
+		guild->roles.push_back(role->id);
+	}
+
+	uint32_t channelCount = in.Get<uint32_t>();
+	for (uint32_t i = 0; i < channelCount && in.Ok(); i++) {
+		dpp::channel* channel = new dpp::channel();
+		channel->id = in.Get<uint64_t>();
+		channel->guild_id = guild->id;
+		channel->parent_id = in.Get<uint64_t>();
+		channel->flags = in.Get<uint16_t>();
+		channel->position = in.Get<uint16_t>();
+		channel->name = in.GetString();
+		channel->topic = in.GetString();
+		uint32_t overwriteCount = in.Get<uint32_t>();
+		for (uint32_t j = 0; j < overwriteCount && in.Ok(); j++) {
+			dpp::permission_overwrite overwrite;
+			overwrite.id = in.Get<uint64_t>();
+			overwrite.type = in.Get<uint8_t>();
+			overwrite.allow = in.Get<uint64_t>();
+			overwrite.deny = in.Get<uint64_t>();
+			channel->permission_overwrites.push_back(overwrite);
+		}
+		channels.push_back(channel);
+		guild->channels.push_back(channel->id);
+	}
+
+	return in.Ok();
+}
+
+void RemoveChannel(dpp::snowflake id)
+{
+	dpp::get_channel_cache()->remove(dpp::find_channel(id));
+}
+
+void RemoveRole(dpp::snowflake id)
+{
+	dpp::get_role_cache()->remove(dpp::find_role(id));
+}
+
+} // namespace
+
+int CacheSnapshot::Save(const std::string& path, uint32_t maxShards, const std::vector<uint32_t>& shards, std::string& error)
+{
+	std::unordered_set<uint32_t> local(shards.begin(), shards.end());
+
+	SnapshotWriter body;
+	uint32_t guilds = 0;
+	// The caches are shared, so other bots' shards may still be changing them
+	std::shared_lock lock(dpp::get_object_mutex());
+	dpp::get_guild_cache()->for_each([&](dpp::guild* guild) {
+		if (guild->is_unavailable() || !local.count(ShardOf(guild->id, maxShards))) {
+			return;
+		}
+		WriteGuild(body, *guild);
+		guilds++;
+	});
+
+	lock.unlock();
+
+	SnapshotWriter header;
+	header.Put<uint32_t>(SNAPSHOT_MAGIC);
+	header.Put<uint32_t>(SNAPSHOT_VERSION);
+	header.Put<int64_t>(time(nullptr));
+	header.Put<uint32_t>(guilds);
+
+	// Written aside and renamed over the old one, which replaces it atomically, so a crash
+	// mid-write never leaves a torn snapshot or none at all
+	std::string temp = path + ".tmp";
+	{
+		std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+		out.write(header.Buffer().data(), header.Buffer().size());
+		out.write(body.Buffer().data(), body.Buffer().size());
+		out.close();
+		if (!out) {
+			std::remove(temp.c_str());
+			error = "could not write " + temp;
+			return -1;
+		}
+	}
+#ifdef _WIN32
+	// rename() refuses to replace an existing file on Windows
+	if (!MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+#else
+	if (std::rename(temp.c_str(), path.c_str()) != 0) {
+#endif
+		std::remove(temp.c_str());
+		error = "could not rename " + temp;
+		return -1;
+	}
+	return static_cast<int>(guilds);
+}
+
+int CacheSnapshot::Load(const std::string& path, time_t maxAge, const dpp::cache_policy_t& policy, std::string& error)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return 0;
+	}
+	std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	SnapshotReader in(buffer);
+	if (in.Get<uint32_t>() != SNAPSHOT_MAGIC || in.Get<uint32_t>() != SNAPSHOT_VERSION) {
+		error = "unknown format";
+		return -1;
+	}
+	time_t saved = static_cast<time_t>(in.Get<int64_t>());
+	if (time(nullptr) - saved > maxAge) {
+		return 0;
+	}
+	// Nothing would ever confirm or replace guilds the cluster doesn't cache
+	if (policy.guild_policy == dpp::cp_none) {
+		return 0;
+	}
+
+	uint32_t guildCount = in.Get<uint32_t>();
+	int loaded = 0;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (uint32_t i = 0; i < guildCount; i++) {
+		dpp::guild* guild = nullptr;
+		std::vector<dpp::role*> roles;
+		std::vector<dpp::channel*> channels;
+		bool ok = ReadGuild(in, guild, roles, channels);
+
+		if (!ok || dpp::find_guild(guild->id)) {
+			delete guild;
+			for (dpp::role* role : roles) {
+				delete role;
+			}
+			for (dpp::channel* channel : channels) {
+				delete channel;
+			}
+			if (!ok) {
+				error = "truncated file";
+				return -1;
+			}
+			continue;
+		}
+
+		StaleGuild& stale = m_stale[guild->id];
+		for (dpp::role* role : roles) {
+			if (policy.role_policy != dpp::cp_none && !dpp::find_role(role->id)) {
+				stale.roles.push_back(role->id);
+				dpp::get_role_cache()->store(role);
+			} else {
+				delete role;
+			}
+		}
+		for (dpp::channel* channel : channels) {
+			if (policy.channel_policy != dpp::cp_none && !dpp::find_channel(channel->id)) {
+				stale.channels.push_back(channel->id);
+				dpp::get_channel_cache()->store(channel);
+			} else {
+				delete channel;
+			}
+		}
+		dpp::get_guild_cache()->store(guild);
+		loaded++;
+	}
+	return loaded;
+}
+
+void CacheSnapshot::OnReady(uint32_t shard, uint32_t maxShards, const std::vector<dpp::snowflake>& guilds)
+{
+	std::unordered_set<dpp::snowflake> present(guilds.begin(), guilds.end());
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto it = m_stale.begin(); it != m_stale.end();) {
+		if (ShardOf(it->first, maxShards) != shard) {
+			++it;
+			continue;
+		}
+
+		// DPP only fills in channels and roles for guilds it hasn't cached yet
+		dpp::get_guild_cache()->remove(dpp::find_guild(it->first));
+
+		if (present.count(it->first)) {
+			++it;
+			continue;
+		}
+		for (dpp::snowflake id : it->second.channels) {
+			RemoveChannel(id);
+		}
+		for (dpp::snowflake id : it->second.roles) {
+			RemoveRole(id);
+		}
+		it = m_stale.erase(it);
+	}
+}
+
+void CacheSnapshot::OnResumed(uint32_t shard, uint32_t maxShards)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto it = m_stale.begin(); it != m_stale.end();) {
+		if (ShardOf(it->first, maxShards) == shard) {
+			it = m_stale.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void CacheSnapshot::OnGuildCreate(const dpp::guild& guild)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto found = m_stale.find(guild.id);
+	if (found == m_stale.end()) {
+		return;
+	}
+
+	std::unordered_set<dpp::snowflake> channels(guild.channels.begin(), guild.channels.end());
+	for (dpp::snowflake id : found->second.channels) {
+		if (!channels.count(id)) {
+			RemoveChannel(id);
+		}
+	}
+	std::unordered_set<dpp::snowflake> roles(guild.roles.begin(), guild.roles.end());
+	for (dpp::snowflake id : found->second.roles) {
+		if (!roles.count(id)) {
+			RemoveRole(id);
+		}
+	}
+	m_stale.erase(found);
+}
+
+size_t CacheSnapshot::StaleCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stale.size();
+}
+
+void CacheSnapshot::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stale.clear();
+}
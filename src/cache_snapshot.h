@@ -0,0 +1,95 @@
+#ifndef _INCLUDE_CACHE_SNAPSHOT_H
+#define _INCLUDE_CACHE_SNAPSHOT_H
+
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "dpp/dpp.h"
+
+/**
+ * @brief Saves guilds, with their channels and roles, to disk and loads them back into
+ * DPP's caches, so that a restarted server has them before the gateway sends them again.
+ *
+ * Loaded guilds are stale until the gateway confirms them. When a shard becomes ready,
+ * its stale guilds leave the guild cache so that GUILD_CREATE rebuilds them in full, and
+ * the channels and roles of guilds the bot is no longer in are removed. GUILD_CREATE
+ * then refreshes the loaded channels and roles in place and removes those that are
+ * gone. A shard that resumes instead replays what it missed, so its guilds are
+ * confirmed as they are.
+ */
+class CacheSnapshot {
+public:
+	/**
+	 * @brief Writes the guilds of some shards to a file.
+	 *
+	 * @param path File to write.
+	 * @param maxShards Total shard count of the bot.
+	 * @param shards Shards whose guilds are saved.
+	 * @param[out] error Reason, on failure.
+	 * @return Number of guilds written, or -1 on failure.
+	 */
+	static int Save(const std::string& path, uint32_t maxShards, const std::vector<uint32_t>& shards, std::string& error);
+
+	/**
+	 * @brief Loads guilds from a file into the caches, marking them stale.
+	 *
+	 * Guilds already cached, e.g. because the extension was reloaded rather than the
+	 * server restarted, are left as they are.
+	 *
+	 * @param path File to read.
+	 * @param maxAge Seconds after which a file is ignored.
+	 * @param policy Cache policy of the cluster, to skip caches it doesn't use.
+	 * @param[out] error Reason, on failure.
+	 * @return Number of guilds loaded, or -1 on failure.
+	 */
+	int Load(const std::string& path, time_t maxAge, const dpp::cache_policy_t& policy, std::string& error);
+
+	/**
+	 * @brief Handles a shard becoming ready.
+	 *
+	 * @param shard Shard ID.
+	 * @param maxShards Total shard count.
+	 * @param guilds Guilds the gateway will send for this shard.
+	 */
+	void OnReady(uint32_t shard, uint32_t maxShards, const std::vector<dpp::snowflake>& guilds);
+
+	/**
+	 * @brief Handles a shard resuming its session.
+	 *
+	 * @param shard Shard ID.
+	 * @param maxShards Total shard count.
+	 */
+	void OnResumed(uint32_t shard, uint32_t maxShards);
+
+	/**
+	 * @brief Handles a guild sent by the gateway, after DPP has cached it.
+	 *
+	 * @param guild The guild.
+	 */
+	void OnGuildCreate(const dpp::guild& guild);
+
+	/**
+	 * @brief Gets the number of loaded guilds not yet confirmed by the gateway.
+	 *
+	 * @return Guild count.
+	 */
+	size_t StaleCount() const;
+
+	/**
+	 * @brief Forgets which guilds are stale.
+	 */
+	void Clear();
+
+private:
+	struct StaleGuild {
+		std::vector<dpp::snowflake> channels;
+		std::vector<dpp::snowflake> roles;
+	};
+
+	mutable std::mutex m_mutex;
+	std::unordered_map<dpp::snowflake, StaleGuild> m_stale;
+};
+
+#endif //_INCLUDE_CACHE_SNAPSHOT_H
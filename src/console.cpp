@@ -0,0 +1,222 @@
+#include "extension.h"
+#include "console.h"
+#include "metrics.h"
+#include "event_trace.h"
+#include "plugin_profiler.h"
+
+DiscordConsole g_DiscordConsole;
+
+void DiscordConsole::Register()
+{
+	rootconsole->AddRootConsoleCommand3("discord", "Discord extension diagnostics", this);
+}
+
+void DiscordConsole::Unregister()
+{
+	rootconsole->RemoveRootConsoleCommand("discord", this);
+}
+
+void DiscordConsole::OnRootConsoleCommand(const char* cmdname, const ICommandArgs* args)
+{
+	if (args->ArgC() >= 3) {
+		const char* command = args->Arg(2);
+		if (strcmp(command, "latency") == 0) {
+			PrintLatency();
+			return;
+		}
+		if (strcmp(command, "cache") == 0) {
+			PrintCache();
+			return;
+		}
+		if (strcmp(command, "stats") == 0) {
+			PrintStats();
+			return;
+		}
+		if (strcmp(command, "trace") == 0) {
+			StartTrace(args);
+			return;
+		}
+		if (strcmp(command, "profile") == 0) {
+			PrintProfile();
+			return;
+		}
+	}
+
+	rootconsole->ConsolePrint("SourceMod Discord Menu:");
+	rootconsole->DrawGenericOption("cache", "Cache sizes, hit rates and garbage collection");
+	rootconsole->DrawGenericOption("latency", "Gateway and REST latency, traffic and event rates per shard");
+	rootconsole->DrawGenericOption("stats", "Event, frame, forward and REST metrics");
+	rootconsole->DrawGenericOption("trace", "Trace events for <seconds> to a Chrome trace file [file]");
+	rootconsole->DrawGenericOption("profile", "Time spent in each plugin's forwards and callbacks");
+}
+
+void DiscordConsole::PrintLatency()
+{
+	const auto& clients = DiscordClient::GetClients();
+	if (clients.empty()) {
+		rootconsole->ConsolePrint("[Discord] No Discord clients");
+		return;
+	}
+
+	double now = dpp::utility::time_f();
+	for (DiscordClient* client : clients) {
+		rootconsole->ConsolePrint("[Discord] Bot \"%s\" (%s): REST ping %.0f ms", client->GetBotName(), client->IsRunning() ? "running" : "stopped", client->GetRestPing() * 1000.0);
+
+		for (uint32_t shard_id : client->GetLocalShards()) {
+			dpp::discord_client* shard = client->GetShard(shard_id);
+			if (!shard) {
+				continue;
+			}
+
+			uint32_t connections = shard->reconnects + shard->resumes;
+			double last = shard->last_dispatch.load();
+			char lastEvent[32] = "never";
+			if (last != 0.0) {
+				snprintf(lastEvent, sizeof(lastEvent), "%.1f s ago", now - last);
+			}
+
+			rootconsole->ConsolePrint("  Shard %u: %s, heartbeat %.0f ms, in %.1f KiB (%.1f KiB decompressed), %u reconnects (%u resumed), last event %s",
+				shard_id,
+				shard->is_connected() ? "ready" : "connecting",
+				shard->websocket_ping * 1000.0,
+				shard->get_bytes_in() / 1024.0,
+				shard->get_decompressed_bytes_in() / 1024.0,
+				connections ? connections - 1 : 0,
+				shard->resumes,
+				lastEvent);
+
+			for (const auto& event : shard->get_event_stats()) {
+				rootconsole->ConsolePrint("    %-32s %8.2f/s %12llu total", event.first.c_str(), event.second.per_second, static_cast<unsigned long long>(event.second.total));
+			}
+		}
+	}
+}
+
+static void PrintCacheLine(const char* name, uint64_t entries, uint64_t bytes, uint64_t finds, uint64_t hits, uint64_t evictions)
+{
+	char hitRate[16] = "-";
+	if (finds) {
+		snprintf(hitRate, sizeof(hitRate), "%.1f%%", 100.0 * hits / finds);
+	}
+	rootconsole->ConsolePrint("  %-10s %10llu %12.1f %12llu %8s %10llu",
+		name,
+		static_cast<unsigned long long>(entries),
+		bytes / 1024.0,
+		static_cast<unsigned long long>(finds),
+		hitRate,
+		static_cast<unsigned long long>(evictions));
+}
+
+void DiscordConsole::PrintCache()
+{
+	static const char* const names[] = {"users", "guilds", "roles", "channels", "emojis"};
+
+	rootconsole->ConsolePrint("[Discord] Cache         Entries          KiB        Finds     Hits  Evictions");
+	for (int cache = 0; cache < static_cast<int>(sizeof(names) / sizeof(names[0])); cache++) {
+		dpp::cache_stats stats;
+		if (GetGlobalCacheStats(cache, stats)) {
+			PrintCacheLine(names[cache], stats.entries, stats.bytes, stats.finds, stats.hits, stats.evictions);
+		}
+	}
+
+	for (DiscordClient* client : DiscordClient::GetClients()) {
+		size_t stale = client->GetStaleGuildCount();
+		if (stale) {
+			rootconsole->ConsolePrint("  %zu guilds of \"%s\" loaded from the snapshot and not yet confirmed by the gateway", stale, client->GetBotName());
+		}
+		if (!client->IsLazyMembers()) {
+			continue;
+		}
+		MemberCache::Stats members = client->GetMemberCacheStats();
+		char name[64];
+		snprintf(name, sizeof(name), "members (\"%s\", %zu max)", client->GetBotName(), client->GetMemberCacheCapacity());
+		rootconsole->ConsolePrint("  %s", name);
+		PrintCacheLine("", members.entries, members.bytes, members.finds, members.hits, members.evictions);
+	}
+
+	dpp::gc_stats gc = dpp::get_gc_stats();
+	rootconsole->ConsolePrint("[Discord] Garbage collection: %llu runs, %.1f ms total, %.1f ms last, %llu deleted, %llu pending",
+		static_cast<unsigned long long>(gc.runs),
+		gc.total_time * 1000.0,
+		gc.last_time * 1000.0,
+		static_cast<unsigned long long>(gc.deleted),
+		static_cast<unsigned long long>(gc.pending));
+}
+
+void DiscordConsole::PrintStats()
+{
+	rootconsole->ConsolePrint("[Discord] Metrics");
+	for (const MetricsRegistry::Metric* metric : g_Metrics.List()) {
+		std::string series = metric->name;
+		if (!metric->labels.empty()) {
+			series += "{" + metric->labels + "}";
+		}
+
+		switch (metric->kind) {
+			case MetricsRegistry::Kind::Counter:
+				rootconsole->ConsolePrint("  %-64s %llu", series.c_str(), static_cast<unsigned long long>(metric->counter.Get()));
+				break;
+			case MetricsRegistry::Kind::Gauge:
+				rootconsole->ConsolePrint("  %-64s %lld", series.c_str(), static_cast<long long>(metric->gauge.Get()));
+				break;
+			case MetricsRegistry::Kind::Histogram: {
+				const MetricHistogram& histogram = *metric->histogram;
+				rootconsole->ConsolePrint("  %-64s %llu, p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms",
+					series.c_str(),
+					static_cast<unsigned long long>(histogram.Count()),
+					histogram.Quantile(0.5) * 1000.0,
+					histogram.Quantile(0.9) * 1000.0,
+					histogram.Quantile(0.99) * 1000.0,
+					histogram.Max() * 1000.0);
+				break;
+			}
+		}
+	}
+}
+
+void DiscordConsole::StartTrace(const ICommandArgs* args)
+{
+	double seconds = args->ArgC() >= 4 ? atof(args->Arg(3)) : 0.0;
+	if (seconds <= 0.0 || seconds > 600.0) {
+		rootconsole->ConsolePrint("[Discord] Usage: sm discord trace <seconds, up to 600> [file, relative to the SourceMod folder]");
+		return;
+	}
+
+	char path[PLATFORM_MAX_PATH];
+	smutils->BuildPath(Path_SM, path, sizeof(path), "%s", args->ArgC() >= 5 ? args->Arg(4) : "logs/discord_trace.json");
+
+	std::string error;
+	if (!g_EventTrace.Start(path, seconds, error)) {
+		rootconsole->ConsolePrint("[Discord] Could not start tracing: %s", error.c_str());
+		return;
+	}
+	rootconsole->ConsolePrint("[Discord] Tracing events for %.0f seconds, to be written to %s", seconds, path);
+}
+
+void DiscordConsole::PrintProfile()
+{
+	const auto& timings = g_PluginProfiler.GetTimings();
+	if (timings.empty()) {
+		rootconsole->ConsolePrint("[Discord] No plugin has been called yet");
+		return;
+	}
+
+	rootconsole->ConsolePrint("[Discord] %-32s %-24s %8s %10s %8s %8s %6s", "Plugin", "Callback", "Calls", "Total ms", "Avg ms", "Max ms", "Slow");
+	for (const auto& timing : timings) {
+		const MetricHistogram& time = *timing.second.time;
+		uint64_t calls = time.Count();
+		rootconsole->ConsolePrint("  %-40s %-24s %8llu %10.1f %8.3f %8.3f %6llu",
+			timing.first.first.c_str(),
+			timing.first.second.c_str(),
+			static_cast<unsigned long long>(calls),
+			time.Sum() * 1000.0,
+			calls ? time.Sum() * 1000.0 / calls : 0.0,
+			time.Max() * 1000.0,
+			static_cast<unsigned long long>(timing.second.overBudget->Get()));
+	}
+
+	double budget = g_PluginProfiler.GetBudget();
+	if (budget > 0.0) {
+		rootconsole->ConsolePrint("[Discord] Calls over %.2f ms are counted as slow and logged", budget * 1000.0);
+	}
+}
@@ -0,0 +1,24 @@
+#ifndef _INCLUDE_DISCORD_CONSOLE_H_
+#define _INCLUDE_DISCORD_CONSOLE_H_
+
+#include "smsdk_ext.h"
+
+// "sm discord <command>" in the server console
+class DiscordConsole : public IRootConsoleCommand
+{
+public:
+	void Register();
+	void Unregister();
+	void OnRootConsoleCommand(const char* cmdname, const ICommandArgs* args) override;
+
+private:
+	void PrintLatency();
+	void PrintCache();
+	void PrintStats();
+	void StartTrace(const ICommandArgs* args);
+	void PrintProfile();
+};
+
+extern DiscordConsole g_DiscordConsole;
+
+#endif // _INCLUDE_DISCORD_CONSOLE_H_
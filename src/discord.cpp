@@ -1,21 +1,86 @@
+#include <fstream>
 #include "extension.h"
+#include "metrics.h"
+#include "event_trace.h"
+#include "plugin_profiler.h"
 #include "types/webhook.h"
 #include "types/channel.h"
 #include "types/embed.h"
 #include "types/message.h"
 #include "types/user.h"
+#include "types/guild.h"
+#include "types/role.h"
 #include "types/interaction.h"
 #include "types/autocomplete_interaction.h"
 
+// REST queues shared by every client created with sharedPool, so several bots don't each spin up their own threads
+static std::unique_ptr<dpp::request_queue> s_sharedRest;
+static std::unique_ptr<dpp::request_queue> s_sharedRawRest;
+static std::mutex s_sharedRestMutex;
+
+// Every client in existence, for the console commands. Only touched on the main thread
+static std::vector<DiscordClient*> s_clients;
+
+static constexpr uint32_t SHARED_REST_THREADS = 4;
+static constexpr uint32_t SHARED_RAW_REST_THREADS = 1;
+
+// Members kept for GetMember when DPP's own member cache is in use, and how long a fetched member is trusted
+static constexpr size_t MEMBER_CACHE_DEFAULT_CAPACITY = 256;
+static constexpr time_t MEMBER_CACHE_MAX_AGE = 600;
+
+// Discord drops a session soon after its connection closes, so older saved sessions aren't worth trying
+static constexpr time_t SESSION_RESUME_MAX_AGE = 300;
+
+// Cached guilds from before a restart are still a better start than nothing, up to a point
+static constexpr time_t CACHE_SNAPSHOT_MAX_AGE = 86400;
+
+// The gateway thread holds DPP's object lock exclusively while it applies an event, which for a large
+// GUILD_CREATE takes long enough to stall a server frame. Cached reads on the game thread never wait
+// for it, and take a busy lock as a cache miss.
+static std::shared_lock<std::shared_mutex> TryLockObjects()
+{
+	return std::shared_lock<std::shared_mutex>(dpp::get_object_mutex(), std::try_to_lock);
+}
+
 // Discord Client Implementation
-DiscordClient::DiscordClient(const char* token) : m_isRunning(false), m_discord_handle(0)
+DiscordClient::DiscordClient(const char* token, bool sharedPool, dpp::websocket_protocol_t protocol, uint32_t shardCount, uint32_t clusterId, uint32_t maxClusters) : m_isRunning(false), m_shardsStarted(false), m_discord_handle(0), m_resumeSessions(true), m_lazyMembers(false), m_members(MEMBER_CACHE_DEFAULT_CAPACITY, MEMBER_CACHE_MAX_AGE), m_cacheSnapshot(true)
+{
+	s_clients.push_back(this);
+
+	// Shards are dealt out round robin, so this client connects the shards where shard_id % maxClusters == clusterId
+	if (!sharedPool) {
+		m_cluster = std::make_unique<dpp::cluster>(token, dpp::i_default_intents | dpp::i_message_content, shardCount, clusterId, maxClusters);
+		m_cluster->set_websocket_protocol(protocol);
+		return;
+	}
+
+	m_cluster = std::make_unique<dpp::cluster>(token, dpp::i_default_intents | dpp::i_message_content, shardCount, clusterId, maxClusters, true, dpp::cache_policy::cpol_default, 0, 0);
+	m_cluster->set_websocket_protocol(protocol);
+
+	std::lock_guard<std::mutex> lock(s_sharedRestMutex);
+	if (!s_sharedRest) {
+		s_sharedRest = std::make_unique<dpp::request_queue>(nullptr, SHARED_REST_THREADS);
+		s_sharedRawRest = std::make_unique<dpp::request_queue>(nullptr, SHARED_RAW_REST_THREADS);
+	}
+	m_cluster->set_request_queues(s_sharedRest.get(), s_sharedRawRest.get());
+}
+
+void DiscordClient::FreeSharedRequestQueues()
 {
-	m_cluster = std::make_unique<dpp::cluster>(token, dpp::i_default_intents | dpp::i_message_content);
+	std::lock_guard<std::mutex> lock(s_sharedRestMutex);
+	s_sharedRest.reset();
+	s_sharedRawRest.reset();
 }
 
 DiscordClient::~DiscordClient()
 {
 	Stop();
+	s_clients.erase(std::remove(s_clients.begin(), s_clients.end(), this), s_clients.end());
+}
+
+const std::vector<DiscordClient*>& DiscordClient::GetClients()
+{
+	return s_clients;
 }
 
 bool DiscordClient::Initialize()
@@ -33,7 +98,15 @@ bool DiscordClient::Initialize()
 void DiscordClient::RunBot()
 {
 	try {
-		m_cluster->start(false);
+		if (m_cacheSnapshot) {
+			LoadCacheSnapshot();
+		}
+		if (m_resumeSessions) {
+			RestoreSessions();
+		}
+		// Shards run on their own threads, so this thread only needs to live until they are started
+		m_cluster->start(dpp::st_return);
+		m_shardsStarted = true;
 	}
 	catch (const std::exception& e) {
 		g_TaskQueue.Push([this, error = std::string(e.what())]() {
@@ -49,6 +122,21 @@ void DiscordClient::Start()
 	}
 
 	m_isRunning = true;
+
+	// One file per bot and cluster, named by a hash so the token itself never ends up on disk
+	uint64_t tokenHash = 14695981039346656037ULL;
+	for (unsigned char c : m_cluster->token) {
+		tokenHash = (tokenHash ^ c) * 1099511628211ULL;
+	}
+	char path[PLATFORM_MAX_PATH];
+	smutils->BuildPath(Path_SM, path, sizeof(path), "data/discord_session_%016llx_%u.txt", static_cast<unsigned long long>(tokenHash), m_cluster->cluster_id);
+	m_sessionPath = path;
+	smutils->BuildPath(Path_SM, path, sizeof(path), "data/discord_cache_%016llx_%u.bin", static_cast<unsigned long long>(tokenHash), m_cluster->cluster_id);
+	m_snapshotPath = path;
+
+	// Open REST connections now, so the first message sent doesn't pay for the connect and TLS handshake
+	m_cluster->get_rest()->set_keep_warm(true);
+
 	m_thread = std::make_unique<std::thread>(&DiscordClient::RunBot, this);
 	smutils->LogMessage(myself, "Discord bot started successfully");
 }
@@ -60,9 +148,32 @@ void DiscordClient::Stop()
 	}
 
 	m_isRunning = false;
+	bool shardsStarted = m_shardsStarted.exchange(false);
+
+	// The request threads stop keeping connections warm once no running client is left to use them
+	dpp::request_queue* rest = m_cluster->get_rest();
+	bool restInUse = std::any_of(s_clients.begin(), s_clients.end(), [this, rest](const DiscordClient* client) {
+		return client != this && client->m_isRunning && client->m_cluster && client->m_cluster->get_rest() == rest;
+	});
+	if (!restInUse) {
+		rest->set_keep_warm(false);
+	}
+
+	// Taken before shutting down, which empties the shard list
+	uint32_t maxShards = 0;
+	std::vector<uint32_t> shards;
+	if (shardsStarted) {
+		maxShards = m_cluster->numshards;
+		for (const auto& shard : m_cluster->get_shards()) {
+			shards.push_back(shard.first);
+		}
+	}
 
 	try {
-		if (m_cluster) {
+		if (m_resumeSessions && shardsStarted) {
+			// Leave the sessions open so the next Start, e.g. after a map change or reload, can resume them
+			SaveSessions(m_cluster->shutdown_resumable());
+		} else {
 			m_cluster->shutdown();
 		}
 
@@ -72,6 +183,12 @@ void DiscordClient::Stop()
 
 		m_thread.reset();
 
+		// The shards are stopped, so the caches no longer change under the snapshot
+		if (m_cacheSnapshot && shardsStarted) {
+			SaveCacheSnapshot(maxShards, shards);
+		}
+		m_snapshot.Clear();
+
 		m_cluster.reset();
 
 		smutils->LogMessage(myself, "Discord bot stopped successfully");
@@ -81,6 +198,126 @@ void DiscordClient::Stop()
 	}
 }
 
+void DiscordClient::RestoreSessions()
+{
+	std::vector<dpp::shard_session> sessions;
+	time_t saved = 0;
+	std::ifstream in(m_sessionPath);
+	if (!in || !(in >> saved) || time(nullptr) - saved > SESSION_RESUME_MAX_AGE) {
+		return;
+	}
+	dpp::shard_session session;
+	while (in >> session.shard_id >> session.max_shards >> session.last_seq >> session.session_id >> session.resume_gateway_url) {
+		sessions.push_back(session);
+	}
+	in.close();
+	// A session is only good for one resume
+	std::remove(m_sessionPath.c_str());
+
+	if (sessions.empty()) {
+		return;
+	}
+
+	try {
+		// Resumed shards get no READY, which is where the bot's own user normally comes from
+		m_cluster->me = dpp::sync<dpp::user_identified>(m_cluster.get(), &dpp::cluster::current_user_get);
+	}
+	catch (const std::exception& e) {
+		g_TaskQueue.Push([error = std::string(e.what())]() {
+			smutils->LogError(myself, "Could not fetch bot user, not resuming sessions: %s", error.c_str());
+			});
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_restoredMutex);
+		for (const auto& restored : sessions) {
+			m_restoredShards.insert(restored.shard_id);
+		}
+	}
+	m_cluster->set_resume_sessions(sessions);
+}
+
+void DiscordClient::SaveSessions(const std::vector<dpp::shard_session>& sessions)
+{
+	if (m_sessionPath.empty()) {
+		return;
+	}
+
+	std::ofstream out(m_sessionPath, std::ios::trunc);
+	if (!out) {
+		smutils->LogError(myself, "Could not write Discord session file %s", m_sessionPath.c_str());
+		return;
+	}
+	out << time(nullptr) << "\n";
+	for (const auto& session : sessions) {
+		if (!session.session_id.empty() && session.last_seq) {
+			out << session.shard_id << " " << session.max_shards << " " << session.last_seq << " " << session.session_id << " " << session.resume_gateway_url << "\n";
+		}
+	}
+}
+
+void DiscordClient::LoadCacheSnapshot()
+{
+	std::string error;
+	int loaded = m_snapshot.Load(m_snapshotPath, CACHE_SNAPSHOT_MAX_AGE, m_cluster->cache_policy, error);
+	g_TaskQueue.Push([loaded, error]() {
+		if (loaded < 0) {
+			smutils->LogError(myself, "Could not load Discord cache snapshot: %s", error.c_str());
+		} else if (loaded > 0) {
+			smutils->LogMessage(myself, "Loaded %d guilds from the Discord cache snapshot", loaded);
+		}
+		});
+}
+
+void DiscordClient::SaveCacheSnapshot(uint32_t maxShards, const std::vector<uint32_t>& shards)
+{
+	if (m_snapshotPath.empty() || shards.empty()) {
+		return;
+	}
+
+	std::string error;
+	if (CacheSnapshot::Save(m_snapshotPath, maxShards, shards, error) < 0) {
+		smutils->LogError(myself, "Could not save Discord cache snapshot: %s", error.c_str());
+	}
+}
+
+bool DiscordClient::EnableLazyMembers(size_t capacity)
+{
+	// The cache policy is read as guilds arrive, so it can't change once the bot is running
+	if (!m_cluster || m_isRunning) {
+		return false;
+	}
+
+	// No member lists are kept from GUILD_CREATE and no chunks are requested, so members only come from GetMember
+	m_cluster->cache_policy.user_policy = dpp::cp_none;
+	m_lazyMembers = true;
+	m_members.SetCapacity(capacity);
+	return true;
+}
+
+uint32_t DiscordClient::GetShardCount() const
+{
+	// The shard list and count are only settled once start() has returned
+	return m_shardsStarted ? m_cluster->numshards : 0;
+}
+
+std::vector<uint32_t> DiscordClient::GetLocalShards() const
+{
+	std::vector<uint32_t> shard_ids;
+	if (m_shardsStarted) {
+		for (const auto& shard : m_cluster->get_shards()) {
+			shard_ids.push_back(shard.first);
+		}
+	}
+	return shard_ids;
+}
+
+dpp::discord_client* DiscordClient::GetShard(uint32_t shard_id) const
+{
+	return m_shardsStarted ? m_cluster->get_shard(shard_id) : nullptr;
+}
+
 bool DiscordClient::SetPresence(dpp::presence presence)
 {
 	if (!m_isRunning) {
@@ -150,8 +387,8 @@ bool DiscordClient::SendMessageEmbed(dpp::snowflake channel_id, const char* mess
 	AddAllowedMentionsToMessage(&message_obj, allowed_mentions_mask, users, roles);
 
 	try {
-		message_obj.add_embed(embed->GetEmbed());
-		m_cluster->message_create(message_obj);
+		m_cluster->post_rest_multipart(API_PATH "/channels", std::to_string(channel_id), "messages", dpp::m_post,
+			embed->BuildMessageJson(message_obj, false), nullptr, message_obj.file_data);
 		return true;
 	}
 	catch (const std::exception& e) {
@@ -172,7 +409,7 @@ bool DiscordClient::GetChannelWebhooks(dpp::snowflake channel_id, IForward *call
 			if (callback.is_error())
 			{
 				smutils->LogError(myself, "Failed to get channel webhooks: %s", callback.get_error().message.c_str());
-				forwards->ReleaseForward(forward);
+				g_PluginProfiler.ReleaseCallback(forward);
 				return;
 			}
 			auto webhook_map = callback.get<dpp::webhook_map>();
@@ -205,14 +442,14 @@ bool DiscordClient::GetChannelWebhooks(dpp::snowflake channel_id, IForward *call
 				forward->PushArray(handles.get(), webhook_count);
 				forward->PushCell(webhook_count);
 				forward->PushCell(value);
-				forward->Execute(nullptr);
+				g_PluginProfiler.ExecuteCallback(forward);
 
 				for (i = 0; i < webhook_count; i++)
 				{
 					handlesys->FreeHandle(handles[i], &sec);
 				}
 
-				forwards->ReleaseForward(forward);
+				g_PluginProfiler.ReleaseCallback(forward);
 			});
 		});
 		return true;
@@ -235,7 +472,7 @@ bool DiscordClient::CreateWebhook(dpp::webhook wh, IForward *callback_forward, c
 			if (callback.is_error())
 			{
 				smutils->LogError(myself, "Failed to create webhook: %s", callback.get_error().message.c_str());
-				forwards->ReleaseForward(forward);
+				g_PluginProfiler.ReleaseCallback(forward);
 				return;
 			}
 			auto webhook = callback.get<dpp::webhook>();
@@ -258,11 +495,11 @@ bool DiscordClient::CreateWebhook(dpp::webhook wh, IForward *callback_forward, c
 				forward->PushCell(m_discord_handle);
 				forward->PushCell(webhookHandle);
 				forward->PushCell(value);
-				forward->Execute(nullptr);
+				g_PluginProfiler.ExecuteCallback(forward);
 
 				handlesys->FreeHandle(webhookHandle, &sec);
 
-				forwards->ReleaseForward(forward);
+				g_PluginProfiler.ReleaseCallback(forward);
             });
 		});
 		return true;
@@ -273,51 +510,296 @@ bool DiscordClient::CreateWebhook(dpp::webhook wh, IForward *callback_forward, c
 	}
 }
 
+// Hands a looked up object to a plugin callback on the main thread, or an invalid handle if there is none
+template <class T>
+static void DeliverObject(DiscordObjectHandler<T>& handler, T* object, Handle_t discord, IForward *forward, cell_t data)
+{
+	g_TaskQueue.Push([&handler, object, discord, forward, data]() {
+		if (forward->GetFunctionCount() == 0) {
+			delete object;
+			g_PluginProfiler.ReleaseCallback(forward);
+			return;
+		}
+
+		HandleError err;
+		HandleSecurity sec(myself->GetIdentity(), myself->GetIdentity());
+		Handle_t handle = BAD_HANDLE;
+		if (object) {
+			handle = handler.CreateHandle(object, &sec, &err);
+			if (handle == BAD_HANDLE) {
+				delete object;
+			}
+		}
+
+		forward->PushCell(discord);
+		forward->PushCell(handle);
+		forward->PushCell(data);
+		g_PluginProfiler.ExecuteCallback(forward);
+
+		if (handle != BAD_HANDLE) {
+			handlesys->FreeHandle(handle, &sec);
+		}
+
+		g_PluginProfiler.ReleaseCallback(forward);
+		});
+}
+
 bool DiscordClient::GetChannel(dpp::snowflake channel_id, IForward *callback_forward, cell_t data)
 {
 	if (!m_isRunning) {
 		return false;
 	}
 
+	// Channels of every guild the bot is in arrive with GUILD_CREATE, so REST is rarely needed
+	{
+		auto lock = TryLockObjects();
+		if (dpp::channel* cached = lock ? dpp::find_channel(channel_id) : nullptr) {
+			DeliverObject(g_DiscordChannelHandler, new DiscordChannel(*cached), m_discord_handle, callback_forward, data);
+			return true;
+		}
+	}
+
 	try {
 		m_cluster->channel_get(channel_id, [this, forward = callback_forward, value = data](const dpp::confirmation_callback_t& callback)
 		{
 			if (callback.is_error())
 			{
 				smutils->LogError(myself, "Failed to get channel: %s", callback.get_error().message.c_str());
-				forwards->ReleaseForward(forward);
+				DeliverObject<DiscordChannel>(g_DiscordChannelHandler, nullptr, m_discord_handle, forward, value);
 				return;
 			}
-			auto channel = callback.get<dpp::channel>();
+			// Not cached, as a channel the gateway doesn't tell us about would never be kept up to date
+			DeliverObject(g_DiscordChannelHandler, new DiscordChannel(callback.get<dpp::channel>()), m_discord_handle, forward, value);
+		});
+		return true;
+	}
+	catch (const std::exception& e) {
+		smutils->LogError(myself, "Failed to get channel: %s", e.what());
+		return false;
+	}
+}
 
-			g_TaskQueue.Push([this, &forward, channel = new DiscordChannel(channel), value = value]() {
-				if (forward && forward->GetFunctionCount() == 0)
-				{
-					return;
-				}
+bool DiscordClient::GetUser(dpp::snowflake user_id, IForward *callback_forward, cell_t data)
+{
+	if (!m_isRunning) {
+		return false;
+	}
 
-				HandleError err;
-				HandleSecurity sec(myself->GetIdentity(), myself->GetIdentity());
-				Handle_t channelHandle = g_DiscordChannelHandler.CreateHandle(channel, &sec, &err);
+	{
+		auto lock = TryLockObjects();
+		if (dpp::user* cached = lock ? dpp::find_user(user_id) : nullptr) {
+			DeliverObject(g_DiscordUserHandler, new DiscordUser(*cached), m_discord_handle, callback_forward, data);
+			return true;
+		}
+	}
 
-				forward->PushCell(m_discord_handle);
-				forward->PushCell(channelHandle);
-				forward->PushCell(value);
-				forward->Execute(nullptr);
+	try {
+		m_cluster->user_get(user_id, [this, forward = callback_forward, value = data](const dpp::confirmation_callback_t& callback)
+		{
+			if (callback.is_error())
+			{
+				smutils->LogError(myself, "Failed to get user: %s", callback.get_error().message.c_str());
+				DeliverObject<DiscordUser>(g_DiscordUserHandler, nullptr, m_discord_handle, forward, value);
+				return;
+			}
+			dpp::user user = callback.get<dpp::user_identified>();
+
+			if (m_cluster->cache_policy.user_policy != dpp::cp_none && !dpp::find_user(user.id)) {
+				dpp::get_user_cache()->store(new dpp::user(user));
+			}
+			DeliverObject(g_DiscordUserHandler, new DiscordUser(user), m_discord_handle, forward, value);
+		});
+		return true;
+	}
+	catch (const std::exception& e) {
+		smutils->LogError(myself, "Failed to get user: %s", e.what());
+		return false;
+	}
+}
+
+bool DiscordClient::GetGuild(dpp::snowflake guild_id, IForward *callback_forward, cell_t data)
+{
+	if (!m_isRunning) {
+		return false;
+	}
 
-				handlesys->FreeHandle(channelHandle, &sec);
+	{
+		auto lock = TryLockObjects();
+		if (dpp::guild* cached = lock ? dpp::find_guild(guild_id) : nullptr) {
+			DeliverObject(g_DiscordGuildHandler, new DiscordGuild(*cached), m_discord_handle, callback_forward, data);
+			return true;
+		}
+	}
 
-				forwards->ReleaseForward(forward);
-            });
+	try {
+		// Not cached from here, as the guild cache holds only guilds the gateway keeps up to date
+		m_cluster->guild_get(guild_id, [this, forward = callback_forward, value = data](const dpp::confirmation_callback_t& callback)
+		{
+			if (callback.is_error())
+			{
+				smutils->LogError(myself, "Failed to get guild: %s", callback.get_error().message.c_str());
+				DeliverObject<DiscordGuild>(g_DiscordGuildHandler, nullptr, m_discord_handle, forward, value);
+				return;
+			}
+			DeliverObject(g_DiscordGuildHandler, new DiscordGuild(callback.get<dpp::guild>()), m_discord_handle, forward, value);
 		});
 		return true;
 	}
 	catch (const std::exception& e) {
-		smutils->LogError(myself, "Failed to get channel: %s", e.what());
+		smutils->LogError(myself, "Failed to get guild: %s", e.what());
+		return false;
+	}
+}
+
+bool DiscordClient::GetRole(dpp::snowflake guild_id, dpp::snowflake role_id, IForward *callback_forward, cell_t data)
+{
+	if (!m_isRunning) {
+		return false;
+	}
+
+	{
+		auto lock = TryLockObjects();
+		dpp::role* cached = lock ? dpp::find_role(role_id) : nullptr;
+		if (cached && cached->guild_id == guild_id) {
+			DeliverObject(g_DiscordRoleHandler, new DiscordRole(*cached), m_discord_handle, callback_forward, data);
+			return true;
+		}
+	}
+
+	try {
+		// Discord only lists a guild's roles all at once. They are not cached, as the gateway would never update them.
+		m_cluster->roles_get(guild_id, [this, guild_id, role_id, forward = callback_forward, value = data](const dpp::confirmation_callback_t& callback)
+		{
+			if (callback.is_error())
+			{
+				smutils->LogError(myself, "Failed to get role: %s", callback.get_error().message.c_str());
+				DeliverObject<DiscordRole>(g_DiscordRoleHandler, nullptr, m_discord_handle, forward, value);
+				return;
+			}
+			auto roles = callback.get<dpp::role_map>();
+
+			auto found = roles.find(role_id);
+			if (found == roles.end()) {
+				smutils->LogError(myself, "Failed to get role: %s is not a role of the guild", std::to_string(role_id).c_str());
+				DeliverObject<DiscordRole>(g_DiscordRoleHandler, nullptr, m_discord_handle, forward, value);
+				return;
+			}
+			// The REST response doesn't carry the guild
+			found->second.guild_id = guild_id;
+			DeliverObject(g_DiscordRoleHandler, new DiscordRole(found->second), m_discord_handle, forward, value);
+		});
+		return true;
+	}
+	catch (const std::exception& e) {
+		smutils->LogError(myself, "Failed to get role: %s", e.what());
 		return false;
 	}
 }
 
+bool DiscordClient::FindMember(dpp::snowflake guild_id, dpp::snowflake user_id, MemberCache::Entry& entry)
+{
+	if (m_members.Find(guild_id, user_id, entry)) {
+		return true;
+	}
+
+	// DPP's own member cache, unless members are loaded lazily. The gateway changes it in place.
+	auto lock = TryLockObjects();
+	dpp::guild* guild = lock ? dpp::find_guild(guild_id) : nullptr;
+	if (!guild) {
+		return false;
+	}
+	auto found = guild->members.find(user_id);
+	if (found == guild->members.end()) {
+		return false;
+	}
+	entry.member = found->second;
+	if (dpp::user* user = dpp::find_user(user_id)) {
+		entry.user = *user;
+	} else {
+		entry.user.id = user_id;
+	}
+	return true;
+}
+
+bool DiscordClient::GetMember(dpp::snowflake guild_id, dpp::snowflake user_id, IForward *callback_forward, cell_t data)
+{
+	if (!m_isRunning) {
+		return false;
+	}
+
+	MemberCache::Entry entry;
+	if (FindMember(guild_id, user_id, entry)) {
+		DeliverMember(&entry, callback_forward, data);
+		return true;
+	}
+
+	try {
+		m_cluster->guild_get_member(guild_id, user_id, [this, forward = callback_forward, value = data](const dpp::confirmation_callback_t& callback)
+		{
+			if (callback.is_error())
+			{
+				smutils->LogError(myself, "Failed to get member: %s", callback.get_error().message.c_str());
+				DeliverMember(nullptr, forward, value);
+				return;
+			}
+
+			// The member object only keeps the user's id, so the user comes from the response itself
+			MemberCache::Entry fetched;
+			fetched.member = callback.get<dpp::guild_member>();
+			try {
+				dpp::json j = dpp::json::parse(callback.http_info.body);
+				if (j.contains("user")) {
+					fetched.user.fill_from_json(&j["user"]);
+				}
+			}
+			catch (const std::exception&) {
+				fetched.user.id = fetched.member.user_id;
+			}
+			m_members.Store(fetched.member, fetched.user);
+			DeliverMember(&fetched, forward, value);
+		});
+		return true;
+	}
+	catch (const std::exception& e) {
+		smutils->LogError(myself, "Failed to get member: %s", e.what());
+		return false;
+	}
+}
+
+void DiscordClient::DeliverMember(const MemberCache::Entry* entry, IForward *callback_forward, cell_t data)
+{
+	std::optional<MemberCache::Entry> found;
+	if (entry) {
+		found = *entry;
+	}
+
+	g_TaskQueue.Push([this, forward = callback_forward, found = std::move(found), value = data]() {
+		if (forward->GetFunctionCount() == 0) {
+			g_PluginProfiler.ReleaseCallback(forward);
+			return;
+		}
+
+		HandleError err;
+		HandleSecurity sec(myself->GetIdentity(), myself->GetIdentity());
+		Handle_t userHandle = BAD_HANDLE;
+		if (found) {
+			userHandle = g_DiscordUserHandler.CreateHandle(new DiscordUser(found->user), &sec, &err);
+		}
+
+		forward->PushCell(m_discord_handle);
+		forward->PushCell(userHandle);
+		forward->PushString(found ? found->member.get_nickname().c_str() : "");
+		forward->PushCell(value);
+		g_PluginProfiler.ExecuteCallback(forward);
+
+		if (userHandle != BAD_HANDLE) {
+			handlesys->FreeHandle(userHandle, &sec);
+		}
+
+		g_PluginProfiler.ReleaseCallback(forward);
+		});
+}
+
 bool DiscordClient::DeleteGuildCommand(dpp::snowflake guild_id, dpp::snowflake command_id)
 {
 	if (!m_isRunning) {
@@ -388,31 +870,94 @@ void DiscordClient::SetupEventHandlers()
 		return;
 	}
 
+	// Shared by every client, registered on first use
+	static EventMetrics readyMetrics("ready");
+	static EventMetrics resumedMetrics("resumed");
+	static EventMetrics messageMetrics("message_create");
+	static EventMetrics logMetrics("log");
+	static EventMetrics slashCommandMetrics("slashcommand");
+	static EventMetrics autocompleteMetrics("autocomplete");
+
 	m_cluster->on_ready([this](const dpp::ready_t& event) {
+		readyMetrics.received.Add();
+		TracedEvent traced = g_EventTrace.Begin("ready", event.from);
+		// Runs before this shard's GUILD_CREATEs are handled
+		m_snapshot.OnReady(event.shard_id, event.from->max_shards, event.guilds);
+		{
+			// A restored session Discord refused was identified afresh instead
+			std::lock_guard<std::mutex> lock(m_restoredMutex);
+			m_restoredShards.erase(event.shard_id);
+		}
 		UpdateBotInfo();
-		g_TaskQueue.Push([this]() {
+		g_TaskQueue.Push([this, queued = readyMetrics.Queue(), traced = g_EventTrace.Queue(traced)]() {
+			EventDispatch dispatch(readyMetrics, queued);
+			TraceRun run(traced);
 			if (g_pForwardReady && g_pForwardReady->GetFunctionCount()) {
-				g_pForwardReady->PushCell(m_discord_handle);
-				g_pForwardReady->Execute(nullptr);
+				dispatch.Deliver();
+				g_PluginProfiler.ExecuteForward(g_pForwardReady, [this](ICallable* call) {
+					call->PushCell(m_discord_handle);
+					});
 			}
 			});
 		});
 
-	m_cluster->on_message_create([this](const dpp::message_create_t& event) {
-		g_TaskQueue.Push([this, msg = event.msg]() {
-			if (g_pForwardMessage && g_pForwardMessage->GetFunctionCount()) {
-				DiscordMessage* message = new DiscordMessage(msg);
-				HandleError err;
-				HandleSecurity sec;
-				sec.pOwner = myself->GetIdentity();
-				sec.pIdentity = myself->GetIdentity();
+	m_cluster->on_guild_create([this](const dpp::guild_create_t& event) {
+		if (event.created) {
+			m_snapshot.OnGuildCreate(*event.created);
+		}
+		});
 
-				Handle_t messageHandle = g_DiscordMessageHandler.CreateHandle(message, &sec, &err);
+	m_cluster->on_resumed([this](const dpp::resumed_t& event) {
+		resumedMetrics.received.Add();
+		TracedEvent traced = g_EventTrace.Begin("resumed", event.from);
+		m_snapshot.OnResumed(event.shard_id, event.from->max_shards);
 
-				if (messageHandle != BAD_HANDLE) {
-					g_pForwardMessage->PushCell(m_discord_handle);
-					g_pForwardMessage->PushCell(messageHandle);
-					g_pForwardMessage->Execute(nullptr);
+		// A session carried over from before the last Stop resumes rather than becoming ready, but plugins still expect OnReady
+		{
+			std::lock_guard<std::mutex> lock(m_restoredMutex);
+			if (!m_restoredShards.erase(event.shard_id)) {
+				return;
+			}
+		}
+		UpdateBotInfo();
+		g_TaskQueue.Push([this, queued = resumedMetrics.Queue(), traced = g_EventTrace.Queue(traced)]() {
+			EventDispatch dispatch(resumedMetrics, queued);
+			TraceRun run(traced);
+			if (g_pForwardReady && g_pForwardReady->GetFunctionCount()) {
+				dispatch.Deliver();
+				g_PluginProfiler.ExecuteForward(g_pForwardReady, [this](ICallable* call) {
+					call->PushCell(m_discord_handle);
+					});
+			}
+			});
+		});
+
+	m_cluster->on_message_create([this](const dpp::message_create_t& event) {
+		messageMetrics.received.Add();
+		TracedEvent traced = g_EventTrace.Begin("message_create", event.from);
+		// Messages carry the author's member record, which keeps active members warm at no cost
+		if (event.msg.guild_id && event.msg.member.user_id) {
+			m_members.Store(event.msg.member, event.msg.author);
+		}
+
+		g_TaskQueue.Push([this, msg = event.msg, queued = messageMetrics.Queue(), traced = g_EventTrace.Queue(traced)]() {
+			EventDispatch dispatch(messageMetrics, queued);
+			TraceRun run(traced);
+			if (g_pForwardMessage && g_pForwardMessage->GetFunctionCount()) {
+				dispatch.Deliver();
+				DiscordMessage* message = new DiscordMessage(msg);
+				HandleError err;
+				HandleSecurity sec;
+				sec.pOwner = myself->GetIdentity();
+				sec.pIdentity = myself->GetIdentity();
+
+				Handle_t messageHandle = g_DiscordMessageHandler.CreateHandle(message, &sec, &err);
+
+				if (messageHandle != BAD_HANDLE) {
+					g_PluginProfiler.ExecuteForward(g_pForwardMessage, [this, messageHandle](ICallable* call) {
+						call->PushCell(m_discord_handle);
+						call->PushCell(messageHandle);
+						});
 
 					handlesys->FreeHandle(messageHandle, &sec);
 				}
@@ -421,19 +966,28 @@ void DiscordClient::SetupEventHandlers()
 		});
 
 	m_cluster->on_log([this](const dpp::log_t& event) {
-		g_TaskQueue.Push([this, message = event.message]() {
+		logMetrics.received.Add();
+		g_TaskQueue.Push([this, message = event.message, queued = logMetrics.Queue()]() {
+			EventDispatch dispatch(logMetrics, queued);
 			if (g_pForwardError && g_pForwardError->GetFunctionCount()) {
-				g_pForwardError->PushCell(m_discord_handle);
-				g_pForwardError->PushString(message.c_str());
-				g_pForwardError->Execute(nullptr);
+				dispatch.Deliver();
+				g_PluginProfiler.ExecuteForward(g_pForwardError, [this, &message](ICallable* call) {
+					call->PushCell(m_discord_handle);
+					call->PushString(message.c_str());
+					});
 			}
 			});
 		});
 
 	m_cluster->on_slashcommand([this](const dpp::slashcommand_t& event) {
-		g_TaskQueue.Push([this, event]() {
+		slashCommandMetrics.received.Add();
+		TracedEvent traced = g_EventTrace.Begin("slashcommand", event.from);
+		g_TaskQueue.Push([this, event, queued = slashCommandMetrics.Queue(), traced = g_EventTrace.Queue(traced)]() {
+			EventDispatch dispatch(slashCommandMetrics, queued);
+			TraceRun run(traced);
 			if (g_pForwardSlashCommand && g_pForwardSlashCommand->GetFunctionCount()) {
-				DiscordInteraction* interaction = new DiscordInteraction(event);
+				dispatch.Deliver();
+				DiscordInteraction* interaction = new DiscordInteraction(event, traced.id);
 
 				HandleError err;
 				HandleSecurity sec;
@@ -443,9 +997,10 @@ void DiscordClient::SetupEventHandlers()
 				Handle_t interactionHandle = g_DiscordInteractionHandler.CreateHandle(interaction, &sec, &err);
 
 				if (interactionHandle != BAD_HANDLE) {
-					g_pForwardSlashCommand->PushCell(m_discord_handle);
-					g_pForwardSlashCommand->PushCell(interactionHandle);
-					g_pForwardSlashCommand->Execute(nullptr);
+					g_PluginProfiler.ExecuteForward(g_pForwardSlashCommand, [this, interactionHandle](ICallable* call) {
+						call->PushCell(m_discord_handle);
+						call->PushCell(interactionHandle);
+						});
 
 					handlesys->FreeHandle(interactionHandle, &sec);
 				}
@@ -454,9 +1009,14 @@ void DiscordClient::SetupEventHandlers()
 		});
 
 	m_cluster->on_autocomplete([this](const dpp::autocomplete_t& event) {
-		g_TaskQueue.Push([this, event]() {
+		autocompleteMetrics.received.Add();
+		TracedEvent traced = g_EventTrace.Begin("autocomplete", event.from);
+		g_TaskQueue.Push([this, event, queued = autocompleteMetrics.Queue(), traced = g_EventTrace.Queue(traced)]() {
+			EventDispatch dispatch(autocompleteMetrics, queued);
+			TraceRun run(traced);
 			if (g_pForwardAutocomplete && g_pForwardAutocomplete->GetFunctionCount()) {
-				DiscordAutocompleteInteraction* interaction = new DiscordAutocompleteInteraction(event);
+				dispatch.Deliver();
+				DiscordAutocompleteInteraction* interaction = new DiscordAutocompleteInteraction(event, traced.id);
 
 				HandleError err;
 				HandleSecurity sec;
@@ -470,12 +1030,13 @@ void DiscordClient::SetupEventHandlers()
 					for (auto & opt : event.options) {
 						dpp::command_option_type type = opt.type;
 
-						g_pForwardAutocomplete->PushCell(m_discord_handle);
-						g_pForwardAutocomplete->PushCell(interactionHandle);
-						g_pForwardAutocomplete->PushCell(opt.focused ? 1 : 0);
-						g_pForwardAutocomplete->PushCell(type);
-						g_pForwardAutocomplete->PushString(opt.name.c_str());
-						g_pForwardAutocomplete->Execute(nullptr);
+						g_PluginProfiler.ExecuteForward(g_pForwardAutocomplete, [&](ICallable* call) {
+							call->PushCell(m_discord_handle);
+							call->PushCell(interactionHandle);
+							call->PushCell(opt.focused ? 1 : 0);
+							call->PushCell(type);
+							call->PushString(opt.name.c_str());
+							});
 					}
 	        	}
 
@@ -491,7 +1052,30 @@ static cell_t discord_CreateClient(IPluginContext* pContext, const cell_t* param
 	char* token;
 	pContext->LocalToString(params[1], &token);
 
-	DiscordClient* pDiscordClient = new DiscordClient(token);
+	bool sharedPool = params[0] >= 2 && params[2];
+	cell_t encoding = params[0] >= 3 ? params[3] : 0;
+	if (encoding != 0 && encoding != 1) {
+		pContext->ReportError("Invalid gateway encoding %d", encoding);
+		return BAD_HANDLE;
+	}
+	dpp::websocket_protocol_t protocol = encoding == 1 ? dpp::ws_etf : dpp::ws_json;
+	cell_t shardCount = params[0] >= 4 ? params[4] : 0;
+	cell_t clusterId = params[0] >= 5 ? params[5] : 0;
+	cell_t maxClusters = params[0] >= 6 ? params[6] : 1;
+
+	if (shardCount < 0 || maxClusters < 1 || clusterId < 0 || clusterId >= maxClusters) {
+		pContext->ReportError("Invalid sharding: shardCount %d, clusterId %d, maxClusters %d", shardCount, clusterId, maxClusters);
+		return BAD_HANDLE;
+	}
+
+	DiscordClient* pDiscordClient;
+	try {
+		pDiscordClient = new DiscordClient(token, sharedPool, protocol, shardCount, clusterId, maxClusters);
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Could not create Discord client: %s", e.what());
+		return BAD_HANDLE;
+	}
 
 	if (!pDiscordClient->Initialize())
 	{
@@ -640,6 +1224,7 @@ static cell_t discord_GetChannelWebhooks(IPluginContext* pContext, const cell_t*
 		{
 			return pContext->ThrowNativeError("Could not create forward.");
 		}
+		g_PluginProfiler.AddCallback(forward, pContext, "GetChannelWebhooks");
 
 		cell_t data = params[4];
 		return discord->GetChannelWebhooks(channelFlake, forward, data);
@@ -676,6 +1261,7 @@ static cell_t discord_CreateWebhook(IPluginContext* pContext, const cell_t* para
 		{
 			return pContext->ThrowNativeError("Could not create forward.");
 		}
+		g_PluginProfiler.AddCallback(forward, pContext, "CreateWebhook");
 
 		cell_t data = params[5];
 		return discord->CreateWebhook(webhook, forward, data);
@@ -786,112 +1372,871 @@ static cell_t discord_SendMessage(IPluginContext* pContext, const cell_t* params
 		}
 	}
 
-	try {
-		dpp::snowflake channel = std::stoull(channelId);
-		return discord->SendMessage(channel, message, params[4], users, roles) ? 1 : 0;
+	try {
+		dpp::snowflake channel = std::stoull(channelId);
+		return discord->SendMessage(channel, message, params[4], users, roles) ? 1 : 0;
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid channel ID format: %s", channelId);
+		return 0;
+	}
+}
+
+static cell_t discord_SendMessageEmbed(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	char* channelId;
+	pContext->LocalToString(params[2], &channelId);
+
+	char* message;
+	pContext->LocalToString(params[3], &message);
+
+	cell_t* users_array;
+	cell_t* roles_array;
+
+	pContext->LocalToPhysAddr(params[6], &users_array);
+	pContext->LocalToPhysAddr(params[8], &roles_array);
+
+	std::vector<dpp::snowflake> users(params[7]);
+	std::vector<dpp::snowflake> roles(params[9]);
+
+	for (int i = 0; i < users.size(); i++) {
+		char* str;
+
+		pContext->LocalToString(users_array[i], &str);
+		try {
+			users[i] = std::stoull(str);
+		}
+		catch (const std::exception& e) {
+			continue; // Stub
+		}
+	}
+
+	for (int i = 0; i < roles.size(); i++) {
+		char* str;
+
+		pContext->LocalToString(roles_array[i], &str);
+		try {
+			roles[i] = std::stoull(str);
+		}
+		catch (const std::exception& e) {
+			continue; // Stub
+		}
+	}
+
+	DiscordEmbed* embed = g_DiscordEmbedHandler.ReadHandle(params[4]);
+
+	try {
+		dpp::snowflake channel = std::stoull(channelId);
+		return discord->SendMessageEmbed(channel, message, embed, params[5], users, roles) ? 1 : 0;
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid channel ID format: %s", channelId);
+		return 0;
+	}
+}
+
+static cell_t discord_GetChannel(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	char* channelId;
+	pContext->LocalToString(params[2], &channelId);
+
+	try {
+		dpp::snowflake channelFlake = std::stoull(channelId);
+
+		IPluginFunction *callback = pContext->GetFunctionById(params[3]);
+
+		IChangeableForward *forward = forwards->CreateForwardEx(nullptr, ET_Ignore, 3, nullptr, Param_Cell, Param_Cell, Param_Any);
+		if (forward == nullptr || !forward->AddFunction(callback))
+		{
+			return pContext->ThrowNativeError("Could not create forward.");
+		}
+		g_PluginProfiler.AddCallback(forward, pContext, "GetChannel");
+
+		cell_t data = params[4];
+		return discord->GetChannel(channelFlake, forward, data);
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid channel ID format: %s", channelId);
+		return 0;
+	}
+}
+
+static cell_t discord_GetMember(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	char* guildId;
+	char* userId;
+	pContext->LocalToString(params[2], &guildId);
+	pContext->LocalToString(params[3], &userId);
+
+	try {
+		dpp::snowflake guildFlake = std::stoull(guildId);
+		dpp::snowflake userFlake = std::stoull(userId);
+
+		IPluginFunction *callback = pContext->GetFunctionById(params[4]);
+
+		IChangeableForward *forward = forwards->CreateForwardEx(nullptr, ET_Ignore, 4, nullptr, Param_Cell, Param_Cell, Param_String, Param_Any);
+		if (forward == nullptr || !forward->AddFunction(callback))
+		{
+			return pContext->ThrowNativeError("Could not create forward.");
+		}
+		g_PluginProfiler.AddCallback(forward, pContext, "GetMember");
+
+		if (!discord->GetMember(guildFlake, userFlake, forward, params[5])) {
+			g_PluginProfiler.ReleaseCallback(forward);
+			return 0;
+		}
+		return 1;
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid guild or user ID format: %s, %s", guildId, userId);
+		return 0;
+	}
+}
+
+static cell_t discord_EnableLazyMembers(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	if (params[2] < 0) {
+		pContext->ReportError("Invalid member cache capacity: %d", params[2]);
+		return 0;
+	}
+
+	return discord->EnableLazyMembers(static_cast<size_t>(params[2])) ? 1 : 0;
+}
+
+// Gives a plugin its own handle to a looked up object, which it must delete
+template <class T>
+static Handle_t CreatePluginHandle(IPluginContext* pContext, DiscordObjectHandler<T>& handler, T* object, const char* type)
+{
+	HandleError err;
+	HandleSecurity sec(pContext->GetIdentity(), myself->GetIdentity());
+	Handle_t handle = handler.CreateHandle(object, &sec, &err);
+	if (handle == BAD_HANDLE) {
+		delete object;
+		pContext->ReportError("Could not create %s handle (error %d)", type, err);
+	}
+	return handle;
+}
+
+static cell_t discord_FindChannel(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return BAD_HANDLE;
+	}
+
+	char* channelId;
+	pContext->LocalToString(params[2], &channelId);
+
+	try {
+		DiscordChannel* copy;
+		{
+			auto lock = TryLockObjects();
+			dpp::channel* channel = lock ? dpp::find_channel(std::stoull(channelId)) : nullptr;
+			if (!channel) {
+				return BAD_HANDLE;
+			}
+			copy = new DiscordChannel(*channel);
+		}
+		return CreatePluginHandle(pContext, g_DiscordChannelHandler, copy, "channel");
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid channel ID format: %s", channelId);
+		return BAD_HANDLE;
+	}
+}
+
+static cell_t discord_FindUser(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return BAD_HANDLE;
+	}
+
+	char* userId;
+	pContext->LocalToString(params[2], &userId);
+
+	try {
+		DiscordUser* copy;
+		{
+			auto lock = TryLockObjects();
+			dpp::user* user = lock ? dpp::find_user(std::stoull(userId)) : nullptr;
+			if (!user) {
+				return BAD_HANDLE;
+			}
+			copy = new DiscordUser(*user);
+		}
+		return CreatePluginHandle(pContext, g_DiscordUserHandler, copy, "user");
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid user ID format: %s", userId);
+		return BAD_HANDLE;
+	}
+}
+
+static cell_t discord_FindGuild(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return BAD_HANDLE;
+	}
+
+	char* guildId;
+	pContext->LocalToString(params[2], &guildId);
+
+	try {
+		DiscordGuild* copy;
+		{
+			auto lock = TryLockObjects();
+			dpp::guild* guild = lock ? dpp::find_guild(std::stoull(guildId)) : nullptr;
+			if (!guild) {
+				return BAD_HANDLE;
+			}
+			copy = new DiscordGuild(*guild);
+		}
+		return CreatePluginHandle(pContext, g_DiscordGuildHandler, copy, "guild");
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid guild ID format: %s", guildId);
+		return BAD_HANDLE;
+	}
+}
+
+static cell_t discord_FindRole(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return BAD_HANDLE;
+	}
+
+	char* roleId;
+	pContext->LocalToString(params[2], &roleId);
+
+	try {
+		DiscordRole* copy;
+		{
+			auto lock = TryLockObjects();
+			dpp::role* role = lock ? dpp::find_role(std::stoull(roleId)) : nullptr;
+			if (!role) {
+				return BAD_HANDLE;
+			}
+			copy = new DiscordRole(*role);
+		}
+		return CreatePluginHandle(pContext, g_DiscordRoleHandler, copy, "role");
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid role ID format: %s", roleId);
+		return BAD_HANDLE;
+	}
+}
+
+static cell_t discord_FindMember(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return BAD_HANDLE;
+	}
+
+	char* guildId;
+	char* userId;
+	pContext->LocalToString(params[2], &guildId);
+	pContext->LocalToString(params[3], &userId);
+
+	try {
+		MemberCache::Entry entry;
+		if (!discord->FindMember(std::stoull(guildId), std::stoull(userId), entry)) {
+			return BAD_HANDLE;
+		}
+		pContext->StringToLocal(params[4], params[5], entry.member.get_nickname().c_str());
+		return CreatePluginHandle(pContext, g_DiscordUserHandler, new DiscordUser(entry.user), "user");
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid guild or user ID format: %s, %s", guildId, userId);
+		return BAD_HANDLE;
+	}
+}
+
+static cell_t discord_FindMemberPermissions(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	char* guildId;
+	char* userId;
+	char* channelId;
+	pContext->LocalToString(params[2], &guildId);
+	pContext->LocalToString(params[3], &userId);
+	pContext->LocalToString(params[6], &channelId);
+
+	try {
+		dpp::snowflake guildFlake = std::stoull(guildId);
+		MemberCache::Entry entry;
+		if (!discord->FindMember(guildFlake, std::stoull(userId), entry)) {
+			return 0;
+		}
+
+		// Roles come from the role cache, and channel overwrites from the channel cache
+		auto lock = TryLockObjects();
+		dpp::guild* guild = lock ? dpp::find_guild(guildFlake) : nullptr;
+		if (!guild) {
+			return 0;
+		}
+		dpp::permission permissions = guild->base_permissions(entry.member);
+		if (channelId[0] != '\0') {
+			dpp::channel* channel = dpp::find_channel(std::stoull(channelId));
+			if (!channel) {
+				return 0;
+			}
+			permissions = guild->permission_overwrites(entry.member, *channel);
+		}
+
+		pContext->StringToLocal(params[4], params[5], std::to_string(static_cast<uint64_t>(permissions)).c_str());
+		return 1;
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid guild, user or channel ID format: %s, %s, %s", guildId, userId, channelId);
+		return 0;
+	}
+}
+
+static cell_t discord_GetUser(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	char* userId;
+	pContext->LocalToString(params[2], &userId);
+
+	try {
+		dpp::snowflake userFlake = std::stoull(userId);
+
+		IPluginFunction *callback = pContext->GetFunctionById(params[3]);
+
+		IChangeableForward *forward = forwards->CreateForwardEx(nullptr, ET_Ignore, 3, nullptr, Param_Cell, Param_Cell, Param_Any);
+		if (forward == nullptr || !forward->AddFunction(callback))
+		{
+			return pContext->ThrowNativeError("Could not create forward.");
+		}
+		g_PluginProfiler.AddCallback(forward, pContext, "GetUser");
+
+		if (!discord->GetUser(userFlake, forward, params[4])) {
+			g_PluginProfiler.ReleaseCallback(forward);
+			return 0;
+		}
+		return 1;
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid user ID format: %s", userId);
+		return 0;
+	}
+}
+
+static cell_t discord_GetGuild(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	char* guildId;
+	pContext->LocalToString(params[2], &guildId);
+
+	try {
+		dpp::snowflake guildFlake = std::stoull(guildId);
+
+		IPluginFunction *callback = pContext->GetFunctionById(params[3]);
+
+		IChangeableForward *forward = forwards->CreateForwardEx(nullptr, ET_Ignore, 3, nullptr, Param_Cell, Param_Cell, Param_Any);
+		if (forward == nullptr || !forward->AddFunction(callback))
+		{
+			return pContext->ThrowNativeError("Could not create forward.");
+		}
+		g_PluginProfiler.AddCallback(forward, pContext, "GetGuild");
+
+		if (!discord->GetGuild(guildFlake, forward, params[4])) {
+			g_PluginProfiler.ReleaseCallback(forward);
+			return 0;
+		}
+		return 1;
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid guild ID format: %s", guildId);
+		return 0;
+	}
+}
+
+static cell_t discord_GetRole(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	char* guildId;
+	char* roleId;
+	pContext->LocalToString(params[2], &guildId);
+	pContext->LocalToString(params[3], &roleId);
+
+	try {
+		dpp::snowflake guildFlake = std::stoull(guildId);
+		dpp::snowflake roleFlake = std::stoull(roleId);
+
+		IPluginFunction *callback = pContext->GetFunctionById(params[4]);
+
+		IChangeableForward *forward = forwards->CreateForwardEx(nullptr, ET_Ignore, 3, nullptr, Param_Cell, Param_Cell, Param_Any);
+		if (forward == nullptr || !forward->AddFunction(callback))
+		{
+			return pContext->ThrowNativeError("Could not create forward.");
+		}
+		g_PluginProfiler.AddCallback(forward, pContext, "GetRole");
+
+		if (!discord->GetRole(guildFlake, roleFlake, forward, params[5])) {
+			g_PluginProfiler.ReleaseCallback(forward);
+			return 0;
+		}
+		return 1;
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid guild or role ID format: %s, %s", guildId, roleId);
+		return 0;
+	}
+}
+
+static cell_t discord_IsRunning(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	return discord->IsRunning() ? 1 : 0;
+}
+
+static cell_t discord_SetSessionResume(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	discord->SetSessionResume(params[2] != 0);
+	return 1;
+}
+
+static cell_t discord_SetCacheSnapshot(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	discord->SetCacheSnapshot(params[2] != 0);
+	return 1;
+}
+
+static cell_t discord_GetShardCount(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	return static_cast<cell_t>(discord->GetShardCount());
+}
+
+static cell_t discord_GetClusterId(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	return static_cast<cell_t>(discord->GetClusterId());
+}
+
+static cell_t discord_GetMaxClusters(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	return static_cast<cell_t>(discord->GetMaxClusters());
+}
+
+static cell_t discord_GetLocalShards(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	cell_t* shardIds;
+	pContext->LocalToPhysAddr(params[2], &shardIds);
+
+	std::vector<uint32_t> shards = discord->GetLocalShards();
+	cell_t count = std::min(static_cast<cell_t>(shards.size()), params[3]);
+	for (cell_t i = 0; i < count; i++) {
+		shardIds[i] = static_cast<cell_t>(shards[i]);
+	}
+	return count;
+}
+
+static cell_t discord_GetShardState(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	dpp::discord_client* shard = discord->GetShard(static_cast<uint32_t>(params[2]));
+	if (!shard) {
+		return 0;
+	}
+
+	return shard->is_connected() ? 2 : 1;
+}
+
+static cell_t discord_GetShardLatency(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return sp_ftoc(-1.0f);
+	}
+
+	dpp::discord_client* shard = discord->GetShard(static_cast<uint32_t>(params[2]));
+	if (!shard || !shard->is_connected()) {
+		return sp_ftoc(-1.0f);
+	}
+
+	return sp_ftoc(static_cast<float>(shard->websocket_ping));
+}
+
+static cell_t discord_GetShardEventCount(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	dpp::discord_client* shard = discord->GetShard(static_cast<uint32_t>(params[2]));
+	if (!shard) {
+		return 0;
+	}
+
+	return static_cast<cell_t>(shard->dispatch_count.load(std::memory_order_relaxed));
+}
+
+static cell_t discord_GetRestPing(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return sp_ftoc(0.0f);
+	}
+
+	return sp_ftoc(static_cast<float>(discord->GetRestPing()));
+}
+
+static cell_t discord_GetShardBytesIn(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return sp_ftoc(0.0f);
+	}
+
+	dpp::discord_client* shard = discord->GetShard(static_cast<uint32_t>(params[2]));
+	if (!shard) {
+		return sp_ftoc(0.0f);
 	}
-	catch (const std::exception& e) {
-		pContext->ReportError("Invalid channel ID format: %s", channelId);
+
+	bool decompressed = params[0] >= 3 && params[3] != 0;
+	return sp_ftoc(static_cast<float>(decompressed ? shard->get_decompressed_bytes_in() : shard->get_bytes_in()));
+}
+
+static cell_t discord_GetShardReconnects(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	dpp::discord_client* shard = discord->GetShard(static_cast<uint32_t>(params[2]));
+	if (!shard) {
 		return 0;
 	}
+
+	// Every connection either identifies or resumes, and the first one isn't a reconnection
+	uint32_t connections = shard->reconnects + shard->resumes;
+	return static_cast<cell_t>(connections ? connections - 1 : 0);
 }
 
-static cell_t discord_SendMessageEmbed(IPluginContext* pContext, const cell_t* params)
+static cell_t discord_GetShardResumes(IPluginContext* pContext, const cell_t* params)
 {
 	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
 	if (!discord) {
 		return 0;
 	}
 
-	char* channelId;
-	pContext->LocalToString(params[2], &channelId);
+	dpp::discord_client* shard = discord->GetShard(static_cast<uint32_t>(params[2]));
+	if (!shard) {
+		return 0;
+	}
 
-	char* message;
-	pContext->LocalToString(params[3], &message);
+	return static_cast<cell_t>(shard->resumes);
+}
 
-	cell_t* users_array;
-	cell_t* roles_array;
+static cell_t discord_GetShardLastEventAge(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return sp_ftoc(-1.0f);
+	}
 
-	pContext->LocalToPhysAddr(params[6], &users_array);
-	pContext->LocalToPhysAddr(params[8], &roles_array);
+	dpp::discord_client* shard = discord->GetShard(static_cast<uint32_t>(params[2]));
+	if (!shard) {
+		return sp_ftoc(-1.0f);
+	}
 
-	std::vector<dpp::snowflake> users(params[7]);
-	std::vector<dpp::snowflake> roles(params[9]);
+	double last = shard->last_dispatch.load();
+	if (last == 0.0) {
+		return sp_ftoc(-1.0f);
+	}
 
-	for (int i = 0; i < users.size(); i++) {
-		char* str;
+	return sp_ftoc(static_cast<float>(dpp::utility::time_f() - last));
+}
 
-		pContext->LocalToString(users_array[i], &str);
-		try {
-			users[i] = std::stoull(str);
-		}
-		catch (const std::exception& e) {
-			continue; // Stub
-		}
+static cell_t discord_GetShardEventRate(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return sp_ftoc(0.0f);
 	}
 
-	for (int i = 0; i < roles.size(); i++) {
-		char* str;
+	char* event;
+	pContext->LocalToString(params[3], &event);
 
-		pContext->LocalToString(roles_array[i], &str);
-		try {
-			roles[i] = std::stoull(str);
-		}
-		catch (const std::exception& e) {
-			continue; // Stub
+	dpp::event_stats stats;
+	dpp::discord_client* shard = discord->GetShard(static_cast<uint32_t>(params[2]));
+	if (shard) {
+		auto all = shard->get_event_stats();
+		auto found = all.find(event);
+		if (found != all.end()) {
+			stats = found->second;
 		}
 	}
 
-	DiscordEmbed* embed = g_DiscordEmbedHandler.ReadHandle(params[4]);
-
-	try {
-		dpp::snowflake channel = std::stoull(channelId);
-		return discord->SendMessageEmbed(channel, message, embed, params[5], users, roles) ? 1 : 0;
+	if (params[0] >= 4) {
+		cell_t* total;
+		pContext->LocalToPhysAddr(params[4], &total);
+		*total = static_cast<cell_t>(stats.total);
 	}
-	catch (const std::exception& e) {
-		pContext->ReportError("Invalid channel ID format: %s", channelId);
-		return 0;
+
+	return sp_ftoc(static_cast<float>(stats.per_second));
+}
+
+bool GetGlobalCacheStats(int cache, dpp::cache_stats& stats)
+{
+	// Counting the memory the objects own reads them. While the gateway thread is changing them,
+	// the last full count stands in rather than stall the frame.
+	static uint64_t lastBytes[5];
+	auto lock = TryLockObjects();
+
+	// Same order as DiscordCache in discord.inc
+	switch (cache) {
+		case 0: stats = dpp::get_user_cache()->get_stats(lock.owns_lock()); break;
+		case 1: stats = dpp::get_guild_cache()->get_stats(lock.owns_lock()); break;
+		case 2: stats = dpp::get_role_cache()->get_stats(lock.owns_lock()); break;
+		case 3: stats = dpp::get_channel_cache()->get_stats(lock.owns_lock()); break;
+		case 4: stats = dpp::get_emoji_cache()->get_stats(lock.owns_lock()); break;
+		default: return false;
+	}
+	if (lock) {
+		lastBytes[cache] = stats.bytes;
+	} else if (lastBytes[cache]) {
+		stats.bytes = lastBytes[cache];
+	}
+	return true;
+}
+
+static float CacheStatValue(const dpp::cache_stats& stats, cell_t stat)
+{
+	// Same order as DiscordCacheStat in discord.inc
+	switch (stat) {
+		case 0: return static_cast<float>(stats.entries);
+		case 1: return static_cast<float>(stats.bytes);
+		case 2: return static_cast<float>(stats.finds);
+		case 3: return static_cast<float>(stats.hits);
+		case 4: return static_cast<float>(stats.misses);
+		case 5: return static_cast<float>(stats.evictions);
+	}
+	return 0.0f;
+}
+
+static cell_t discord_GetCacheStat(IPluginContext* pContext, const cell_t* params)
+{
+	dpp::cache_stats stats;
+	if (!GetGlobalCacheStats(params[1], stats)) {
+		pContext->ReportError("Invalid cache %d", params[1]);
+		return sp_ftoc(0.0f);
 	}
+	return sp_ftoc(CacheStatValue(stats, params[2]));
 }
 
-static cell_t discord_GetChannel(IPluginContext* pContext, const cell_t* params)
+static cell_t discord_GetMemberCacheStat(IPluginContext* pContext, const cell_t* params)
 {
 	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
 	if (!discord) {
+		return sp_ftoc(0.0f);
+	}
+
+	MemberCache::Stats members = discord->GetMemberCacheStats();
+	dpp::cache_stats stats;
+	stats.entries = members.entries;
+	stats.bytes = members.bytes;
+	stats.finds = members.finds;
+	stats.hits = members.hits;
+	stats.misses = members.finds - members.hits;
+	stats.evictions = members.evictions;
+	return sp_ftoc(CacheStatValue(stats, params[2]));
+}
+
+static cell_t discord_GetGCStat(IPluginContext* pContext, const cell_t* params)
+{
+	dpp::gc_stats stats = dpp::get_gc_stats();
+
+	// Same order as DiscordGCStat in discord.inc
+	switch (params[1]) {
+		case 0: return sp_ftoc(static_cast<float>(stats.runs));
+		case 1: return sp_ftoc(static_cast<float>(stats.deleted));
+		case 2: return sp_ftoc(static_cast<float>(stats.pending));
+		case 3: return sp_ftoc(static_cast<float>(stats.total_time));
+		case 4: return sp_ftoc(static_cast<float>(stats.last_time));
+	}
+	return sp_ftoc(0.0f);
+}
+
+static cell_t discord_GetMetric(IPluginContext* pContext, const cell_t* params)
+{
+	char* name;
+	char* labels;
+	pContext->LocalToString(params[1], &name);
+	pContext->LocalToString(params[2], &labels);
+
+	const MetricsRegistry::Metric* metric = g_Metrics.Find(name, labels);
+	if (!metric) {
+		return sp_ftoc(0.0f);
+	}
+	switch (metric->kind) {
+		case MetricsRegistry::Kind::Counter: return sp_ftoc(static_cast<float>(metric->counter.Get()));
+		case MetricsRegistry::Kind::Gauge: return sp_ftoc(static_cast<float>(metric->gauge.Get()));
+		case MetricsRegistry::Kind::Histogram: return sp_ftoc(static_cast<float>(metric->histogram->Count()));
+	}
+	return sp_ftoc(0.0f);
+}
+
+static cell_t discord_GetMetricQuantile(IPluginContext* pContext, const cell_t* params)
+{
+	char* name;
+	char* labels;
+	pContext->LocalToString(params[1], &name);
+	float quantile = sp_ctof(params[2]);
+	pContext->LocalToString(params[3], &labels);
+
+	if (quantile < 0.0f || quantile > 1.0f) {
+		pContext->ReportError("Invalid quantile %f, must be between 0.0 and 1.0", quantile);
 		return 0;
 	}
 
-	char* channelId;
-	pContext->LocalToString(params[2], &channelId);
+	const MetricsRegistry::Metric* metric = g_Metrics.Find(name, labels);
+	if (!metric || metric->kind != MetricsRegistry::Kind::Histogram) {
+		return sp_ftoc(0.0f);
+	}
+	return sp_ftoc(static_cast<float>(metric->histogram->Quantile(quantile)));
+}
 
-	try {
-		dpp::snowflake channelFlake = std::stoull(channelId);
+static cell_t discord_GetMetricsSnapshot(IPluginContext* pContext, const cell_t* params)
+{
+	std::string text = g_Metrics.FormatPrometheus();
+	pContext->StringToLocalUTF8(params[1], params[2], text.c_str(), nullptr);
+	return static_cast<cell_t>(text.size());
+}
 
-		IPluginFunction *callback = pContext->GetFunctionById(params[3]);
+static cell_t discord_StartTrace(IPluginContext* pContext, const cell_t* params)
+{
+	char* file;
+	pContext->LocalToString(params[1], &file);
+	float seconds = sp_ctof(params[2]);
 
-		IChangeableForward *forward = forwards->CreateForwardEx(nullptr, ET_Ignore, 3, nullptr, Param_Cell, Param_Cell, Param_Any);
-		if (forward == nullptr || !forward->AddFunction(callback))
-		{
-			return pContext->ThrowNativeError("Could not create forward.");
-		}
+	if (seconds <= 0.0f || seconds > 600.0f) {
+		pContext->ReportError("Invalid trace length %f, must be between 0 and 600 seconds", seconds);
+		return 0;
+	}
 
-		cell_t data = params[4];
-		return discord->GetChannel(channelFlake, forward, data);
+	char path[PLATFORM_MAX_PATH];
+	smutils->BuildPath(Path_SM, path, sizeof(path), "%s", file);
+
+	std::string error;
+	if (!g_EventTrace.Start(path, seconds, error)) {
+		smutils->LogError(myself, "Could not start tracing: %s", error.c_str());
+		return 0;
 	}
-	catch (const std::exception& e) {
-		pContext->ReportError("Invalid channel ID format: %s", channelId);
+	return 1;
+}
+
+static cell_t discord_SetPluginBudget(IPluginContext* pContext, const cell_t* params)
+{
+	float milliseconds = sp_ctof(params[1]);
+	if (milliseconds < 0.0f) {
+		pContext->ReportError("Invalid budget %f, must not be negative", milliseconds);
 		return 0;
 	}
+
+	g_PluginProfiler.SetBudget(milliseconds / 1000.0);
+	return 0;
 }
 
-static cell_t discord_IsRunning(IPluginContext* pContext, const cell_t* params)
+static cell_t discord_SetMetricsDump(IPluginContext* pContext, const cell_t* params)
 {
-	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
-	if (!discord) {
+	char* file;
+	pContext->LocalToString(params[1], &file);
+	float interval = sp_ctof(params[2]);
+
+	if (!file[0]) {
+		g_MetricsDump.Set("", 0.0);
+		return 0;
+	}
+	if (interval < 1.0f) {
+		pContext->ReportError("Invalid interval %f, must be at least 1 second", interval);
 		return 0;
 	}
 
-	return discord->IsRunning() ? 1 : 0;
+	char path[PLATFORM_MAX_PATH];
+	smutils->BuildPath(Path_SM, path, sizeof(path), "%s", file);
+	g_MetricsDump.Set(path, interval);
+	return 0;
 }
 
 bool DiscordClient::RegisterSlashCommand(dpp::snowflake guild_id, const char* name, const char* description, const char* default_permissions)
@@ -992,9 +2337,9 @@ static cell_t discord_RegisterGlobalSlashCommand(IPluginContext* pContext, const
 	return discord->RegisterGlobalSlashCommand(name, description, permissions) ? 1 : 0;
 }
 
-void DiscordClient::CreateAutocompleteResponse(dpp::snowflake id, const std::string &token, const dpp::interaction_response &response)
+void DiscordClient::CreateAutocompleteResponse(dpp::snowflake id, const std::string &token, const dpp::interaction_response &response, dpp::command_completion_event_t callback)
 {
-	m_cluster->interaction_response_create(id, token, response);
+	m_cluster->interaction_response_create(id, token, response, std::move(callback));
 }
 
 bool DiscordClient::EditMessage(dpp::snowflake channel_id, dpp::snowflake message_id, const char* content)
@@ -1028,8 +2373,8 @@ bool DiscordClient::EditMessageEmbed(dpp::snowflake channel_id, dpp::snowflake m
 		msg.id = message_id;
 		msg.channel_id = channel_id;
 		msg.content = content;
-		msg.add_embed(embed->GetEmbed());
-		m_cluster->message_edit(msg);
+		m_cluster->post_rest_multipart(API_PATH "/channels", std::to_string(channel_id), "messages/" + std::to_string(message_id), dpp::m_patch,
+			embed->BuildMessageJson(msg, true), nullptr, msg.file_data);
 		return true;
 	}
 	catch (const std::exception& e) {
@@ -1054,6 +2399,191 @@ bool DiscordClient::DeleteMessage(dpp::snowflake channel_id, dpp::snowflake mess
 	}
 }
 
+// Discord only bulk deletes messages younger than 14 days, keep a margin for requests still waiting in the queue
+static constexpr double BULK_DELETE_MAX_AGE = 14 * 24 * 60 * 60 - 60;
+static constexpr size_t BULK_DELETE_MAX_IDS = 100;
+
+void DiscordClient::DeleteMessageBatch(dpp::snowflake channel_id, const std::vector<dpp::snowflake>& message_ids, std::function<void(size_t)> done)
+{
+	double cutoff = dpp::utility::time_f() - BULK_DELETE_MAX_AGE;
+
+	std::vector<dpp::snowflake> recent;
+	std::vector<dpp::snowflake> old;
+	for (const auto& id : message_ids) {
+		(id.get_creation_time() > cutoff ? recent : old).push_back(id);
+	}
+
+	// Group into requests: up to 100 recent messages per bulk delete, and one request per old message
+	std::vector<std::vector<dpp::snowflake>> requests;
+	for (size_t i = 0; i < recent.size(); i += BULK_DELETE_MAX_IDS) {
+		requests.emplace_back(recent.begin() + i, recent.begin() + std::min(i + BULK_DELETE_MAX_IDS, recent.size()));
+	}
+	for (const auto& id : old) {
+		requests.push_back({id});
+	}
+
+	if (requests.empty()) {
+		done(0);
+		return;
+	}
+
+	struct BatchState {
+		std::atomic<size_t> remaining;
+		std::atomic<size_t> deleted;
+		std::function<void(size_t)> done;
+	};
+	auto batch = std::make_shared<BatchState>();
+	batch->remaining = requests.size();
+	batch->deleted = 0;
+	batch->done = std::move(done);
+
+	for (auto& ids : requests) {
+		size_t count = ids.size();
+		auto callback = [batch, count](const dpp::confirmation_callback_t& callback) {
+			if (callback.is_error()) {
+				smutils->LogError(myself, "Failed to delete messages: %s", callback.get_error().message.c_str());
+			} else {
+				batch->deleted += count;
+			}
+			if (--batch->remaining == 0) {
+				batch->done(batch->deleted);
+			}
+		};
+
+		// Bulk delete needs at least two messages
+		if (count == 1) {
+			m_cluster->message_delete(ids[0], channel_id, callback);
+		} else {
+			m_cluster->message_delete_bulk(ids, channel_id, callback);
+		}
+	}
+}
+
+bool DiscordClient::BulkDeleteMessages(dpp::snowflake channel_id, const std::vector<dpp::snowflake>& message_ids)
+{
+	if (!m_isRunning) {
+		return false;
+	}
+
+	try {
+		DeleteMessageBatch(channel_id, message_ids, [](size_t) {});
+		return true;
+	}
+	catch (const std::exception& e) {
+		smutils->LogError(myself, "Failed to bulk delete messages: %s", e.what());
+		return false;
+	}
+}
+
+struct DiscordClient::PurgeState {
+	dpp::snowflake channel_id;
+	dpp::snowflake before = 0;
+	int limit;
+	dpp::snowflake author_id;
+	std::string contains;
+	int scanned = 0;
+	int deleted = 0;
+	IChangeableForward* forward;
+	cell_t data;
+};
+
+bool DiscordClient::PurgeMessages(dpp::snowflake channel_id, int limit, dpp::snowflake author_id, const char* contains, IChangeableForward *callback_forward, cell_t data)
+{
+	if (!m_isRunning) {
+		return false;
+	}
+
+	auto state = std::make_shared<PurgeState>();
+	state->channel_id = channel_id;
+	state->limit = limit;
+	state->author_id = author_id;
+	state->contains = contains;
+	state->forward = callback_forward;
+	state->data = data;
+
+	try {
+		PurgePage(state);
+		return true;
+	}
+	catch (const std::exception& e) {
+		smutils->LogError(myself, "Failed to purge messages: %s", e.what());
+		return false;
+	}
+}
+
+void DiscordClient::PurgePage(std::shared_ptr<PurgeState> state)
+{
+	// Page backwards through the channel history, newest first
+	m_cluster->messages_get(state->channel_id, 0, state->before, 0, BULK_DELETE_MAX_IDS, [this, state](const dpp::confirmation_callback_t& callback) {
+		if (callback.is_error()) {
+			smutils->LogError(myself, "Failed to get messages to purge: %s", callback.get_error().message.c_str());
+			ReportPurgeProgress(state, true);
+			return;
+		}
+
+		auto messages = callback.get<dpp::message_map>();
+		std::vector<dpp::snowflake> page;
+		page.reserve(messages.size());
+		for (const auto& [id, msg] : messages) {
+			page.push_back(id);
+		}
+		std::sort(page.begin(), page.end(), std::greater<dpp::snowflake>());
+
+		std::vector<dpp::snowflake> matched;
+		bool limitReached = false;
+		for (const auto& id : page) {
+			if (state->limit > 0 && state->deleted + (int)matched.size() >= state->limit) {
+				limitReached = true;
+				break;
+			}
+
+			const dpp::message& msg = messages.at(id);
+			state->scanned++;
+			state->before = id;
+
+			if (state->author_id && msg.author.id != state->author_id) {
+				continue;
+			}
+			if (!state->contains.empty() && msg.content.find(state->contains) == std::string::npos) {
+				continue;
+			}
+			matched.push_back(id);
+		}
+
+		bool more = !limitReached && page.size() == BULK_DELETE_MAX_IDS;
+
+		DeleteMessageBatch(state->channel_id, matched, [this, state, more](size_t deleted) {
+			state->deleted += (int)deleted;
+			if (more && m_isRunning) {
+				ReportPurgeProgress(state, false);
+				PurgePage(state);
+			} else {
+				ReportPurgeProgress(state, true);
+			}
+		});
+	});
+}
+
+void DiscordClient::ReportPurgeProgress(std::shared_ptr<PurgeState> state, bool finished)
+{
+	g_TaskQueue.Push([this, forward = state->forward, channelId = std::to_string(state->channel_id), deleted = state->deleted, scanned = state->scanned, finished, value = state->data]() {
+		if (forward && forward->GetFunctionCount() > 0)
+		{
+			forward->PushCell(m_discord_handle);
+			forward->PushString(channelId.c_str());
+			forward->PushCell(deleted);
+			forward->PushCell(scanned);
+			forward->PushCell(finished);
+			forward->PushCell(value);
+			g_PluginProfiler.ExecuteCallback(forward);
+		}
+
+		if (finished) {
+			g_PluginProfiler.ReleaseCallback(forward);
+		}
+	});
+}
+
 static cell_t discord_EditMessage(IPluginContext* pContext, const cell_t* params)
 {
 	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
@@ -1110,6 +2640,84 @@ static cell_t discord_EditMessageEmbed(IPluginContext* pContext, const cell_t* p
 	}
 }
 
+static cell_t discord_BulkDeleteMessages(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	char* channelId;
+	pContext->LocalToString(params[2], &channelId);
+
+	cell_t* ids_array;
+	pContext->LocalToPhysAddr(params[3], &ids_array);
+
+	std::vector<dpp::snowflake> messages;
+	messages.reserve(params[4]);
+
+	try {
+		dpp::snowflake channel = std::stoull(channelId);
+
+		for (int i = 0; i < params[4]; i++) {
+			char* str;
+			pContext->LocalToString(ids_array[i], &str);
+			messages.push_back(std::stoull(str));
+		}
+
+		return discord->BulkDeleteMessages(channel, messages) ? 1 : 0;
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid ID format");
+		return 0;
+	}
+}
+
+static cell_t discord_PurgeMessages(IPluginContext* pContext, const cell_t* params)
+{
+	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
+	if (!discord) {
+		return 0;
+	}
+
+	char* channelId;
+	pContext->LocalToString(params[2], &channelId);
+
+	char* authorId;
+	pContext->LocalToString(params[6], &authorId);
+
+	char* contains;
+	pContext->LocalToString(params[7], &contains);
+
+	dpp::snowflake channel;
+	dpp::snowflake author = 0;
+	try {
+		channel = std::stoull(channelId);
+		if (authorId[0] != '\0') {
+			author = std::stoull(authorId);
+		}
+	}
+	catch (const std::exception& e) {
+		pContext->ReportError("Invalid ID format");
+		return 0;
+	}
+
+	IPluginFunction *callback = pContext->GetFunctionById(params[4]);
+
+	IChangeableForward *forward = forwards->CreateForwardEx(nullptr, ET_Ignore, 6, nullptr, Param_Cell, Param_String, Param_Cell, Param_Cell, Param_Cell, Param_Any);
+	if (forward == nullptr || !forward->AddFunction(callback))
+	{
+		return pContext->ThrowNativeError("Could not create forward.");
+	}
+	g_PluginProfiler.AddCallback(forward, pContext, "PurgeMessages");
+
+	if (!discord->PurgeMessages(channel, params[3], author, contains, forward, params[5])) {
+		g_PluginProfiler.ReleaseCallback(forward);
+		return 0;
+	}
+	return 1;
+}
+
 static cell_t discord_DeleteMessage(IPluginContext* pContext, const cell_t* params)
 {
 	DiscordClient* discord = g_DiscordHandler.ReadHandle(params[1]);
@@ -1384,6 +2992,26 @@ static cell_t discord_BulkDeleteGlobalCommands(IPluginContext* pContext, const c
 	}
 }
 
+static cell_t discord_GetConnectionStats(IPluginContext* pContext, const cell_t* params)
+{
+	dpp::connection_stats stats = dpp::get_connection_stats();
+
+	cell_t* opened;
+	cell_t* reused;
+	cell_t* tlsResumed;
+	cell_t* tlsFull;
+	pContext->LocalToPhysAddr(params[1], &opened);
+	pContext->LocalToPhysAddr(params[2], &reused);
+	pContext->LocalToPhysAddr(params[3], &tlsResumed);
+	pContext->LocalToPhysAddr(params[4], &tlsFull);
+
+	*opened = static_cast<cell_t>(stats.opened);
+	*reused = static_cast<cell_t>(stats.reused);
+	*tlsResumed = static_cast<cell_t>(stats.tls_resumed);
+	*tlsFull = static_cast<cell_t>(stats.tls_full);
+	return 1;
+}
+
 const sp_nativeinfo_t discord_natives[] = {
 	// Discord
 	{"Discord.Discord",          discord_CreateClient},
@@ -1400,17 +3028,55 @@ const sp_nativeinfo_t discord_natives[] = {
 	{"Discord.SendMessage",      discord_SendMessage},
 	{"Discord.SendMessageEmbed", discord_SendMessageEmbed},
 	{"Discord.GetChannel", discord_GetChannel},
+	{"Discord.GetMember", discord_GetMember},
+	{"Discord.EnableLazyMembers", discord_EnableLazyMembers},
+	{"Discord.GetUser", discord_GetUser},
+	{"Discord.GetGuild", discord_GetGuild},
+	{"Discord.GetRole", discord_GetRole},
+	{"Discord.FindChannel", discord_FindChannel},
+	{"Discord.FindUser", discord_FindUser},
+	{"Discord.FindGuild", discord_FindGuild},
+	{"Discord.FindRole", discord_FindRole},
+	{"Discord.FindMember", discord_FindMember},
+	{"Discord.FindMemberPermissions", discord_FindMemberPermissions},
 	{"Discord.IsRunning",        discord_IsRunning},
+	{"Discord.SetSessionResume", discord_SetSessionResume},
+	{"Discord.SetCacheSnapshot", discord_SetCacheSnapshot},
+	{"Discord.GetShardCount",    discord_GetShardCount},
+	{"Discord.GetClusterId",     discord_GetClusterId},
+	{"Discord.GetMaxClusters",   discord_GetMaxClusters},
+	{"Discord.GetLocalShards",   discord_GetLocalShards},
+	{"Discord.GetShardState",    discord_GetShardState},
+	{"Discord.GetShardLatency",  discord_GetShardLatency},
+	{"Discord.GetRestPing",       discord_GetRestPing},
+	{"Discord.GetShardBytesIn",   discord_GetShardBytesIn},
+	{"Discord.GetShardReconnects", discord_GetShardReconnects},
+	{"Discord.GetShardResumes",   discord_GetShardResumes},
+	{"Discord.GetShardLastEventAge", discord_GetShardLastEventAge},
+	{"Discord.GetShardEventRate", discord_GetShardEventRate},
+	{"Discord.GetShardEventCount", discord_GetShardEventCount},
+	{"Discord.GetCacheStat", discord_GetCacheStat},
+	{"Discord.GetMemberCacheStat", discord_GetMemberCacheStat},
+	{"Discord.GetGCStat", discord_GetGCStat},
+	{"Discord.GetMetric", discord_GetMetric},
+	{"Discord.GetMetricQuantile", discord_GetMetricQuantile},
+	{"Discord.GetMetricsSnapshot", discord_GetMetricsSnapshot},
+	{"Discord.SetMetricsDump", discord_SetMetricsDump},
+	{"Discord.StartTrace", discord_StartTrace},
+	{"Discord.SetPluginBudget", discord_SetPluginBudget},
 	{"Discord.RegisterSlashCommand", discord_RegisterSlashCommand},
 	{"Discord.RegisterGlobalSlashCommand", discord_RegisterGlobalSlashCommand},
 	{"Discord.EditMessage", discord_EditMessage},
 	{"Discord.EditMessageEmbed", discord_EditMessageEmbed},
 	{"Discord.DeleteMessage", discord_DeleteMessage},
+	{"Discord.BulkDeleteMessages", discord_BulkDeleteMessages},
+	{"Discord.PurgeMessages", discord_PurgeMessages},
 	{"Discord.RegisterSlashCommandWithOptions", discord_RegisterSlashCommandWithOptions},
   	{"Discord.RegisterGlobalSlashCommandWithOptions", discord_RegisterGlobalSlashCommandWithOptions},
 	{"Discord.DeleteGuildCommand", discord_DeleteGuildCommand},
   	{"Discord.DeleteGlobalCommand", discord_DeleteGlobalCommand},
   	{"Discord.BulkDeleteGuildCommands", discord_BulkDeleteGuildCommands},
   	{"Discord.BulkDeleteGlobalCommands", discord_BulkDeleteGlobalCommands},
+	{"Discord.GetConnectionStats", discord_GetConnectionStats},
 	{nullptr, nullptr}
 };
\ No newline at end of file
@@ -1,7 +1,10 @@
 #ifndef _INCLUDE_DISCORD_H_
 #define _INCLUDE_DISCORD_H_
 
+#include <set>
 #include "object_handler.h"
+#include "member_cache.h"
+#include "cache_snapshot.h"
 #include "smsdk_ext.h"
 #include "types/embed.h"
 
@@ -10,9 +13,22 @@ class DiscordClient : public DiscordObject
 private:
 	std::unique_ptr<dpp::cluster> m_cluster;
 	bool m_isRunning;
+	std::atomic<bool> m_shardsStarted;
 	Handle_t m_discord_handle;
 	std::unique_ptr<std::thread> m_thread;
 
+	bool m_resumeSessions;
+	std::string m_sessionPath;
+	std::mutex m_restoredMutex;
+	std::set<uint32_t> m_restoredShards;
+
+	bool m_lazyMembers;
+	MemberCache m_members;
+
+	bool m_cacheSnapshot;
+	std::string m_snapshotPath;
+	CacheSnapshot m_snapshot;
+
 	std::string m_botId;
 	std::string m_botName;
 	std::string m_botDiscriminator;
@@ -20,15 +36,42 @@ private:
 
 	void RunBot();
 	void SetupEventHandlers();
+	void RestoreSessions();
+	void SaveSessions(const std::vector<dpp::shard_session>& sessions);
+	void LoadCacheSnapshot();
+	void SaveCacheSnapshot(uint32_t maxShards, const std::vector<uint32_t>& shards);
+	void DeliverMember(const MemberCache::Entry* entry, IForward* callback_forward, cell_t data);
+
+	struct PurgeState;
+	void DeleteMessageBatch(dpp::snowflake channel_id, const std::vector<dpp::snowflake>& message_ids, std::function<void(size_t)> done);
+	void PurgePage(std::shared_ptr<PurgeState> state);
+	void ReportPurgeProgress(std::shared_ptr<PurgeState> state, bool finished);
 
 public:
-	DiscordClient(const char* token);
+	DiscordClient(const char* token, bool sharedPool = false, dpp::websocket_protocol_t protocol = dpp::ws_json, uint32_t shardCount = 0, uint32_t clusterId = 0, uint32_t maxClusters = 1);
 	~DiscordClient();
 
+	static void FreeSharedRequestQueues();
+	static const std::vector<DiscordClient*>& GetClients();
+
 	bool Initialize();
 	void Start();
 	void Stop();
 	bool IsRunning() const { return m_isRunning; }
+	void SetSessionResume(bool enable) { m_resumeSessions = enable; }
+	void SetCacheSnapshot(bool enable) { m_cacheSnapshot = enable; }
+	size_t GetStaleGuildCount() const { return m_snapshot.StaleCount(); }
+	bool EnableLazyMembers(size_t capacity);
+	bool IsLazyMembers() const { return m_lazyMembers; }
+	size_t GetMemberCacheSize() const { return m_members.Size(); }
+	size_t GetMemberCacheCapacity() const { return m_members.GetCapacity(); }
+	MemberCache::Stats GetMemberCacheStats() const { return m_members.GetStats(); }
+	uint32_t GetShardCount() const;
+	uint32_t GetClusterId() const { return m_cluster ? m_cluster->cluster_id : 0; }
+	uint32_t GetMaxClusters() const { return m_cluster ? m_cluster->maxclusters : 1; }
+	std::vector<uint32_t> GetLocalShards() const;
+	dpp::discord_client* GetShard(uint32_t shard_id) const;
+	double GetRestPing() const { return m_cluster ? m_cluster->rest_ping : 0.0; }
 	void SetHandle(Handle_t handle) { m_discord_handle = handle; }
 	bool SetPresence(dpp::presence presence);
 	bool CreateWebhook(dpp::webhook wh, IForward *callback_forward, cell_t data);
@@ -36,15 +79,22 @@ public:
 	bool SendMessage(dpp::snowflake channel_id, const char* message, int allowed_mentions_mask, std::vector<dpp::snowflake> users, std::vector<dpp::snowflake> roles);
 	bool SendMessageEmbed(dpp::snowflake channel_id, const char* message, const DiscordEmbed* embed, int allowed_mentions_mask, std::vector<dpp::snowflake> users, std::vector<dpp::snowflake> roles);
 	bool GetChannel(dpp::snowflake channel_id, IForward *callback_forward, cell_t data);
+	bool GetMember(dpp::snowflake guild_id, dpp::snowflake user_id, IForward *callback_forward, cell_t data);
+	bool GetUser(dpp::snowflake user_id, IForward *callback_forward, cell_t data);
+	bool GetGuild(dpp::snowflake guild_id, IForward *callback_forward, cell_t data);
+	bool GetRole(dpp::snowflake guild_id, dpp::snowflake role_id, IForward *callback_forward, cell_t data);
+	bool FindMember(dpp::snowflake guild_id, dpp::snowflake user_id, MemberCache::Entry& entry);
 	bool GetChannelWebhooks(dpp::snowflake channel_id, IForward *callback_forward, cell_t data);
     bool RegisterSlashCommand(dpp::snowflake guild_id, const char* name, const char* description, const char* default_permissions);
 	bool RegisterGlobalSlashCommand(const char* name, const char* description, const char* default_permissions);
 	bool RegisterSlashCommandWithOptions(dpp::snowflake guild_id, const char* name, const char* description, const char* default_permisssions, const std::vector<dpp::command_option>& options);
 	bool RegisterGlobalSlashCommandWithOptions(const char* name, const char* description, const char* default_permissions, const std::vector<dpp::command_option>& options);
-	void CreateAutocompleteResponse(dpp::snowflake id, const std::string &token, const dpp::interaction_response &response);
+	void CreateAutocompleteResponse(dpp::snowflake id, const std::string &token, const dpp::interaction_response &response, dpp::command_completion_event_t callback = {});
 	bool EditMessage(dpp::snowflake channel_id, dpp::snowflake message_id, const char* content);
 	bool EditMessageEmbed(dpp::snowflake channel_id, dpp::snowflake message_id, const char* content, const DiscordEmbed* embed);
 	bool DeleteMessage(dpp::snowflake channel_id, dpp::snowflake message_id);
+	bool BulkDeleteMessages(dpp::snowflake channel_id, const std::vector<dpp::snowflake>& message_ids);
+	bool PurgeMessages(dpp::snowflake channel_id, int limit, dpp::snowflake author_id, const char* contains, IChangeableForward *callback_forward, cell_t data);
 	bool DeleteGuildCommand(dpp::snowflake guild_id, dpp::snowflake command_id);
 	bool DeleteGlobalCommand(dpp::snowflake command_id);
 	bool BulkDeleteGuildCommands(dpp::snowflake guild_id);
@@ -67,4 +117,7 @@ public:
 
 inline DiscordObjectHandler<DiscordClient> g_DiscordHandler;
 
+// Counters for one of DPP's global caches, numbered as DiscordCache in discord.inc
+bool GetGlobalCacheStats(int cache, dpp::cache_stats& stats);
+
 #endif // _INCLUDE_DISCORD_H_ 
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include "event_trace.h"
+
+EventTrace g_EventTrace;
+
+bool EventTrace::Start(const std::string& path, double seconds, std::string& error)
+{
+	if (m_recording.load()) {
+		error = "a trace is already being recorded to " + m_path;
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_generation++;
+		m_events.clear();
+		m_stages.clear();
+	}
+	dpp::discord_client::set_frame_timing(true);
+	m_responses = 0;
+	m_path = path;
+	m_start = dpp::utility::time_f();
+	m_sampleEnd = m_start + seconds;
+	m_frameStart = m_start;
+	m_recording = true;
+	m_sampling = true;
+	return true;
+}
+
+TracedEvent EventTrace::Begin(const char* event, const dpp::discord_client* shard)
+{
+	TracedEvent traced;
+	if (!m_sampling.load(std::memory_order_relaxed)) {
+		return traced;
+	}
+
+	traced.time = dpp::utility::time_f();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_sampling.load(std::memory_order_relaxed) || m_events.size() >= MAX_EVENTS) {
+		return TracedEvent();
+	}
+	m_events.push_back({event, shard ? shard->shard_id : 0});
+	uint64_t index = m_events.size();
+	traced.id = (static_cast<uint64_t>(m_generation) << 32) | index;
+
+	// Stamped by DPP while it handles the frame this handler is called from
+	if (shard && shard->frame_received != 0.0) {
+		m_stages.push_back({index, 0, "parse", shard->frame_received, shard->frame_parsed});
+		m_stages.push_back({index, 0, "dispatch", shard->frame_parsed, traced.time});
+	}
+	return traced;
+}
+
+TracedEvent EventTrace::Queue(const TracedEvent& traced)
+{
+	if (!traced.id) {
+		return traced;
+	}
+	TracedEvent queued = {traced.id, dpp::utility::time_f()};
+	Record(traced.id, "handler", traced.time, queued.time);
+	return queued;
+}
+
+void EventTrace::Run(const TracedEvent& traced, double start, double end)
+{
+	if (!traced.id) {
+		return;
+	}
+	// Queued before this frame began, so it waited for the frame and then for the tasks ahead of it
+	if (m_frameStart > traced.time && m_frameStart < start) {
+		Record(traced.id, "wait for frame", traced.time, m_frameStart);
+		Record(traced.id, "wait in queue", m_frameStart, start);
+	} else {
+		Record(traced.id, "wait in queue", traced.time, start);
+	}
+	Record(traced.id, "forward", start, end);
+}
+
+dpp::command_completion_event_t EventTrace::Response(uint64_t id)
+{
+	if (!id || !m_recording.load(std::memory_order_relaxed)) {
+		return dpp::command_completion_event_t();
+	}
+	uint32_t response = ++m_responses;
+	return [this, id, response, queued = dpp::utility::time_f()](const dpp::confirmation_callback_t&) {
+		Record(id, "response", queued, dpp::utility::time_f(), response);
+	};
+}
+
+void EventTrace::Record(uint64_t id, const char* name, double start, double end, uint32_t response)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint64_t index = Index(id);
+	if (m_recording.load(std::memory_order_relaxed) && index) {
+		m_stages.push_back({index, response, name, start, end});
+	}
+}
+
+uint64_t EventTrace::Index(uint64_t id) const
+{
+	// 0 for an event of an earlier trace, or one this trace doesn't have
+	uint64_t index = id & 0xFFFFFFFF;
+	if ((id >> 32) != m_generation || index > m_events.size()) {
+		return 0;
+	}
+	return index;
+}
+
+int EventTrace::Think(std::string& error)
+{
+	if (!m_recording.load(std::memory_order_relaxed)) {
+		return 0;
+	}
+
+	double now = dpp::utility::time_f();
+	m_frameStart = now;
+	if (now >= m_sampleEnd && m_sampling.load(std::memory_order_relaxed)) {
+		m_sampling = false;
+		dpp::discord_client::set_frame_timing(false);
+	}
+	if (now < m_sampleEnd + RESPONSE_GRACE) {
+		return 0;
+	}
+
+	m_recording = false;
+	bool written = Write(error);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	int count = static_cast<int>(m_events.size());
+	std::vector<Event>().swap(m_events);
+	std::vector<Stage>().swap(m_stages);
+	return written ? count : -1;
+}
+
+bool EventTrace::Write(std::string& error)
+{
+	struct Entry {
+		double ts;
+		int order;
+		uint64_t id;
+		uint32_t response;
+		const char* name;
+		char phase;
+	};
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Each event spans from its first stage to its last, with the stages nested inside. At the same
+	// time a stage ends before the next begins, and one that takes no time stays in recorded order.
+	std::vector<double> first(m_events.size() + 1, 0.0);
+	std::vector<double> last(m_events.size() + 1, 0.0);
+	std::vector<Entry> entries;
+	entries.reserve(m_stages.size() * 2 + m_events.size() * 2);
+	for (const Stage& stage : m_stages) {
+		// Record only keeps stages of this trace's events, but the indexes below must never run off the end
+		if (!stage.id || stage.id > m_events.size()) {
+			continue;
+		}
+		if (!stage.response) {
+			if (!first[stage.id] || stage.start < first[stage.id]) {
+				first[stage.id] = stage.start;
+			}
+			last[stage.id] = std::max(last[stage.id], stage.end);
+		}
+		entries.push_back({stage.start, 2, stage.id, stage.response, stage.name, 'b'});
+		entries.push_back({stage.end, stage.end > stage.start ? 1 : 2, stage.id, stage.response, stage.name, 'e'});
+	}
+	for (uint64_t id = 1; id <= m_events.size(); id++) {
+		if (first[id]) {
+			entries.push_back({first[id], 0, id, 0, m_events[id - 1].name, 'b'});
+			entries.push_back({last[id], 4, id, 0, m_events[id - 1].name, 'e'});
+		}
+	}
+	std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+		return a.ts < b.ts || (a.ts == b.ts && a.order < b.order);
+	});
+
+	std::ofstream out(m_path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		error = "could not open " + m_path;
+		return false;
+	}
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	char line[256];
+	char id[32];
+	for (size_t i = 0; i < entries.size(); i++) {
+		const Entry& entry = entries[i];
+		if (entry.response) {
+			snprintf(id, sizeof(id), "\"%" PRIu64 ".%u\"", entry.id, entry.response);
+		} else {
+			snprintf(id, sizeof(id), "%" PRIu64, entry.id);
+		}
+		snprintf(line, sizeof(line), "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"id\":%s,\"ts\":%.3f,\"pid\":1,\"tid\":%u}%s\n",
+			entry.name,
+			m_events[entry.id - 1].name,
+			entry.phase,
+			id,
+			(entry.ts - m_start) * 1e6,
+			m_events[entry.id - 1].shard,
+			i + 1 < entries.size() ? "," : "");
+		out << line;
+	}
+	out << "]}\n";
+	if (!out) {
+		error = "could not write " + m_path;
+		return false;
+	}
+	return true;
+}
+
+TraceRun::~TraceRun()
+{
+	if (m_traced.id) {
+		g_EventTrace.Run(m_traced, m_start, dpp::utility::time_f());
+	}
+}
@@ -0,0 +1,156 @@
+#ifndef _INCLUDE_EVENT_TRACE_H
+#define _INCLUDE_EVENT_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "dpp/dpp.h"
+
+/**
+ * @brief A traced event as it passes from a shard thread to the main thread.
+ *
+ * An ID of 0 means the event is not traced, and every step is skipped. The upper 32 bits
+ * of an ID are the trace it belongs to, so stages which arrive after a later trace has
+ * started, such as a late reply, are dropped instead of landing on another event.
+ */
+struct TracedEvent {
+	uint64_t id = 0;
+	double time = 0.0;
+};
+
+/**
+ * @brief Records how long each stage of handling an event takes, for a window of time,
+ * and writes it as a Chrome trace that chrome://tracing or Perfetto can open.
+ *
+ * The stages of an event are:
+ * - parse: the gateway frame is received, decompressed and parsed by DPP;
+ * - dispatch: DPP builds the event and calls its handlers;
+ * - handler: the extension's handler runs and queues a task;
+ * - wait for frame: the task waits for the next game frame;
+ * - wait in queue: the task waits behind other tasks within frames;
+ * - forward: the task runs, calling the plugins' forward;
+ * - response: a reply made from the forward goes to REST until Discord acknowledges it.
+ *
+ * Each event is one async track, named after the event and spanning every stage up to the
+ * end of its forward. Replies can outlive the forward, so each has a track of its own.
+ */
+class EventTrace {
+public:
+	/**
+	 * @brief Starts tracing events.
+	 *
+	 * @param path File to write the trace to once the window closes.
+	 * @param seconds Length of the window in which new events are traced.
+	 * @param[out] error Reason, on failure.
+	 * @return True on success, false if a trace is already running.
+	 */
+	bool Start(const std::string& path, double seconds, std::string& error);
+
+	/**
+	 * @brief Starts tracing an event. Called from the event's handler on the shard thread.
+	 *
+	 * @param event Event name, which must outlive the trace, e.g. a literal.
+	 * @param shard Shard which received the event.
+	 * @return The traced event, or one with ID 0 if tracing is off or the trace is full.
+	 */
+	TracedEvent Begin(const char* event, const dpp::discord_client* shard);
+
+	/**
+	 * @brief Records the handler queueing the event's task.
+	 *
+	 * @param traced Event from Begin.
+	 * @return The traced event, timed from being queued.
+	 */
+	TracedEvent Queue(const TracedEvent& traced);
+
+	/**
+	 * @brief Records the event's task running on the main thread.
+	 *
+	 * @param traced Event from Queue.
+	 * @param start Time the task was taken from the queue.
+	 * @param end Time the task finished.
+	 */
+	void Run(const TracedEvent& traced, double start, double end);
+
+	/**
+	 * @brief Makes a completion callback which records a reply to the event.
+	 *
+	 * @param id ID of the traced event.
+	 * @return Callback to pass to the REST call, or an empty one if the event is not traced.
+	 */
+	dpp::command_completion_event_t Response(uint64_t id);
+
+	/**
+	 * @brief Notes the start of a game frame and writes the trace once it is done.
+	 *
+	 * Called first thing every frame. New events stop being traced when the window closes,
+	 * and the trace is written a few seconds later, so that replies to the last events are included.
+	 *
+	 * @param[out] error Reason, on failure.
+	 * @return Number of events written, 0 while tracing or idle, or -1 on failure.
+	 */
+	int Think(std::string& error);
+
+	/**
+	 * @brief Gets the file of the trace being recorded.
+	 */
+	const std::string& GetPath() const { return m_path; }
+
+private:
+	struct Event {
+		const char* name;
+		uint32_t shard;
+	};
+
+	struct Stage {
+		uint64_t id;
+		uint32_t response;
+		const char* name;
+		double start;
+		double end;
+	};
+
+	void Record(uint64_t id, const char* name, double start, double end, uint32_t response = 0);
+	uint64_t Index(uint64_t id) const;
+	bool Write(std::string& error);
+
+	static constexpr size_t MAX_EVENTS = 20000;
+	static constexpr double RESPONSE_GRACE = 5.0;
+
+	std::atomic<bool> m_sampling{false};
+	std::atomic<bool> m_recording{false};
+	std::atomic<uint32_t> m_responses{0};
+	std::mutex m_mutex;
+	uint32_t m_generation = 0;
+	std::vector<Event> m_events;
+	std::vector<Stage> m_stages;
+
+	// Main thread only
+	std::string m_path;
+	double m_start = 0.0;
+	double m_sampleEnd = 0.0;
+	double m_frameStart = 0.0;
+};
+
+/**
+ * @brief Times the main thread side of one traced event.
+ */
+class TraceRun {
+private:
+	TracedEvent m_traced;
+	double m_start;
+
+public:
+	explicit TraceRun(const TracedEvent& traced) : m_traced(traced), m_start(traced.id ? dpp::utility::time_f() : 0.0) {}
+
+	~TraceRun();
+
+	TraceRun(const TraceRun&) = delete;
+	TraceRun& operator=(const TraceRun&) = delete;
+};
+
+extern EventTrace g_EventTrace;
+
+#endif //_INCLUDE_EVENT_TRACE_H
@@ -1,9 +1,14 @@
 #include "extension.h"
+#include "console.h"
+#include "metrics.h"
+#include "event_trace.h"
 #include "types/webhook.h"
 #include "types/channel.h"
 #include "types/embed.h"
 #include "types/message.h"
 #include "types/user.h"
+#include "types/guild.h"
+#include "types/role.h"
 #include "types/interaction.h"
 #include "types/autocomplete_interaction.h"
 
@@ -21,12 +26,66 @@ IForward* g_pForwardAutocomplete = nullptr;
 ThreadSafeQueue<std::function<void()>> g_TaskQueue;
 
 static void OnGameFrame(bool simulating) {
+	static MetricHistogram& pumpTime = g_Metrics.Histogram("discord_frame_pump_seconds", "", "Time spent running queued tasks in frames that had any");
+	static MetricCounter& tasksRun = g_Metrics.Counter("discord_tasks_run_total", "", "Queued tasks run on the main thread");
+	static MetricGauge& backlog = g_Metrics.Gauge("discord_task_queue_depth", "", "Tasks left queued for later frames");
+
+	std::string error;
+	int traced = g_EventTrace.Think(error);
+	if (traced > 0) {
+		smutils->LogMessage(myself, "Wrote %d traced events to %s", traced, g_EventTrace.GetPath().c_str());
+	} else if (traced < 0) {
+		smutils->LogError(myself, "Failed to write event trace: %s", error.c_str());
+	}
+
 	std::function<void()> task;
 	int count = 0;
-	while (g_TaskQueue.TryPop(task) && count < MAX_PROCESS) {
+	uint64_t start = MetricsRegistry::Now();
+	// Check the limit first, a task popped past it would be lost
+	while (count < MAX_PROCESS && g_TaskQueue.TryPop(task)) {
 		task();
 		count++;
 	}
+	if (count) {
+		pumpTime.Record(MetricsRegistry::Now() - start);
+		tasksRun.Add(count);
+	}
+	backlog.Set(count == MAX_PROCESS ? static_cast<int64_t>(g_TaskQueue.Size()) : 0);
+
+	if (!g_MetricsDump.Think(error)) {
+		smutils->LogError(myself, "Stopped writing metrics: %s", error.c_str());
+	}
+}
+
+// Called on the REST threads of every client
+static void OnRestRequest(const dpp::http_request& request, const dpp::http_request_completion_t& result)
+{
+	static const char* help = "REST requests by outcome";
+	static MetricCounter& failed = g_Metrics.Counter("discord_rest_requests_total", "status=\"error\"", help);
+	static MetricCounter& success = g_Metrics.Counter("discord_rest_requests_total", "status=\"2xx\"", help);
+	static MetricCounter& redirect = g_Metrics.Counter("discord_rest_requests_total", "status=\"3xx\"", help);
+	static MetricCounter& rateLimited = g_Metrics.Counter("discord_rest_requests_total", "status=\"429\"", help);
+	static MetricCounter& clientError = g_Metrics.Counter("discord_rest_requests_total", "status=\"4xx\"", help);
+	static MetricCounter& serverError = g_Metrics.Counter("discord_rest_requests_total", "status=\"5xx\"", help);
+	static MetricHistogram& latency = g_Metrics.Histogram("discord_rest_latency_seconds", "", "Time from connecting to the response of REST requests");
+
+	if (result.status < 100) {
+		failed.Add();
+	} else if (result.status < 300) {
+		success.Add();
+	} else if (result.status < 400) {
+		redirect.Add();
+	} else if (result.status == 429) {
+		rateLimited.Add();
+	} else if (result.status < 500) {
+		clientError.Add();
+	} else {
+		serverError.Add();
+	}
+
+	if (result.latency > 0.0) {
+		latency.Record(static_cast<uint64_t>(result.latency * 1e9));
+	}
 }
 
 bool DiscordExtension::SDK_OnLoad(char* error, size_t maxlen, bool late)
@@ -34,6 +93,8 @@ bool DiscordExtension::SDK_OnLoad(char* error, size_t maxlen, bool late)
 	sharesys->AddNatives(myself, discord_natives);
 	sharesys->AddNatives(myself, channel_natives);
 	sharesys->AddNatives(myself, user_natives);
+	sharesys->AddNatives(myself, guild_natives);
+	sharesys->AddNatives(myself, role_natives);
 	sharesys->AddNatives(myself, interaction_natives);
 	sharesys->AddNatives(myself, message_natives);
 	sharesys->AddNatives(myself, autocomplete_natives);
@@ -41,6 +102,10 @@ bool DiscordExtension::SDK_OnLoad(char* error, size_t maxlen, bool late)
 	sharesys->AddNatives(myself, webhook_natives);
 	sharesys->RegisterLibrary(myself, "discord");
 
+	/* Run every bot's gateway shards on one shared socket thread where supported */
+	dpp::socket_engine::set_enabled(true);
+	dpp::set_rest_observer(&OnRestRequest);
+
 	HandleAccess haDefaults;
 	handlesys->InitAccessDefaults(nullptr, &haDefaults);
 	haDefaults.access[HandleAccess_Delete] = 0;
@@ -49,6 +114,8 @@ bool DiscordExtension::SDK_OnLoad(char* error, size_t maxlen, bool late)
 	g_DiscordUserHandler.HandleType = handlesys->CreateType("DiscordUser", &g_DiscordUserHandler, 0, nullptr, &haDefaults, myself->GetIdentity(), nullptr);
 	g_DiscordMessageHandler.HandleType = handlesys->CreateType("DiscordMessage", &g_DiscordMessageHandler, 0, nullptr, &haDefaults, myself->GetIdentity(), nullptr);
 	g_DiscordChannelHandler.HandleType = handlesys->CreateType("DiscordChannel", &g_DiscordChannelHandler, 0, nullptr, &haDefaults, myself->GetIdentity(), nullptr);
+	g_DiscordGuildHandler.HandleType = handlesys->CreateType("DiscordGuild", &g_DiscordGuildHandler, 0, nullptr, &haDefaults, myself->GetIdentity(), nullptr);
+	g_DiscordRoleHandler.HandleType = handlesys->CreateType("DiscordRole", &g_DiscordRoleHandler, 0, nullptr, &haDefaults, myself->GetIdentity(), nullptr);
 	g_DiscordWebhookHandler.HandleType = handlesys->CreateType("DiscordWebhook", &g_DiscordWebhookHandler, 0, nullptr, &haDefaults, myself->GetIdentity(), nullptr);
 	g_DiscordEmbedHandler.HandleType = handlesys->CreateType("DiscordEmbed", &g_DiscordEmbedHandler, 0, nullptr, &haDefaults, myself->GetIdentity(), nullptr);
 	g_DiscordInteractionHandler.HandleType = handlesys->CreateType("DiscordInteraction", &g_DiscordInteractionHandler, 0, nullptr, &haDefaults, myself->GetIdentity(), nullptr);
@@ -62,6 +129,8 @@ bool DiscordExtension::SDK_OnLoad(char* error, size_t maxlen, bool late)
 
 	smutils->AddGameFrameHook(&OnGameFrame);
 
+	g_DiscordConsole.Register();
+
 	return true;
 }
 
@@ -77,11 +146,18 @@ void DiscordExtension::SDK_OnUnload()
 	handlesys->RemoveType(g_DiscordUserHandler.HandleType, myself->GetIdentity());
 	handlesys->RemoveType(g_DiscordMessageHandler.HandleType, myself->GetIdentity());
 	handlesys->RemoveType(g_DiscordChannelHandler.HandleType, myself->GetIdentity());
+	handlesys->RemoveType(g_DiscordGuildHandler.HandleType, myself->GetIdentity());
+	handlesys->RemoveType(g_DiscordRoleHandler.HandleType, myself->GetIdentity());
 	handlesys->RemoveType(g_DiscordWebhookHandler.HandleType, myself->GetIdentity());
 	handlesys->RemoveType(g_DiscordEmbedHandler.HandleType, myself->GetIdentity());
 	handlesys->RemoveType(g_DiscordInteractionHandler.HandleType, myself->GetIdentity());
 	handlesys->RemoveType(g_DiscordAutocompleteInteractionHandler.HandleType, myself->GetIdentity());
 
+	g_DiscordConsole.Unregister();
+
+	DiscordClient::FreeSharedRequestQueues();
+	dpp::set_rest_observer(nullptr);
+
 	smutils->RemoveGameFrameHook(&OnGameFrame);
 }
 
@@ -0,0 +1,200 @@
+#ifndef _INCLUDE_MEMBER_CACHE_H
+#define _INCLUDE_MEMBER_CACHE_H
+
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "dpp/dpp.h"
+
+/**
+ * @brief A bounded, thread-safe cache of guild members, evicting the least recently used.
+ *
+ * Used in place of DPP's member cache when members are loaded on demand, so that
+ * memory stays fixed however large the guilds are.
+ */
+class MemberCache {
+public:
+	/**
+	 * @brief A cached member together with their user.
+	 */
+	struct Entry {
+		dpp::guild_member member;
+		dpp::user user;
+		time_t stored = 0;
+	};
+
+	/**
+	 * @brief Size and lookup counters.
+	 */
+	struct Stats {
+		size_t entries = 0;
+		size_t bytes = 0;
+		uint64_t finds = 0;
+		uint64_t hits = 0;
+		uint64_t evictions = 0;
+	};
+
+private:
+	struct Key {
+		dpp::snowflake guild_id;
+		dpp::snowflake user_id;
+
+		bool operator==(const Key& other) const {
+			return guild_id == other.guild_id && user_id == other.user_id;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const {
+			return std::hash<uint64_t>()(key.guild_id) ^ (std::hash<uint64_t>()(key.user_id) * 31);
+		}
+	};
+
+	using List = std::list<std::pair<Key, Entry>>;
+
+	mutable std::mutex mutex;
+	size_t capacity;
+	time_t maxAge;
+	// Most recently used first
+	List order;
+	std::unordered_map<Key, List::iterator, KeyHash> index;
+	uint64_t finds = 0;
+	uint64_t hits = 0;
+	uint64_t evictions = 0;
+
+	void Trim() {
+		while (order.size() > capacity) {
+			index.erase(order.back().first);
+			order.pop_back();
+			++evictions;
+		}
+	}
+
+public:
+	/**
+	 * @brief Constructor.
+	 *
+	 * @param capacity Most members kept.
+	 * @param maxAge Seconds a member is trusted for before it is fetched again.
+	 */
+	MemberCache(size_t capacity, time_t maxAge) : capacity(capacity), maxAge(maxAge) {}
+
+	MemberCache(const MemberCache&) = delete;
+	MemberCache& operator=(const MemberCache&) = delete;
+
+	/**
+	 * @brief Changes the capacity, evicting members if it shrinks.
+	 *
+	 * @param newCapacity Most members kept.
+	 */
+	void SetCapacity(size_t newCapacity) {
+		std::lock_guard<std::mutex> lock(mutex);
+		capacity = newCapacity;
+		Trim();
+	}
+
+	/**
+	 * @brief Gets the capacity.
+	 *
+	 * @return Most members kept.
+	 */
+	size_t GetCapacity() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return capacity;
+	}
+
+	/**
+	 * @brief Gets the number of cached members.
+	 *
+	 * @return Member count.
+	 */
+	size_t Size() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return order.size();
+	}
+
+	/**
+	 * @brief Gets the size and lookup counters.
+	 *
+	 * The byte count walks every member, so this is not meant to be called often.
+	 *
+	 * @return Counters since the cache was created.
+	 */
+	Stats GetStats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		Stats stats;
+		stats.entries = order.size();
+		// List node and its two links, then the index's node, link and bucket
+		stats.bytes = sizeof(*this) + order.size() * (sizeof(List::value_type) + 2 * sizeof(void*));
+		stats.bytes += index.size() * (sizeof(decltype(index)::value_type) + sizeof(void*)) + index.bucket_count() * sizeof(void*);
+		for (const auto& item : order) {
+			stats.bytes += dpp::owned_bytes(item.second.member) + dpp::owned_bytes(item.second.user);
+		}
+		stats.finds = finds;
+		stats.hits = hits;
+		stats.evictions = evictions;
+		return stats;
+	}
+
+	/**
+	 * @brief Stores or refreshes a member, making it the most recently used.
+	 *
+	 * @param member The member.
+	 * @param user The member's user.
+	 */
+	void Store(const dpp::guild_member& member, const dpp::user& user) {
+		Key key{member.guild_id, member.user_id};
+		std::lock_guard<std::mutex> lock(mutex);
+		if (capacity == 0) {
+			return;
+		}
+		auto found = index.find(key);
+		if (found != index.end()) {
+			order.erase(found->second);
+			++evictions;
+		}
+		order.emplace_front(key, Entry{member, user, time(nullptr)});
+		index[key] = order.begin();
+		Trim();
+	}
+
+	/**
+	 * @brief Looks up a member, making it the most recently used.
+	 *
+	 * @param guild_id Guild ID.
+	 * @param user_id User ID.
+	 * @param[out] entry The member, if found.
+	 * @return true if found and not older than the maximum age.
+	 */
+	bool Find(dpp::snowflake guild_id, dpp::snowflake user_id, Entry& entry) {
+		std::lock_guard<std::mutex> lock(mutex);
+		++finds;
+		auto found = index.find(Key{guild_id, user_id});
+		if (found == index.end()) {
+			return false;
+		}
+		if (time(nullptr) - found->second->second.stored > maxAge) {
+			order.erase(found->second);
+			index.erase(found);
+			++evictions;
+			return false;
+		}
+		order.splice(order.begin(), order, found->second);
+		++hits;
+		entry = found->second->second;
+		return true;
+	}
+
+	/**
+	 * @brief Removes all members.
+	 */
+	void Clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		index.clear();
+		order.clear();
+	}
+};
+
+#endif //_INCLUDE_MEMBER_CACHE_H
@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "metrics.h"
+
+MetricsRegistry g_Metrics;
+MetricsDump g_MetricsDump;
+
+int MetricHistogram::BucketOf(uint64_t nanoseconds)
+{
+	if (nanoseconds < SUB_BUCKETS) {
+		return static_cast<int>(nanoseconds);
+	}
+	int top = 63;
+	while (!(nanoseconds >> top)) {
+		top--;
+	}
+	int shift = top - SUB_BITS;
+	return (shift + 1) * SUB_BUCKETS + static_cast<int>((nanoseconds >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t MetricHistogram::BucketMidpoint(int bucket)
+{
+	if (bucket < SUB_BUCKETS) {
+		return static_cast<uint64_t>(bucket);
+	}
+	int shift = bucket / SUB_BUCKETS - 1;
+	uint64_t low = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+	return low + ((uint64_t(1) << shift) >> 1);
+}
+
+void MetricHistogram::Record(uint64_t nanoseconds)
+{
+	buckets[BucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+	uint64_t seen = max.load(std::memory_order_relaxed);
+	while (nanoseconds > seen && !max.compare_exchange_weak(seen, nanoseconds, std::memory_order_relaxed)) {
+	}
+}
+
+double MetricHistogram::Quantile(double quantile) const
+{
+	// Bucket counts are read one by one while other threads record, so use their own total
+	uint64_t counts[BUCKETS];
+	uint64_t total = 0;
+	for (int i = 0; i < BUCKETS; i++) {
+		counts[i] = buckets[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+	if (total == 0) {
+		return 0.0;
+	}
+
+	uint64_t rank = static_cast<uint64_t>(quantile * (total - 1)) + 1;
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKETS; i++) {
+		seen += counts[i];
+		if (seen >= rank) {
+			return BucketMidpoint(i) / 1e9;
+		}
+	}
+	return Max();
+}
+
+MetricsRegistry::Metric& MetricsRegistry::Register(const char* name, const std::string& labels, const char* help, Kind kind)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& metric : m_metrics) {
+		if (metric->name == name && metric->labels == labels) {
+			return *metric;
+		}
+	}
+
+	auto metric = std::make_unique<Metric>();
+	metric->name = name;
+	metric->labels = labels;
+	metric->help = help;
+	metric->kind = kind;
+	if (kind == Kind::Histogram) {
+		metric->histogram = std::make_unique<MetricHistogram>();
+	}
+	m_metrics.push_back(std::move(metric));
+	return *m_metrics.back();
+}
+
+MetricCounter& MetricsRegistry::Counter(const char* name, const std::string& labels, const char* help)
+{
+	return Register(name, labels, help, Kind::Counter).counter;
+}
+
+MetricGauge& MetricsRegistry::Gauge(const char* name, const std::string& labels, const char* help)
+{
+	return Register(name, labels, help, Kind::Gauge).gauge;
+}
+
+MetricHistogram& MetricsRegistry::Histogram(const char* name, const std::string& labels, const char* help)
+{
+	return *Register(name, labels, help, Kind::Histogram).histogram;
+}
+
+const MetricsRegistry::Metric* MetricsRegistry::Find(const char* name, const char* labels) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (const auto& metric : m_metrics) {
+		if (metric->name == name && metric->labels == labels) {
+			return metric.get();
+		}
+	}
+	return nullptr;
+}
+
+std::vector<const MetricsRegistry::Metric*> MetricsRegistry::List() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<const Metric*> metrics;
+	for (const auto& metric : m_metrics) {
+		metrics.push_back(metric.get());
+	}
+	// Series of the same name together, as Prometheus wants them
+	std::stable_sort(metrics.begin(), metrics.end(), [](const Metric* a, const Metric* b) {
+		return a->name < b->name;
+	});
+	return metrics;
+}
+
+static std::string SeriesName(const std::string& name, const std::string& labels, const char* extra = nullptr)
+{
+	std::string series = name;
+	if (!labels.empty() || extra) {
+		series += "{";
+		series += labels;
+		if (extra) {
+			if (!labels.empty()) {
+				series += ",";
+			}
+			series += extra;
+		}
+		series += "}";
+	}
+	return series;
+}
+
+std::string MetricsRegistry::FormatPrometheus() const
+{
+	static const char* const types[] = {"counter", "gauge", "summary"};
+	static const double quantiles[] = {0.5, 0.9, 0.99};
+
+	std::string out;
+	std::string lastName;
+	char value[64];
+	for (const Metric* metric : List()) {
+		// HELP and TYPE once per name, with each labelled series following
+		if (metric->name != lastName) {
+			out += "# HELP " + metric->name + " " + metric->help + "\n";
+			out += "# TYPE " + metric->name + " " + types[static_cast<int>(metric->kind)] + "\n";
+			lastName = metric->name;
+		}
+
+		switch (metric->kind) {
+			case Kind::Counter:
+				snprintf(value, sizeof(value), " %" PRIu64 "\n", metric->counter.Get());
+				out += SeriesName(metric->name, metric->labels) + value;
+				break;
+			case Kind::Gauge:
+				snprintf(value, sizeof(value), " %" PRId64 "\n", metric->gauge.Get());
+				out += SeriesName(metric->name, metric->labels) + value;
+				break;
+			case Kind::Histogram:
+				for (double quantile : quantiles) {
+					char label[32];
+					snprintf(label, sizeof(label), "quantile=\"%g\"", quantile);
+					snprintf(value, sizeof(value), " %.9g\n", metric->histogram->Quantile(quantile));
+					out += SeriesName(metric->name, metric->labels, label) + value;
+				}
+				snprintf(value, sizeof(value), " %.9g\n", metric->histogram->Sum());
+				out += SeriesName(metric->name + "_sum", metric->labels) + value;
+				snprintf(value, sizeof(value), " %" PRIu64 "\n", metric->histogram->Count());
+				out += SeriesName(metric->name + "_count", metric->labels) + value;
+				break;
+		}
+	}
+	return out;
+}
+
+void MetricsDump::Set(const std::string& path, double interval)
+{
+	m_path = path;
+	m_interval = static_cast<uint64_t>(interval * 1e9);
+	m_next = MetricsRegistry::Now();
+}
+
+bool MetricsDump::Think(std::string& error)
+{
+	if (m_path.empty()) {
+		return true;
+	}
+	uint64_t now = MetricsRegistry::Now();
+	if (now < m_next) {
+		return true;
+	}
+	m_next = now + m_interval;
+
+	if (!Write(error)) {
+		// Once is enough, rather than every interval
+		m_path.clear();
+		return false;
+	}
+	return true;
+}
+
+bool MetricsDump::Write(std::string& error) const
+{
+	std::string temp = m_path + ".tmp";
+	{
+		std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+		if (!out) {
+			error = "could not open " + temp;
+			return false;
+		}
+		out << g_Metrics.FormatPrometheus();
+		if (!out) {
+			error = "could not write " + temp;
+			return false;
+		}
+	}
+	std::remove(m_path.c_str());
+	if (std::rename(temp.c_str(), m_path.c_str()) != 0) {
+		error = "could not rename " + temp + " to " + m_path;
+		return false;
+	}
+	return true;
+}
+
+EventMetrics::EventMetrics(const char* event) :
+	received(g_Metrics.Counter("discord_events_received_total", std::string("event=\"") + event + "\"", "Events received from the gateway")),
+	queued(g_Metrics.Counter("discord_events_queued_total", std::string("event=\"") + event + "\"", "Events queued for the main thread")),
+	dispatched(g_Metrics.Counter("discord_events_dispatched_total", std::string("event=\"") + event + "\"", "Events passed to plugin forwards")),
+	dropped(g_Metrics.Counter("discord_events_dropped_total", std::string("event=\"") + event + "\"", "Queued events no plugin was listening for")),
+	queueDelay(g_Metrics.Histogram("discord_event_queue_delay_seconds", std::string("event=\"") + event + "\"", "Time events wait for the main thread")),
+	forwardTime(g_Metrics.Histogram("discord_forward_seconds", std::string("event=\"") + event + "\"", "Time spent in plugin forwards"))
+{
+}
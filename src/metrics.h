@@ -0,0 +1,289 @@
+#ifndef _INCLUDE_METRICS_H
+#define _INCLUDE_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A count that only goes up.
+ */
+class MetricCounter {
+private:
+	std::atomic<uint64_t> value{0};
+
+public:
+	void Add(uint64_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+	uint64_t Get() const { return value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief A value that goes up and down.
+ */
+class MetricGauge {
+private:
+	std::atomic<int64_t> value{0};
+
+public:
+	void Set(int64_t newValue) { value.store(newValue, std::memory_order_relaxed); }
+	void Add(int64_t amount) { value.fetch_add(amount, std::memory_order_relaxed); }
+	int64_t Get() const { return value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief A distribution of durations.
+ *
+ * Samples are counted in log-linear buckets of nanoseconds, eight per power of two in the
+ * manner of an HDR histogram, so recording is a few atomic increments and quantiles are
+ * accurate to within 12.5% at any scale.
+ */
+class MetricHistogram {
+public:
+	static constexpr int SUB_BITS = 3;
+	static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+	static constexpr int BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+private:
+	std::atomic<uint64_t> buckets[BUCKETS] = {};
+	std::atomic<uint64_t> count{0};
+	std::atomic<uint64_t> sum{0};
+	std::atomic<uint64_t> max{0};
+
+	static int BucketOf(uint64_t nanoseconds);
+	static uint64_t BucketMidpoint(int bucket);
+
+public:
+	/**
+	 * @brief Records a sample.
+	 *
+	 * @param nanoseconds Duration.
+	 */
+	void Record(uint64_t nanoseconds);
+
+	/**
+	 * @brief Gets the number of samples.
+	 */
+	uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Gets the total of all samples, in seconds.
+	 */
+	double Sum() const { return sum.load(std::memory_order_relaxed) / 1e9; }
+
+	/**
+	 * @brief Gets the largest sample, in seconds.
+	 */
+	double Max() const { return max.load(std::memory_order_relaxed) / 1e9; }
+
+	/**
+	 * @brief Gets a quantile of the samples.
+	 *
+	 * @param quantile Quantile from 0.0 to 1.0, e.g. 0.99.
+	 * @return Duration in seconds, or 0.0 if there are no samples.
+	 */
+	double Quantile(double quantile) const;
+};
+
+/**
+ * @brief Every metric the extension keeps, by name and labels, for the console, natives and dumps.
+ *
+ * Metrics are registered once, which takes a lock, and the reference returned is kept and
+ * updated without locking from then on.
+ */
+class MetricsRegistry {
+public:
+	enum class Kind { Counter, Gauge, Histogram };
+
+	/**
+	 * @brief A registered metric.
+	 */
+	struct Metric {
+		std::string name;
+		std::string labels;
+		std::string help;
+		Kind kind;
+		MetricCounter counter;
+		MetricGauge gauge;
+		std::unique_ptr<MetricHistogram> histogram;
+	};
+
+private:
+	mutable std::mutex m_mutex;
+	std::vector<std::unique_ptr<Metric>> m_metrics;
+
+	Metric& Register(const char* name, const std::string& labels, const char* help, Kind kind);
+
+public:
+	/**
+	 * @brief Gets or registers a counter.
+	 *
+	 * @param name Metric name, in Prometheus style, e.g. "discord_events_received_total".
+	 * @param labels Prometheus label pairs, e.g. "event=\"ready\"", or empty.
+	 * @param help One line description.
+	 * @return The counter, valid for the life of the extension.
+	 */
+	MetricCounter& Counter(const char* name, const std::string& labels, const char* help);
+
+	/**
+	 * @brief Gets or registers a gauge.
+	 *
+	 * @see Counter
+	 */
+	MetricGauge& Gauge(const char* name, const std::string& labels, const char* help);
+
+	/**
+	 * @brief Gets or registers a histogram of durations.
+	 *
+	 * @see Counter
+	 */
+	MetricHistogram& Histogram(const char* name, const std::string& labels, const char* help);
+
+	/**
+	 * @brief Looks up a metric.
+	 *
+	 * @param name Metric name.
+	 * @param labels Label pairs, as registered.
+	 * @return The metric, or nullptr if there is none.
+	 */
+	const Metric* Find(const char* name, const char* labels) const;
+
+	/**
+	 * @brief Gets every metric, by name and then in registration order.
+	 *
+	 * @return The metrics, valid for the life of the extension.
+	 */
+	std::vector<const Metric*> List() const;
+
+	/**
+	 * @brief Formats every metric in the Prometheus text exposition format.
+	 *
+	 * Histograms are written as summaries with 0.5, 0.9 and 0.99 quantiles.
+	 *
+	 * @return The text.
+	 */
+	std::string FormatPrometheus() const;
+
+	/**
+	 * @brief Gets a monotonic timestamp for timing durations.
+	 *
+	 * @return Nanoseconds from an arbitrary point.
+	 */
+	static uint64_t Now() {
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+};
+
+/**
+ * @brief Writes the metrics to a file in the Prometheus text format at an interval, e.g. for
+ * node_exporter's textfile collector.
+ *
+ * Only used from the main thread.
+ */
+class MetricsDump {
+private:
+	std::string m_path;
+	uint64_t m_interval = 0;
+	uint64_t m_next = 0;
+
+public:
+	/**
+	 * @brief Sets where and how often to write the metrics.
+	 *
+	 * @param path File to write, or empty to stop.
+	 * @param interval Seconds between writes.
+	 */
+	void Set(const std::string& path, double interval);
+
+	/**
+	 * @brief Writes the metrics if the interval has passed. Called every frame.
+	 *
+	 * Stops writing after a failure.
+	 *
+	 * @param[out] error Reason, on failure.
+	 * @return False if writing failed.
+	 */
+	bool Think(std::string& error);
+
+	/**
+	 * @brief Writes the metrics now.
+	 *
+	 * The file is replaced whole, so readers never see half of it.
+	 *
+	 * @param[out] error Reason, on failure.
+	 * @return True on success.
+	 */
+	bool Write(std::string& error) const;
+};
+
+extern MetricsRegistry g_Metrics;
+extern MetricsDump g_MetricsDump;
+
+/**
+ * @brief Metrics for one kind of event, from a shard thread to its forward on the main thread.
+ */
+struct EventMetrics {
+	MetricCounter& received;
+	MetricCounter& queued;
+	MetricCounter& dispatched;
+	MetricCounter& dropped;
+	MetricHistogram& queueDelay;
+	MetricHistogram& forwardTime;
+
+	/**
+	 * @brief Registers the metrics of an event.
+	 *
+	 * @param event Event name, used as the event label.
+	 */
+	explicit EventMetrics(const char* event);
+
+	/**
+	 * @brief Counts an event being queued for the main thread.
+	 *
+	 * @return Timestamp to hand to the EventDispatch on the main thread.
+	 */
+	uint64_t Queue() {
+		queued.Add();
+		return MetricsRegistry::Now();
+	}
+};
+
+/**
+ * @brief Times the main thread side of one queued event.
+ *
+ * Counts the event as dispatched if Deliver() was called before it goes out of scope,
+ * and as dropped otherwise, e.g. because no plugin is listening.
+ */
+class EventDispatch {
+private:
+	EventMetrics& m_metrics;
+	uint64_t m_start;
+	bool m_delivered;
+
+public:
+	EventDispatch(EventMetrics& metrics, uint64_t queued) : m_metrics(metrics), m_start(MetricsRegistry::Now()), m_delivered(false) {
+		m_metrics.queueDelay.Record(m_start - queued);
+	}
+
+	~EventDispatch() {
+		if (m_delivered) {
+			m_metrics.dispatched.Add();
+			m_metrics.forwardTime.Record(MetricsRegistry::Now() - m_start);
+		} else {
+			m_metrics.dropped.Add();
+		}
+	}
+
+	EventDispatch(const EventDispatch&) = delete;
+	EventDispatch& operator=(const EventDispatch&) = delete;
+
+	/**
+	 * @brief Marks the event as handed to plugins.
+	 */
+	void Deliver() { m_delivered = true; }
+};
+
+#endif //_INCLUDE_METRICS_H
@@ -0,0 +1,106 @@
+#include "plugin_profiler.h"
+
+PluginProfiler g_PluginProfiler;
+
+// Plugin file names go into label values, where quotes and backslashes must be escaped
+static std::string LabelValue(const std::string& value)
+{
+	std::string escaped;
+	for (char c : value) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+		}
+		escaped += c;
+	}
+	return escaped;
+}
+
+void PluginProfiler::ExecuteForward(IForward* forward, const std::function<void(ICallable*)>& push)
+{
+	const char* name = forward->GetForwardName();
+	IPluginIterator* iter = plsys->GetPluginIterator();
+	while (iter->MorePlugins()) {
+		IPlugin* plugin = iter->GetPlugin();
+		iter->NextPlugin();
+
+		if (plugin->GetStatus() != Plugin_Running) {
+			continue;
+		}
+		IPluginFunction* function = plugin->GetRuntime()->GetFunctionByName(name);
+		if (!function) {
+			continue;
+		}
+
+		push(function);
+		uint64_t start = MetricsRegistry::Now();
+		function->Execute(nullptr);
+		Record(plugin->GetFilename(), name, MetricsRegistry::Now() - start);
+	}
+	iter->Release();
+}
+
+void PluginProfiler::AddCallback(IForward* forward, IPluginContext* pContext, const char* callback)
+{
+	IPlugin* plugin = plsys->FindPluginByContext(pContext->GetContext());
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	m_callbacks[forward] = {plugin ? plugin->GetFilename() : "unknown", callback};
+}
+
+void PluginProfiler::ExecuteCallback(IForward* forward)
+{
+	Callback callback = {"unknown", "callback"};
+	{
+		std::lock_guard<std::mutex> lock(m_callbackMutex);
+		auto found = m_callbacks.find(forward);
+		if (found != m_callbacks.end()) {
+			callback = found->second;
+		}
+	}
+
+	uint64_t start = MetricsRegistry::Now();
+	forward->Execute(nullptr);
+	Record(callback.plugin.c_str(), callback.name, MetricsRegistry::Now() - start);
+}
+
+void PluginProfiler::ReleaseCallback(IForward* forward)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_callbackMutex);
+		m_callbacks.erase(forward);
+	}
+	forwards->ReleaseForward(forward);
+}
+
+void PluginProfiler::Record(const char* plugin, const char* callback, uint64_t nanoseconds)
+{
+	auto key = std::make_pair(std::string(plugin), std::string(callback));
+	auto found = m_timings.find(key);
+	if (found == m_timings.end()) {
+		std::string labels = "plugin=\"" + LabelValue(key.first) + "\",callback=\"" + key.second + "\"";
+		Timing timing;
+		timing.time = &g_Metrics.Histogram("discord_plugin_seconds", labels, "Time plugins spend in each forward and callback");
+		timing.overBudget = &g_Metrics.Counter("discord_plugin_over_budget_total", labels, "Plugin calls which took longer than the budget");
+		timing.lastWarning = 0;
+		found = m_timings.emplace(std::move(key), timing).first;
+	}
+
+	Timing& timing = found->second;
+	timing.time->Record(nanoseconds);
+	if (!m_budget || nanoseconds <= m_budget) {
+		return;
+	}
+
+	timing.overBudget->Add();
+	// Once a minute at most, so a plugin that is always slow doesn't flood the log
+	uint64_t now = MetricsRegistry::Now();
+	if (timing.lastWarning && now - timing.lastWarning < WARNING_INTERVAL) {
+		return;
+	}
+	timing.lastWarning = now;
+	smutils->LogError(myself, "Plugin \"%s\" took %.2f ms in %s, over the %.2f ms budget (%llu times so far)",
+		plugin,
+		nanoseconds / 1e6,
+		callback,
+		m_budget / 1e6,
+		static_cast<unsigned long long>(timing.overBudget->Get()));
+}
@@ -0,0 +1,108 @@
+#ifndef _INCLUDE_PLUGIN_PROFILER_H
+#define _INCLUDE_PLUGIN_PROFILER_H
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "smsdk_ext.h"
+#include "metrics.h"
+
+/**
+ * @brief Times every plugin function the extension calls, per plugin and callback, so that one
+ * slow plugin can be told apart from the rest, and warns when a call goes over a budget.
+ *
+ * Global forwards are called one plugin at a time instead of through IForward::Execute, which
+ * would time them all together. Callbacks are private forwards made for one plugin function,
+ * and are timed whole and put down to the plugin that made them.
+ *
+ * Times go into the metrics registry as discord_plugin_seconds and
+ * discord_plugin_over_budget_total, labelled by plugin and callback. Only used from the main
+ * thread, except for ReleaseCallback.
+ */
+class PluginProfiler {
+public:
+	/**
+	 * @brief Calls a global forward, timing each plugin.
+	 *
+	 * @param forward Forward to call.
+	 * @param push Pushes the parameters, called once for each plugin function.
+	 */
+	void ExecuteForward(IForward* forward, const std::function<void(ICallable*)>& push);
+
+	/**
+	 * @brief Notes which plugin a callback was made for. Called when the native creates it.
+	 *
+	 * @param forward Private forward holding the plugin's function.
+	 * @param pContext Context of the plugin.
+	 * @param callback Name of the native taking the callback, which must outlive the extension, e.g. a literal.
+	 */
+	void AddCallback(IForward* forward, IPluginContext* pContext, const char* callback);
+
+	/**
+	 * @brief Calls a callback, with its parameters already pushed, and times it.
+	 *
+	 * @param forward Private forward given to AddCallback.
+	 */
+	void ExecuteCallback(IForward* forward);
+
+	/**
+	 * @brief Forgets and releases a callback.
+	 *
+	 * @param forward Private forward given to AddCallback.
+	 */
+	void ReleaseCallback(IForward* forward);
+
+	/**
+	 * @brief Sets the time one call may take before a warning is logged.
+	 *
+	 * @param seconds Budget, or 0 for no warnings.
+	 */
+	void SetBudget(double seconds) { m_budget = static_cast<uint64_t>(seconds * 1e9); }
+
+	/**
+	 * @brief Gets the time one call may take before a warning is logged.
+	 *
+	 * @return Budget in seconds, or 0 for no warnings.
+	 */
+	double GetBudget() const { return m_budget / 1e9; }
+
+	/**
+	 * @brief Timings of one callback in one plugin.
+	 */
+	struct Timing {
+		MetricHistogram* time;
+		MetricCounter* overBudget;
+		uint64_t lastWarning;
+	};
+
+	/**
+	 * @brief Gets every timing, by plugin and then callback.
+	 *
+	 * @return Timings keyed by plugin file name and callback.
+	 */
+	const std::map<std::pair<std::string, std::string>, Timing>& GetTimings() const { return m_timings; }
+
+private:
+	struct Callback {
+		std::string plugin;
+		const char* name;
+	};
+
+	void Record(const char* plugin, const char* callback, uint64_t nanoseconds);
+
+	static constexpr uint64_t WARNING_INTERVAL = 60ULL * 1000000000ULL;
+
+	uint64_t m_budget = 5000000;
+	std::map<std::pair<std::string, std::string>, Timing> m_timings;
+
+	// Callbacks can be released from REST threads when their request fails
+	std::mutex m_callbackMutex;
+	std::unordered_map<IForward*, Callback> m_callbacks;
+};
+
+extern PluginProfiler g_PluginProfiler;
+
+#endif //_INCLUDE_PLUGIN_PROFILER_H
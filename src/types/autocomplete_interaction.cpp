@@ -187,7 +187,7 @@ static cell_t autocomplete_CreateAutocompleteResponse(IPluginContext* pContext,
 		return 0;
 	}
 
-	discord->CreateAutocompleteResponse(interaction->m_command.id, interaction->m_command.token, interaction->m_response);
+	discord->CreateAutocompleteResponse(interaction->m_command.id, interaction->m_command.token, interaction->m_response, g_EventTrace.Response(interaction->m_trace));
 	return 1;
 }
 
@@ -2,6 +2,7 @@
 #define _INCLUDE_AUTOCOMPLETE_INTERACTION_H
 
 #include "discord.h"
+#include "event_trace.h"
 #include "object_handler.h"
 #include "user.h"
 #include "dpp/dpp.h"
@@ -13,12 +14,14 @@ public:
 	std::string m_commandName;
 	dpp::interaction m_command;
 	dpp::autocomplete_t m_autocomplete;
+	uint64_t m_trace;
 
-	DiscordAutocompleteInteraction(const dpp::autocomplete_t& autocomplete) :
+	DiscordAutocompleteInteraction(const dpp::autocomplete_t& autocomplete, uint64_t trace = 0) :
 		m_response(dpp::ir_autocomplete_reply),
 		m_commandName(autocomplete.command.get_command_name()),
 		m_command(autocomplete.command),
-		m_autocomplete(autocomplete)
+		m_autocomplete(autocomplete),
+		m_trace(trace)
 	{
 	}
 
@@ -11,6 +11,88 @@ static cell_t channel_GetName(IPluginContext* pContext, const cell_t* params)
     return 1;
 }
 
+static cell_t channel_GetId(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordChannel* channel = g_DiscordChannelHandler.ReadHandle(params[1]);
+    if (!channel) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], channel->GetId().c_str());
+    return 1;
+}
+
+static cell_t channel_GetGuildId(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordChannel* channel = g_DiscordChannelHandler.ReadHandle(params[1]);
+    if (!channel) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], channel->GetGuildId().c_str());
+    return 1;
+}
+
+static cell_t channel_GetParentId(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordChannel* channel = g_DiscordChannelHandler.ReadHandle(params[1]);
+    if (!channel) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], channel->GetParentId().c_str());
+    return 1;
+}
+
+static cell_t channel_GetType(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordChannel* channel = g_DiscordChannelHandler.ReadHandle(params[1]);
+    if (!channel) {
+        return 0;
+    }
+
+    return channel->GetType();
+}
+
+static cell_t channel_GetTopic(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordChannel* channel = g_DiscordChannelHandler.ReadHandle(params[1]);
+    if (!channel) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], channel->GetTopic());
+    return 1;
+}
+
+static cell_t channel_GetPosition(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordChannel* channel = g_DiscordChannelHandler.ReadHandle(params[1]);
+    if (!channel) {
+        return 0;
+    }
+
+    return channel->GetPosition();
+}
+
+static cell_t channel_IsNSFW(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordChannel* channel = g_DiscordChannelHandler.ReadHandle(params[1]);
+    if (!channel) {
+        return 0;
+    }
+
+    return channel->IsNSFW() ? 1 : 0;
+}
+
 const sp_nativeinfo_t channel_natives[] = {
-    {"DiscordChannel.GetName",       channel_GetName}
-};
\ No newline at end of file
+    {"DiscordChannel.GetName",       channel_GetName},
+    {"DiscordChannel.GetId",         channel_GetId},
+    {"DiscordChannel.GetGuildId",    channel_GetGuildId},
+    {"DiscordChannel.GetParentId",   channel_GetParentId},
+    {"DiscordChannel.GetType",       channel_GetType},
+    {"DiscordChannel.GetTopic",      channel_GetTopic},
+    {"DiscordChannel.GetPosition",   channel_GetPosition},
+    {"DiscordChannel.IsNSFW",        channel_IsNSFW},
+    {nullptr,                        nullptr}
+};
@@ -13,6 +13,20 @@ public:
     DiscordChannel(const dpp::channel& chnl) : m_channel(chnl) {}
 
     const char* GetName() const { return m_channel.name.c_str(); }
+
+    std::string GetId() const { return std::to_string(m_channel.id); }
+
+    std::string GetGuildId() const { return std::to_string(m_channel.guild_id); }
+
+    std::string GetParentId() const { return std::to_string(m_channel.parent_id); }
+
+    int GetType() const { return static_cast<int>(m_channel.get_type()); }
+
+    const char* GetTopic() const { return m_channel.topic.c_str(); }
+
+    int GetPosition() const { return m_channel.position; }
+
+    bool IsNSFW() const { return m_channel.is_nsfw(); }
 };
 
 inline DiscordObjectHandler<DiscordChannel> g_DiscordChannelHandler;
@@ -1,5 +1,33 @@
 #include "embed.h"
 
+const std::string& DiscordEmbed::GetJson() const
+{
+	if (m_json.empty()) {
+		// Serialize through a message so the fragment is exactly what DPP would have sent,
+		// replacing invalid UTF-8 the same way build_json() does
+		dpp::message msg;
+		msg.add_embed(m_embed);
+		m_json = msg.to_json(false, false)["embeds"][0].dump(-1, ' ', false, nlohmann::detail::error_handler_t::replace);
+	}
+	return m_json;
+}
+
+std::string DiscordEmbed::BuildMessageJson(const dpp::message& msg, bool with_id) const
+{
+	static const std::string emptyEmbeds = "\"embeds\":[]";
+
+	std::string json = msg.build_json(with_id);
+	size_t pos = json.find(emptyEmbeds);
+	if (pos == std::string::npos) {
+		dpp::message withEmbed = msg;
+		withEmbed.add_embed(m_embed);
+		return withEmbed.build_json(with_id);
+	}
+
+	json.replace(pos, emptyEmbeds.size(), "\"embeds\":[" + GetJson() + "]");
+	return json;
+}
+
 static cell_t embed_CreateEmbed(IPluginContext* pContext, const cell_t* params)
 {
 	DiscordEmbed* embed = new DiscordEmbed();
@@ -8,27 +8,37 @@ class DiscordEmbed : public DiscordObject
 {
 private:
     dpp::embed m_embed;
+    // Serialized embed, reused by every send until a setter changes the embed
+    mutable std::string m_json;
+
+    void Invalidate() { m_json.clear(); }
 
 public:
     DiscordEmbed() {}
 
-    void SetTitle(const char* title) { m_embed.set_title(title); }
-    void SetDescription(const char* desc) { m_embed.set_description(desc); }
-    void SetColor(int color) { m_embed.set_color(color); }
-    void SetUrl(const char* url) { m_embed.set_url(url); }
+    void SetTitle(const char* title) { m_embed.set_title(title); Invalidate(); }
+    void SetDescription(const char* desc) { m_embed.set_description(desc); Invalidate(); }
+    void SetColor(int color) { m_embed.set_color(color); Invalidate(); }
+    void SetUrl(const char* url) { m_embed.set_url(url); Invalidate(); }
     void SetAuthor(const char* name, const char* url = nullptr, const char* icon_url = nullptr) {
         m_embed.set_author(name, url ? url : "", icon_url ? icon_url : "");
+        Invalidate();
     }
     void SetFooter(const char* text, const char* icon_url = nullptr) {
         m_embed.set_footer(text, icon_url ? icon_url : "");
+        Invalidate();
     }
     void AddField(const char* name, const char* value, bool inLine = false) {
         m_embed.add_field(name, value, inLine);
+        Invalidate();
     }
-    void SetThumbnail(const char* url) { m_embed.set_thumbnail(url); }
-    void SetImage(const char* url) { m_embed.set_image(url); }
+    void SetThumbnail(const char* url) { m_embed.set_thumbnail(url); Invalidate(); }
+    void SetImage(const char* url) { m_embed.set_image(url); Invalidate(); }
 
     const dpp::embed& GetEmbed() const { return m_embed; }
+    const std::string& GetJson() const;
+    // Builds the JSON for a message without embeds, then splices in the cached embed JSON instead of serializing it again
+    std::string BuildMessageJson(const dpp::message& msg, bool with_id) const;
 };
 
 inline DiscordObjectHandler<DiscordEmbed> g_DiscordEmbedHandler;
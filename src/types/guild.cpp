@@ -0,0 +1,98 @@
+#include "guild.h"
+
+static cell_t guild_GetId(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordGuild* guild = g_DiscordGuildHandler.ReadHandle(params[1]);
+    if (!guild) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], guild->GetId().c_str());
+    return 1;
+}
+
+static cell_t guild_GetOwnerId(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordGuild* guild = g_DiscordGuildHandler.ReadHandle(params[1]);
+    if (!guild) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], guild->GetOwnerId().c_str());
+    return 1;
+}
+
+static cell_t guild_GetName(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordGuild* guild = g_DiscordGuildHandler.ReadHandle(params[1]);
+    if (!guild) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], guild->GetName());
+    return 1;
+}
+
+static cell_t guild_GetDescription(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordGuild* guild = g_DiscordGuildHandler.ReadHandle(params[1]);
+    if (!guild) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], guild->GetDescription());
+    return 1;
+}
+
+static cell_t guild_GetIconUrl(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordGuild* guild = g_DiscordGuildHandler.ReadHandle(params[1]);
+    if (!guild) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], guild->GetIconUrl());
+    return 1;
+}
+
+static cell_t guild_GetMemberCount(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordGuild* guild = g_DiscordGuildHandler.ReadHandle(params[1]);
+    if (!guild) {
+        return 0;
+    }
+
+    return static_cast<cell_t>(guild->GetMemberCount());
+}
+
+static cell_t guild_GetChannelCount(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordGuild* guild = g_DiscordGuildHandler.ReadHandle(params[1]);
+    if (!guild) {
+        return 0;
+    }
+
+    return static_cast<cell_t>(guild->GetChannelCount());
+}
+
+static cell_t guild_GetRoleCount(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordGuild* guild = g_DiscordGuildHandler.ReadHandle(params[1]);
+    if (!guild) {
+        return 0;
+    }
+
+    return static_cast<cell_t>(guild->GetRoleCount());
+}
+
+const sp_nativeinfo_t guild_natives[] = {
+    {"DiscordGuild.GetId",           guild_GetId},
+    {"DiscordGuild.GetOwnerId",      guild_GetOwnerId},
+    {"DiscordGuild.GetName",         guild_GetName},
+    {"DiscordGuild.GetDescription",  guild_GetDescription},
+    {"DiscordGuild.GetIconUrl",      guild_GetIconUrl},
+    {"DiscordGuild.GetMemberCount",  guild_GetMemberCount},
+    {"DiscordGuild.GetChannelCount", guild_GetChannelCount},
+    {"DiscordGuild.GetRoleCount",    guild_GetRoleCount},
+    {nullptr,                        nullptr}
+};
@@ -0,0 +1,52 @@
+#ifndef _INCLUDE_GUILD_H
+#define _INCLUDE_GUILD_H
+
+#include "object_handler.h"
+#include "dpp/dpp.h"
+
+class DiscordGuild : public DiscordObject
+{
+private:
+    // Only the guild's own fields are copied; its member, channel and role lists can be huge
+    dpp::snowflake m_id;
+    dpp::snowflake m_ownerId;
+    std::string m_name;
+    std::string m_description;
+    std::string m_iconUrl;
+    uint32_t m_memberCount;
+    size_t m_channelCount;
+    size_t m_roleCount;
+
+public:
+    DiscordGuild(const dpp::guild& guild) :
+        m_id(guild.id),
+        m_ownerId(guild.owner_id),
+        m_name(guild.name),
+        m_description(guild.description),
+        m_iconUrl(guild.get_icon_url()),
+        m_memberCount(guild.member_count),
+        m_channelCount(guild.channels.size()),
+        m_roleCount(guild.roles.size()) {}
+
+    std::string GetId() const { return std::to_string(m_id); }
+
+    std::string GetOwnerId() const { return std::to_string(m_ownerId); }
+
+    const char* GetName() const { return m_name.c_str(); }
+
+    const char* GetDescription() const { return m_description.c_str(); }
+
+    const char* GetIconUrl() const { return m_iconUrl.c_str(); }
+
+    uint32_t GetMemberCount() const { return m_memberCount; }
+
+    size_t GetChannelCount() const { return m_channelCount; }
+
+    size_t GetRoleCount() const { return m_roleCount; }
+};
+
+inline DiscordObjectHandler<DiscordGuild> g_DiscordGuildHandler;
+
+extern const sp_nativeinfo_t guild_natives[];
+
+#endif //_INCLUDE_GUILD_H
@@ -2,6 +2,7 @@
 #define _INCLUDE_INTERACTION_H
 
 #include "embed.h"
+#include "event_trace.h"
 #include "object_handler.h"
 #include "user.h"
 #include "dpp/dpp.h"
@@ -11,11 +12,13 @@ class DiscordInteraction : public DiscordObject
 private:
 	dpp::slashcommand_t m_interaction;
 	std::string m_commandName;
+	uint64_t m_trace;
 
 public:
-	DiscordInteraction(const dpp::slashcommand_t& interaction) :
+	DiscordInteraction(const dpp::slashcommand_t& interaction, uint64_t trace = 0) :
 		m_interaction(interaction),
-		m_commandName(interaction.command.get_command_name())
+		m_commandName(interaction.command.get_command_name()),
+		m_trace(trace)
 	{
 	}
 
@@ -56,40 +59,40 @@ public:
 	}
 
 	void CreateResponse(const char* content) const {
-		m_interaction.reply(dpp::message(content));
+		m_interaction.reply(dpp::message(content), g_EventTrace.Response(m_trace));
 	}
 
 	void CreateResponseEmbed(const char* content, const DiscordEmbed* embed) const {
 		dpp::message msg(content);
 		msg.add_embed(embed->GetEmbed());
-		m_interaction.reply(msg);
+		m_interaction.reply(msg, g_EventTrace.Response(m_trace));
 	}
 
 	void DeferReply(bool ephemeral = false) const {
-		m_interaction.thinking(ephemeral);
+		m_interaction.thinking(ephemeral, g_EventTrace.Response(m_trace));
 	}
 
 	void EditResponse(const char* content) const {
-		m_interaction.edit_response(dpp::message(content));
+		m_interaction.edit_response(dpp::message(content), g_EventTrace.Response(m_trace));
 	}
 
 	void EditResponseEmbed(const char* content, const DiscordEmbed* embed) const {
 		dpp::message msg(content);
 		msg.add_embed(embed->GetEmbed());
-		m_interaction.edit_response(msg);
+		m_interaction.edit_response(msg, g_EventTrace.Response(m_trace));
 	}
 
 	void CreateEphemeralResponse(const char* content) const {
 		dpp::message msg(content);
 		msg.set_flags(dpp::m_ephemeral);
-		m_interaction.reply(msg);
+		m_interaction.reply(msg, g_EventTrace.Response(m_trace));
 	}
 
 	void CreateEphemeralResponseEmbed(const char* content, const DiscordEmbed* embed) const {
 		dpp::message msg(content);
 		msg.set_flags(dpp::m_ephemeral);
 		msg.add_embed(embed->GetEmbed());
-		m_interaction.reply(msg);
+		m_interaction.reply(msg, g_EventTrace.Response(m_trace));
 	}
 };
 
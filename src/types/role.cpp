@@ -0,0 +1,108 @@
+#include "role.h"
+
+static cell_t role_GetId(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordRole* role = g_DiscordRoleHandler.ReadHandle(params[1]);
+    if (!role) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], role->GetId().c_str());
+    return 1;
+}
+
+static cell_t role_GetGuildId(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordRole* role = g_DiscordRoleHandler.ReadHandle(params[1]);
+    if (!role) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], role->GetGuildId().c_str());
+    return 1;
+}
+
+static cell_t role_GetName(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordRole* role = g_DiscordRoleHandler.ReadHandle(params[1]);
+    if (!role) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], role->GetName());
+    return 1;
+}
+
+static cell_t role_GetColor(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordRole* role = g_DiscordRoleHandler.ReadHandle(params[1]);
+    if (!role) {
+        return 0;
+    }
+
+    return static_cast<cell_t>(role->GetColor());
+}
+
+static cell_t role_GetPosition(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordRole* role = g_DiscordRoleHandler.ReadHandle(params[1]);
+    if (!role) {
+        return 0;
+    }
+
+    return role->GetPosition();
+}
+
+static cell_t role_GetPermissions(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordRole* role = g_DiscordRoleHandler.ReadHandle(params[1]);
+    if (!role) {
+        return 0;
+    }
+
+    pContext->StringToLocal(params[2], params[3], role->GetPermissions().c_str());
+    return 1;
+}
+
+static cell_t role_IsHoisted(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordRole* role = g_DiscordRoleHandler.ReadHandle(params[1]);
+    if (!role) {
+        return 0;
+    }
+
+    return role->IsHoisted() ? 1 : 0;
+}
+
+static cell_t role_IsMentionable(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordRole* role = g_DiscordRoleHandler.ReadHandle(params[1]);
+    if (!role) {
+        return 0;
+    }
+
+    return role->IsMentionable() ? 1 : 0;
+}
+
+static cell_t role_IsManaged(IPluginContext* pContext, const cell_t* params)
+{
+    DiscordRole* role = g_DiscordRoleHandler.ReadHandle(params[1]);
+    if (!role) {
+        return 0;
+    }
+
+    return role->IsManaged() ? 1 : 0;
+}
+
+const sp_nativeinfo_t role_natives[] = {
+    {"DiscordRole.GetId",          role_GetId},
+    {"DiscordRole.GetGuildId",     role_GetGuildId},
+    {"DiscordRole.GetName",        role_GetName},
+    {"DiscordRole.GetColor",       role_GetColor},
+    {"DiscordRole.GetPosition",    role_GetPosition},
+    {"DiscordRole.GetPermissions", role_GetPermissions},
+    {"DiscordRole.IsHoisted",      role_IsHoisted},
+    {"DiscordRole.IsMentionable",  role_IsMentionable},
+    {"DiscordRole.IsManaged",      role_IsManaged},
+    {nullptr,                      nullptr}
+};
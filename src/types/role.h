@@ -0,0 +1,39 @@
+#ifndef _INCLUDE_ROLE_H
+#define _INCLUDE_ROLE_H
+
+#include "object_handler.h"
+#include "dpp/dpp.h"
+
+class DiscordRole : public DiscordObject
+{
+private:
+    dpp::role m_role;
+
+public:
+    DiscordRole(const dpp::role& role) : m_role(role) {}
+
+    std::string GetId() const { return std::to_string(m_role.id); }
+
+    std::string GetGuildId() const { return std::to_string(m_role.guild_id); }
+
+    const char* GetName() const { return m_role.name.c_str(); }
+
+    uint32_t GetColor() const { return m_role.colour; }
+
+    int GetPosition() const { return m_role.position; }
+
+    // Permissions are a 64 bit mask, so they are passed to plugins as a decimal string like snowflakes
+    std::string GetPermissions() const { return std::to_string(static_cast<uint64_t>(m_role.permissions)); }
+
+    bool IsHoisted() const { return m_role.is_hoisted(); }
+
+    bool IsMentionable() const { return m_role.is_mentionable(); }
+
+    bool IsManaged() const { return m_role.is_managed(); }
+};
+
+inline DiscordObjectHandler<DiscordRole> g_DiscordRoleHandler;
+
+extern const sp_nativeinfo_t role_natives[];
+
+#endif //_INCLUDE_ROLE_H
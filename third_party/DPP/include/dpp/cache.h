@@ -25,16 +25,121 @@
 #include <dpp/snowflake.h>
 #include <dpp/managed.h>
 #include <unordered_map>
+#include <deque>
+#include <array>
+#include <atomic>
+#include <ctime>
 #include <mutex>
 #include <shared_mutex>
 
 namespace dpp {
 
-extern DPP_EXPORT std::unordered_map<managed*, time_t> deletion_queue;
+/**
+ * @brief Objects waiting to be deleted, with the time they were queued.
+ *
+ * Appended to in time order, so the oldest entries are always at the front.
+ */
+extern DPP_EXPORT std::deque<std::pair<managed*, time_t>> deletion_queue;
 extern DPP_EXPORT std::mutex deletion_mutex;
 
 /** forward declaration */
 class guild_member;
+class user;
+class guild;
+class role;
+class channel;
+class emoji;
+
+/**
+ * @brief Approximate heap memory owned by a cached object, beyond sizeof the object itself:
+ * its strings, vectors and icon data, and for a guild its member map and each member's
+ * nickname and roles. The object must not change while it is read.
+ *
+ * @param object Object to measure
+ * @return size_t Estimated bytes
+ */
+DPP_EXPORT size_t owned_bytes(const user& object);
+
+/** @copydoc owned_bytes(const user&) */
+DPP_EXPORT size_t owned_bytes(const guild& object);
+
+/** @copydoc owned_bytes(const user&) */
+DPP_EXPORT size_t owned_bytes(const guild_member& object);
+
+/** @copydoc owned_bytes(const user&) */
+DPP_EXPORT size_t owned_bytes(const role& object);
+
+/** @copydoc owned_bytes(const user&) */
+DPP_EXPORT size_t owned_bytes(const channel& object);
+
+/** @copydoc owned_bytes(const user&) */
+DPP_EXPORT size_t owned_bytes(const emoji& object);
+
+/**
+ * @brief Counters for one dpp::sharded_cache
+ */
+struct DPP_EXPORT cache_stats {
+	/**
+	 * @brief Objects in the cache
+	 */
+	uint64_t entries = 0;
+
+	/**
+	 * @brief Approximate bytes used by the cache and the objects in it, including the
+	 * memory the objects own when counted with sharded_cache::get_stats(true)
+	 */
+	uint64_t bytes = 0;
+
+	/**
+	 * @brief Lookups by id
+	 */
+	uint64_t finds = 0;
+
+	/**
+	 * @brief Lookups which found an object
+	 */
+	uint64_t hits = 0;
+
+	/**
+	 * @brief Lookups which found nothing
+	 */
+	uint64_t misses = 0;
+
+	/**
+	 * @brief Objects removed, or replaced by a newer copy, and queued for deletion
+	 */
+	uint64_t evictions = 0;
+};
+
+/**
+ * @brief Counters for dpp::garbage_collection()
+ */
+struct DPP_EXPORT gc_stats {
+	/**
+	 * @brief Times garbage collection has run
+	 */
+	uint64_t runs = 0;
+
+	/**
+	 * @brief Objects deleted from the deletion queue
+	 */
+	uint64_t deleted = 0;
+
+	/**
+	 * @brief Objects waiting in the deletion queue
+	 */
+	uint64_t pending = 0;
+
+	/**
+	 * @brief Seconds spent in garbage collection, in total
+	 */
+	double total_time = 0;
+
+	/**
+	 * @brief Seconds the last run took
+	 */
+	double last_time = 0;
+};
 
 /**
  * @brief A cache object maintains a cache of dpp::managed objects.
@@ -60,6 +165,11 @@ private:
 	 * @brief Container of pointers to cached items
 	 */
 	std::unordered_map<snowflake, T*>* cache_map;
+
+	/**
+	 * @brief Fewest buckets before cache::rehash_if_sparse() considers shrinking the map
+	 */
+	static constexpr size_t min_rehash_buckets = 1024;
 public:
 
 	/**
@@ -109,7 +219,7 @@ public:
 		} else if (object != existing->second) {
 			/* Flag old pointer for deletion and replace */
 			std::lock_guard<std::mutex> delete_lock(deletion_mutex);
-			deletion_queue[existing->second] = time(nullptr);
+			deletion_queue.emplace_back(existing->second, time(nullptr));
 			(*cache_map)[object->id] = object;
 		}
 	}
@@ -123,6 +233,9 @@ public:
 	 * assists in thread safety by ensuring that all deletions can be locked and freed
 	 * at the same time.
 	 * 
+	 * @note Whatever is currently stored under the object's id is removed and queued. A pointer
+	 * which store() already replaced is not queued a second time.
+	 *
 	 * @param object object to remove. Passing a nullptr will have no effect.
 	 */
 	void remove(T* object) {
@@ -133,8 +246,9 @@ public:
 		std::lock_guard<std::mutex> delete_lock(deletion_mutex);
 		auto existing = cache_map->find(object->id);
 		if (existing != cache_map->end()) {
+			/* Queue what the map held. If object was since replaced by store(), it is queued already */
+			deletion_queue.emplace_back(existing->second, time(nullptr));
 			cache_map->erase(existing);
-			deletion_queue[object] = time(nullptr);
 		}
 	}
 
@@ -241,6 +355,27 @@ public:
 		cache_map = n;
 	}
 
+	/**
+	 * @brief Rehash the cache, but only if most of its buckets are empty.
+	 *
+	 * This is what garbage collection calls. It is O(1) unless the number of
+	 * entries has dropped below a quarter of the bucket count, e.g. after many
+	 * guilds were removed, in which case it calls cache::rehash().
+	 *
+	 * @return true if the cache was rehashed
+	 */
+	bool rehash_if_sparse() {
+		{
+			std::shared_lock l(cache_mutex);
+			size_t buckets = cache_map->bucket_count();
+			if (buckets <= min_rehash_buckets || cache_map->size() * 4 >= buckets) {
+				return false;
+			}
+		}
+		rehash();
+		return true;
+	}
+
 	/**
 	 * @brief Get "real" size in RAM of the cached objects
 	 * 
@@ -255,13 +390,317 @@ public:
 
 };
 
+/**
+ * @brief A cache of dpp::managed objects split into independently locked stripes.
+ *
+ * Has the same find/store/remove/count semantics as dpp::cache, but each object
+ * lives in one of several maps chosen by its snowflake, each with its own lock.
+ * Readers and writers only contend when they touch the same stripe, so the
+ * gateway storing objects no longer blocks every lookup made by event handlers
+ * and REST callbacks. The global caches returned by dpp::get_user_cache() and
+ * friends are sharded caches.
+ *
+ * There is no single container or mutex to lock, so use sharded_cache::for_each()
+ * to visit every object.
+ *
+ * @tparam T class type to store, which should be derived from dpp::managed.
+ * @tparam stripes Number of independently locked maps.
+ */
+template<class T, size_t stripes = 16> class sharded_cache {
+private:
+	static_assert(stripes > 0 && (stripes & (stripes - 1)) == 0, "Stripe count must be a power of two");
+
+	/**
+	 * @brief One map and its lock, on its own cache line so that stripes don't share one
+	 */
+	struct alignas(64) stripe {
+		/**
+		 * @brief Mutex to protect the map
+		 */
+		std::shared_mutex mutex;
+
+		/**
+		 * @brief Pointers to the cached items in this stripe
+		 */
+		std::unordered_map<snowflake, T*> map;
+
+		/**
+		 * @brief Lookups in this stripe
+		 */
+		std::atomic<uint64_t> finds{0};
+
+		/**
+		 * @brief Lookups in this stripe which found an object
+		 */
+		std::atomic<uint64_t> hits{0};
+
+		/**
+		 * @brief Objects removed or replaced in this stripe
+		 */
+		std::atomic<uint64_t> evictions{0};
+	};
+
+	/**
+	 * @brief The stripes
+	 */
+	std::array<stripe, stripes> stripe_list;
+
+	/**
+	 * @brief Fewest buckets in a stripe before sharded_cache::rehash_if_sparse() considers shrinking it
+	 */
+	static constexpr size_t min_rehash_buckets = 256;
+
+	/**
+	 * @brief Pick the stripe for an id.
+	 *
+	 * The low bits of a snowflake are a per-process counter, so the id is mixed
+	 * first to spread consecutive and same-millisecond ids across stripes.
+	 *
+	 * @param id Object snowflake id
+	 * @return The stripe the object lives in
+	 */
+	stripe& stripe_for(snowflake id) {
+		uint64_t mixed = static_cast<uint64_t>(id) * 0x9E3779B97F4A7C15ULL;
+		return stripe_list[(mixed >> 32) & (stripes - 1)];
+	}
+
+public:
+	/**
+	 * @brief Construct a new sharded cache object.
+	 */
+	sharded_cache() = default;
+
+	sharded_cache(const sharded_cache&) = delete;
+	sharded_cache& operator=(const sharded_cache&) = delete;
+
+	/**
+	 * @brief Store an object in the cache. Passing a nullptr will have no effect.
+	 *
+	 * Ownership passes to the cache as with cache::store(). A replaced object is
+	 * put into the garbage collection queue.
+	 *
+	 * @param object object to store. Storing a pointer to the cache relinquishes ownership to the cache object.
+	 */
+	void store(T* object) {
+		if (!object) {
+			return;
+		}
+		stripe& s = stripe_for(object->id);
+		std::unique_lock l(s.mutex);
+		auto existing = s.map.find(object->id);
+		if (existing == s.map.end()) {
+			s.map.emplace(object->id, object);
+		} else if (object != existing->second) {
+			/* Flag old pointer for deletion and replace */
+			std::lock_guard<std::mutex> delete_lock(deletion_mutex);
+			deletion_queue.emplace_back(existing->second, time(nullptr));
+			existing->second = object;
+			s.evictions.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * @brief Remove an object from the cache.
+	 *
+	 * As with cache::remove(), the object is deleted within the next 60 seconds
+	 * by the garbage collection queue.
+	 *
+	 * @param object object to remove. Passing a nullptr will have no effect.
+	 */
+	void remove(T* object) {
+		if (!object) {
+			return;
+		}
+		stripe& s = stripe_for(object->id);
+		std::unique_lock l(s.mutex);
+		std::lock_guard<std::mutex> delete_lock(deletion_mutex);
+		auto existing = s.map.find(object->id);
+		if (existing != s.map.end()) {
+			/* Queue what the map held. If object was since replaced by store(), it is queued already */
+			deletion_queue.emplace_back(existing->second, time(nullptr));
+			s.map.erase(existing);
+			s.evictions.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * @brief Find an object in the cache by id.
+	 *
+	 * @warning Do not hang onto objects returned by sharded_cache::find() indefinitely,
+	 * for the same reasons as cache::find().
+	 *
+	 * @param id Object snowflake id to find
+	 * @return Found object or nullptr if the object with this id does not exist.
+	 */
+	T* find(snowflake id) {
+		stripe& s = stripe_for(id);
+		std::shared_lock l(s.mutex);
+		s.finds.fetch_add(1, std::memory_order_relaxed);
+		auto r = s.map.find(id);
+		if (r != s.map.end()) {
+			s.hits.fetch_add(1, std::memory_order_relaxed);
+			return r->second;
+		}
+		return nullptr;
+	}
+
+	/**
+	 * @brief Return a count of the number of items in the cache.
+	 *
+	 * Stripes are counted one at a time, so this is only a snapshot if other
+	 * threads are storing or removing objects meanwhile.
+	 *
+	 * @return uint64_t count of items in the cache
+	 */
+	uint64_t count() {
+		uint64_t total = 0;
+		for (stripe& s : stripe_list) {
+			std::shared_lock l(s.mutex);
+			total += s.map.size();
+		}
+		return total;
+	}
+
+	/**
+	 * @brief Call a function for every object in the cache.
+	 *
+	 * Each stripe is read locked while its objects are visited.
+	 *
+	 * @warning The function must not store or remove objects in this cache, as
+	 * that would deadlock on the stripe being visited.
+	 *
+	 * @param fn Function called with each object, as `void(T*)`
+	 */
+	template<typename F> void for_each(F&& fn) {
+		for (stripe& s : stripe_list) {
+			std::shared_lock l(s.mutex);
+			for (auto& entry : s.map) {
+				fn(entry.second);
+			}
+		}
+	}
+
+	/**
+	 * @brief "Rehash" every stripe by reallocating its map.
+	 *
+	 * @see cache::rehash
+	 *
+	 * @warning May be time consuming! O(n) in the number of cached entries, but
+	 * only one stripe is locked at a time.
+	 */
+	void rehash() {
+		for (stripe& s : stripe_list) {
+			std::unique_lock l(s.mutex);
+			std::unordered_map<snowflake, T*> n;
+			n.reserve(s.map.size());
+			n.insert(s.map.begin(), s.map.end());
+			s.map.swap(n);
+		}
+	}
+
+	/**
+	 * @brief Rehash the stripes in which most buckets are empty.
+	 *
+	 * @see cache::rehash_if_sparse
+	 *
+	 * @return true if any stripe was rehashed
+	 */
+	bool rehash_if_sparse() {
+		bool rehashed = false;
+		for (stripe& s : stripe_list) {
+			std::unique_lock l(s.mutex);
+			size_t buckets = s.map.bucket_count();
+			if (buckets > min_rehash_buckets && s.map.size() * 4 < buckets) {
+				std::unordered_map<snowflake, T*> n;
+				n.reserve(s.map.size());
+				n.insert(s.map.begin(), s.map.end());
+				s.map.swap(n);
+				rehashed = true;
+			}
+		}
+		return rehashed;
+	}
+
+	/**
+	 * @brief Get "real" size in RAM of the cached objects
+	 *
+	 * This does not include metadata used to maintain the unordered maps themselves.
+	 *
+	 * @return size_t size of cache in bytes
+	 */
+	size_t bytes() {
+		size_t total = sizeof(*this);
+		for (stripe& s : stripe_list) {
+			std::shared_lock l(s.mutex);
+			total += s.map.bucket_count() * sizeof(size_t);
+		}
+		return total;
+	}
+
+	/**
+	 * @brief Get the cache's size and lookup counters.
+	 *
+	 * Counters are totals since the cache was created. Stripes are read one at
+	 * a time, so the figures are only a snapshot while the cache is in use.
+	 *
+	 * @param owned true to add the memory each object owns to the bytes, as estimated by
+	 * owned_bytes(). That reads every object, so hold get_object_mutex() shared while shards
+	 * may be changing them. false counts only the index and the objects themselves.
+	 * @return cache_stats counters
+	 */
+	cache_stats get_stats(bool owned = true) {
+		cache_stats stats;
+		/* Each entry is a map node holding the pointer, plus the object it points to */
+		constexpr size_t entry_bytes = sizeof(T) + sizeof(std::pair<const snowflake, T*>) + 2 * sizeof(void*);
+		stats.bytes = sizeof(*this);
+		for (stripe& s : stripe_list) {
+			std::shared_lock l(s.mutex);
+			stats.entries += s.map.size();
+			stats.bytes += s.map.bucket_count() * sizeof(size_t) + s.map.size() * entry_bytes;
+			if (owned) {
+				for (const auto& entry : s.map) {
+					stats.bytes += owned_bytes(*entry.second);
+				}
+			}
+			stats.finds += s.finds.load(std::memory_order_relaxed);
+			stats.hits += s.hits.load(std::memory_order_relaxed);
+			stats.evictions += s.evictions.load(std::memory_order_relaxed);
+		}
+		stats.misses = stats.finds - stats.hits;
+		return stats;
+	}
+
+};
+
 /**
  * Run garbage collection across all caches removing deleted items
- * that have been deleted over 60 seconds ago.
+ * that have been deleted over 60 seconds ago, and shrinking caches
+ * that have become sparse.
  */
 void DPP_EXPORT garbage_collection();
 
-#define cache_decl(type, setter, getter, counter) /** Find an object in the cache by id. @return type* Pointer to the object or nullptr when it's not found */ DPP_EXPORT class type * setter (snowflake id); DPP_EXPORT cache<class type> * getter (); /** Get the amount of cached type objects. */ DPP_EXPORT uint64_t counter ();
+/**
+ * @brief Get the garbage collection counters.
+ *
+ * @return gc_stats counters since the process started
+ */
+DPP_EXPORT gc_stats get_gc_stats();
+
+/**
+ * @brief Get the lock which guards the contents of cached objects.
+ *
+ * The caches only lock their maps. Shards change cached objects in place while handling
+ * gateway events, e.g. a guild's member map or a channel's permission overwrites, and hold
+ * this lock exclusively while they do. Hold it shared to read or copy a cached object from
+ * another thread. A large event such as GUILD_CREATE can hold it for a long time, so a thread
+ * which must not stall should try_lock_shared() it and treat failure as a cache miss.
+ *
+ * @warning Event handlers run with it held, so they must not lock it themselves.
+ * @return The mutex guarding cached objects
+ */
+DPP_EXPORT std::shared_mutex& get_object_mutex();
+
+#define cache_decl(type, setter, getter, counter) /** Find an object in the cache by id. @return type* Pointer to the object or nullptr when it's not found */ DPP_EXPORT class type * setter (snowflake id); DPP_EXPORT sharded_cache<class type> * getter (); /** Get the amount of cached type objects. */ DPP_EXPORT uint64_t counter ();
 
 /* Declare major caches */
 cache_decl(user, find_user, get_user_cache, get_user_count);
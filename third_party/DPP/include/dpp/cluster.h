@@ -250,7 +250,9 @@ public:
 	 * @param compressed Whether or not to use compression for shards on this cluster. Saves a ton of bandwidth at the cost of some CPU
 	 * @param policy Set the caching policy for the cluster, either lazy (only cache users/members when they message the bot) or aggressive (request whole member lists on seeing new guilds too)
 	 * @param request_threads The number of threads to allocate for making HTTP requests to Discord. This defaults to 12. You can increase this at runtime via the object returned from get_rest().
+	 * If this is zero, no queue is created and you must call cluster::set_request_queues() before making any requests.
 	 * @param request_threads_raw The number of threads to allocate for making HTTP requests to sites outside of Discord. This defaults to 1. You can increase this at runtime via the object returned from get_raw_rest().
+	 * If this is zero, no queue is created and you must call cluster::set_request_queues() before making any requests.
 	 * @throw dpp::exception Thrown on windows, if WinSock fails to initialise, or on any other system if a dpp::request_queue fails to construct
 	 */
 	cluster(const std::string& token, uint32_t intents = i_default_intents, uint32_t shards = 0, uint32_t cluster_id = 0, uint32_t maxclusters = 1, bool compressed = true, cache_policy_t policy = cache_policy::cpol_default, uint32_t request_threads = 12, uint32_t request_threads_raw = 1);
@@ -286,6 +288,29 @@ public:
 	 */
 	void shutdown();
 
+	/**
+	 * @brief End cluster execution like shutdown(), but close each shard's connection in a way
+	 * which leaves its gateway session open on Discord's side, so that another cluster, possibly
+	 * in another process, can resume it and receive the events missed in between.
+	 *
+	 * Discord keeps such sessions only for a short while; a session which has expired is
+	 * identified afresh when resumed.
+	 *
+	 * @return std::vector<shard_session> The sessions of the shards which were running
+	 */
+	std::vector<shard_session> shutdown_resumable();
+
+	/**
+	 * @brief Resume these sessions, e.g. from shutdown_resumable(), rather than identifying
+	 * when the cluster is next started. Sessions are matched to shards by shard id, and are
+	 * used only if they were identified with the same total number of shards. A session
+	 * Discord no longer accepts falls back to identifying. Consumed by the next start().
+	 *
+	 * @param sessions Sessions to resume
+	 * @return cluster& Reference to self for chaining.
+	 */
+	cluster& set_resume_sessions(const std::vector<shard_session>& sessions);
+
 	/**
 	 * @brief Get the rest_queue object which handles HTTPS requests to Discord
 	 * @return request_queue* pointer to request_queue object
@@ -298,6 +323,23 @@ public:
 	 */
 	request_queue* get_raw_rest();
 
+	/**
+	 * @brief Use request queues shared with other clusters, instead of ones owned by this cluster.
+	 * This lets several bots in one process share a fixed pool of HTTP threads. Each cluster's
+	 * requests are still rate limited per bucket against its own token, but a global rate limit
+	 * stalls the whole shared queue. Any queue this cluster already owns is destroyed.
+	 *
+	 * The queues must have been constructed with a nullptr owner, and must outlive this cluster.
+	 * When the cluster is destroyed it detaches itself from them, dropping its pending requests.
+	 * You should call this method before cluster::start.
+	 *
+	 * @param shared_rest Shared queue for HTTPS requests to Discord
+	 * @param shared_raw_rest Shared queue for all other HTTP(S) requests
+	 * @return cluster& Reference to self for chaining.
+	 * @throw dpp::logic_exception If called after the cluster is started, or if either queue is not shared
+	 */
+	cluster& set_request_queues(request_queue* shared_rest, request_queue* shared_raw_rest);
+
 	/**
 	 * @brief Set the websocket protocol for all shards on this cluster.
 	 * You should call this method before cluster::start.
@@ -1461,8 +1503,9 @@ public:
 	 * @param filecontent File content to post for POST requests (for uploading files)
 	 * @param filemimetype File content to post for POST requests (for uploading files)
 	 * @param protocol HTTP protocol to use (1.0 and 1.1 are supported)
+	 * @param priority Scheduling priority of the request within its request thread
 	 */
-	void post_rest(const std::string &endpoint, const std::string &major_parameters, const std::string &parameters, http_method method, const std::string &postdata, json_encode_t callback, const std::string &filename = "", const std::string &filecontent = "", const std::string &filemimetype = "", const std::string& protocol = "1.1");
+	void post_rest(const std::string &endpoint, const std::string &major_parameters, const std::string &parameters, http_method method, const std::string &postdata, json_encode_t callback, const std::string &filename = "", const std::string &filecontent = "", const std::string &filemimetype = "", const std::string& protocol = "1.1", http_priority priority = p_normal);
 
 	/**
 	 * @brief Post a multipart REST request. Where possible use a helper method instead like message_create
@@ -1474,8 +1517,9 @@ public:
 	 * @param postdata Post data (usually JSON encoded)
 	 * @param callback Function to call when the HTTP call completes. The callback parameter will contain amongst other things, the decoded json.
 	 * @param file_data List of files to post for POST requests (for uploading files)
+	 * @param priority Scheduling priority of the request within its request thread
 	 */
-	void post_rest_multipart(const std::string &endpoint, const std::string &major_parameters, const std::string &parameters, http_method method, const std::string &postdata, json_encode_t callback, const std::vector<message_file_data> &file_data = {});
+	void post_rest_multipart(const std::string &endpoint, const std::string &major_parameters, const std::string &parameters, http_method method, const std::string &postdata, json_encode_t callback, const std::vector<message_file_data> &file_data = {}, http_priority priority = p_normal);
 
 	/**
 	 * @brief Make a HTTP(S) request. For use when wanting asynchronous access to HTTP APIs outside of Discord.
@@ -34,6 +34,7 @@
 #include <deque>
 #include <mutex>
 #include <shared_mutex>
+#include <atomic>
 
 
 
@@ -146,6 +147,52 @@ public:
 	voiceconn& disconnect();
 };
 
+/**
+ * @brief The state needed to resume a shard's gateway session from another connection,
+ * or from another process
+ */
+struct DPP_EXPORT shard_session {
+	/**
+	 * @brief Shard ID the session belongs to
+	 */
+	uint32_t shard_id = 0;
+
+	/**
+	 * @brief Total number of shards when the session was identified
+	 */
+	uint32_t max_shards = 0;
+
+	/**
+	 * @brief Discord session id, empty if the shard never became ready
+	 */
+	std::string session_id;
+
+	/**
+	 * @brief The gateway address to resume the session on
+	 */
+	std::string resume_gateway_url;
+
+	/**
+	 * @brief Last sequence number received on the session
+	 */
+	uint64_t last_seq = 0;
+};
+
+/**
+ * @brief Dispatches a shard has received of one event type
+ */
+struct DPP_EXPORT event_stats {
+	/**
+	 * @brief Number received since the shard was created
+	 */
+	uint64_t total = 0;
+
+	/**
+	 * @brief Number received per second, as a moving average over roughly the last ten seconds
+	 */
+	double per_second = 0.0;
+};
+
 /** @brief Implements a discord client. Each discord_client connects to one shard and derives from a websocket client. */
 class DPP_EXPORT discord_client : public websocket_client
 {
@@ -192,10 +239,65 @@ private:
 	std::deque<std::string> message_queue;
 
 	/**
-	 * @brief Thread this shard is executing on
+	 * @brief Thread this shard is executing on. When the shard runs on the socket
+	 * engine, this is instead the thread of the last reconnection, if any.
 	 */
 	std::thread* runner;
 
+	/**
+	 * @brief True if the shard is serviced by the socket engine rather than its own thread
+	 */
+	bool uses_engine;
+
+	/**
+	 * @brief True to close the connection with a code which leaves the session
+	 * resumable, rather than ending it, when the shard is destroyed
+	 */
+	bool resumable_close;
+
+	/**
+	 * @brief True if the gateway asked for an identify which has to wait for the
+	 * cluster's 5 second identify spacing. The timer sends it once the wait is over.
+	 */
+	bool identify_pending;
+
+	/**
+	 * @brief Dispatch counts of one event type, with the count for the second in progress
+	 */
+	struct event_counter {
+		/**
+		 * @brief Counts reported by get_event_stats()
+		 */
+		event_stats stats;
+
+		/**
+		 * @brief Number received since the rates were last updated
+		 */
+		uint64_t this_second = 0;
+	};
+
+	/**
+	 * @brief Mutex for event_counters
+	 */
+	std::mutex stats_mutex;
+
+	/**
+	 * @brief Dispatch counts keyed by event name
+	 */
+	std::map<std::string, event_counter, std::less<>> event_counters;
+
+	/**
+	 * @brief Count a received dispatch
+	 * @param event Event name, e.g. MESSAGE_CREATE
+	 */
+	void count_dispatch(std::string_view event);
+
+	/**
+	 * @brief Fold the last second's dispatch counts into the per second rates.
+	 * Called once a second from the timer.
+	 */
+	void update_event_rates();
+
 	/**
 	 * @brief Run shard loop under a thread.
 	 * Calls discord_client::run() from within a std::thread.
@@ -203,17 +305,47 @@ private:
 	void thread_run();
 
 	/**
-	 * @brief If true, stream compression is enabled
+	 * @brief Close the current connection and connect again, retrying every
+	 * 5 seconds until connected or terminating
 	 */
-	bool compressed;
+	void reconnect();
+
+	/**
+	 * @brief Send a close frame and close the socket, if it is still open
+	 */
+	void graceful_close();
+
+	/**
+	 * @brief Identify a new session, or leave it to the timer if the cluster
+	 * identified another shard less than 5 seconds ago
+	 */
+	void identify();
 
 	/**
-	 * @brief ZLib decompression buffer
+	 * @brief Hand the connected socket to the socket engine
+	 * @throw dpp::connection_exception The socket could not be added
 	 */
-	unsigned char* decomp_buffer;
+	void engine_add();
 
 	/**
-	 * @brief Decompressed string
+	 * @brief Called by the socket engine when the connection ends
+	 */
+	void engine_end();
+
+	/**
+	 * @brief Reconnect a shard which runs on the socket engine. Runs on a thread of
+	 * its own so that the blocking connect does not hold up other shards.
+	 */
+	void engine_reconnect();
+
+	/**
+	 * @brief If true, stream compression is enabled
+	 */
+	bool compressed;
+
+	/**
+	 * @brief ZLib decompression buffer. Inflated frames are written straight into it and it is
+	 * reused for every frame, only ever growing, so its size is not the length of the last frame.
 	 */
 	std::string decompressed;
 
@@ -240,6 +372,11 @@ private:
 	 */
 	double ping_start;
 
+	/**
+	 * @brief The most recent ping message queued on this shard, which we check for to monitor latency
+	 */
+	std::string last_ping_message;
+
 	/**
 	 * @brief ETF parser for when in ws_etf mode
 	 */
@@ -272,6 +409,12 @@ private:
 	 */
 	void set_resume_hostname();
 
+	/**
+	 * @brief Stop the shard's loop and wait for it to finish. Once this returns the session
+	 * state no longer changes. If the shard has its own thread, that thread has closed the socket.
+	 */
+	void stop_loop();
+
 	/**
 	 * @brief Clean up resources
 	 */
@@ -349,6 +492,39 @@ public:
 	 */
 	double websocket_ping;
 
+	/**
+	 * @brief Number of dispatches (events) received since the shard was created,
+	 * including those dropped unparsed because nothing handles them
+	 */
+	std::atomic<uint64_t> dispatch_count;
+
+	/**
+	 * @brief Time the last dispatch was received, in fractional seconds since the epoch,
+	 * or zero if there has been none
+	 */
+	std::atomic<double> last_dispatch;
+
+	/**
+	 * @brief Time the frame being handled was received, in fractional seconds since the epoch,
+	 * or zero unless frame timing is on. Event handlers run while their frame is handled, so
+	 * they can read this through event.from to find how long the event took to reach them.
+	 * @see discord_client::set_frame_timing
+	 */
+	double frame_received;
+
+	/**
+	 * @brief Time the frame being handled had been decompressed and parsed, in fractional
+	 * seconds since the epoch, or zero unless frame timing is on. See dpp::discord_client::frame_received.
+	 */
+	double frame_parsed;
+
+	/**
+	 * @brief Choose whether every shard stamps frame_received and frame_parsed.
+	 * Off by default, as it reads the clock twice per frame.
+	 * @param enabled true to stamp frames
+	 */
+	static void set_frame_timing(bool enabled);
+
 	/**
 	 * @brief True if READY or RESUMED has been received
 	 */
@@ -389,7 +565,22 @@ public:
 	 * @param j JSON object for the event content
 	 * @param raw Raw JSON event string
 	 */
-	virtual void handle_event(const std::string &event, json &j, const std::string &raw);
+	virtual void handle_event(const std::string &event, json &j, std::string_view raw);
+
+	/**
+	 * @brief Check if anything acts on a dispatch event, either an attached event handler
+	 * or the library's own cache. Events that nothing acts on are dropped without being parsed.
+	 * @param event Event name, e.g. TYPING_START
+	 * @return true if the event must be parsed and handled
+	 */
+	bool is_event_wanted(std::string_view event) const;
+
+	/**
+	 * @brief Get the number of dispatches received and their rate, for each event type
+	 * the shard has received at least once
+	 * @return std::map<std::string, event_stats> Counts keyed by event name, e.g. MESSAGE_CREATE
+	 */
+	std::map<std::string, event_stats> get_event_stats();
 
 	/**
 	 * @brief Get the Guild Count for this shard
@@ -478,13 +669,27 @@ public:
 	 */
 	uint64_t get_decompressed_bytes_in();
 
+	/**
+	 * @brief Get the state needed to resume this shard's session
+	 * @return shard_session The session id, resume url and last sequence number
+	 */
+	shard_session get_session() const;
+
+	/**
+	 * @brief Resume an existing session, e.g. one kept by a previous process, rather than
+	 * identifying afresh. Must be called before run(). If Discord no longer accepts the
+	 * session the shard falls back to identifying.
+	 * @param session Session to resume
+	 */
+	void set_session(const shard_session& session);
+
 	/**
 	 * @brief Handle JSON from the websocket.
 	 * @param buffer The entire buffer content from the websocket client
 	 * @param opcode The type of frame, e.g. text or binary
 	 * @returns True if a frame has been handled
 	 */
-	virtual bool handle_frame(const std::string &buffer, ws_opcode opcode);
+	virtual bool handle_frame(std::string_view buffer, ws_opcode opcode);
 
 	/**
 	 * @brief Handle a websocket error.
@@ -493,9 +698,8 @@ public:
 	virtual void error(uint32_t errorcode);
 
 	/**
-	 * @brief Start and monitor I/O loop.
-	 * @note this is a blocking call and is usually executed within a
-	 * thread by whatever creates the object.
+	 * @brief Start and monitor I/O loop, on a thread of its own or on the
+	 * socket engine if dpp::socket_engine::is_enabled() is true.
 	 */
 	void run();
 
@@ -119,7 +119,7 @@ public:
 	 * @param client The shard the event originated on. May be a nullptr, e.g. for voice events
 	 * @param raw Raw event data as JSON or ETF
 	 */
-	event_dispatch_t(discord_client* client, const std::string& raw);
+	event_dispatch_t(discord_client* client, std::string_view raw);
 
 	/**
 	 * @brief Construct a new event_dispatch_t object
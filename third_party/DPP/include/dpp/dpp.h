@@ -62,6 +62,8 @@
 #include <dpp/application.h>
 #include <dpp/scheduled_event.h>
 #include <dpp/discordclient.h>
+#include <dpp/json_scan.h>
+#include <dpp/socketengine.h>
 #include <dpp/dispatcher.h>
 #include <dpp/cluster.h>
 #include <dpp/cache.h>
@@ -36,6 +36,7 @@
 #include <dpp/export.h>
 #include <dpp/snowflake.h>
 #include <dpp/json_fwd.h>
+#include <string_view>
 
 namespace dpp {
 
@@ -694,7 +695,7 @@ public:
 	 * @return nlohmann::json JSON data for use in the library
 	 * @throw dpp::exception Malformed or otherwise invalid ETF content
 	 */
-	nlohmann::json parse(const std::string& in);
+	nlohmann::json parse(std::string_view in);
 
 	/**
 	 * @brief Create ETF binary data from nlohmann::json
@@ -23,9 +23,10 @@
 #include <dpp/export.h>
 #include <dpp/snowflake.h>
 #include <dpp/json_fwd.h>
+#include <string_view>
 
 #define event_decl(x,wstype) /** @brief Internal event handler for wstype websocket events. Called for each websocket message of this type. @internal */ \
-	class x : public event { public: virtual void handle(class dpp::discord_client* client, nlohmann::json &j, const std::string &raw); };
+	class x : public event { public: virtual void handle(class dpp::discord_client* client, nlohmann::json &j, std::string_view raw); };
 
 /**
  * @brief The events namespace holds the internal event handlers for each websocket event.
@@ -42,9 +43,9 @@ public:
 	 * @brief Pure virtual method for event handler code
 	 * @param client The creating shard
 	 * @param j The json data of the event
-	 * @param raw The raw event json
+	 * @param raw The raw event json. This views the receive buffer and is only valid during the call.
 	 */
-	virtual void handle(class discord_client* client, nlohmann::json &j, const std::string &raw) = 0;
+	virtual void handle(class discord_client* client, nlohmann::json &j, std::string_view raw) = 0;
 };
 
 /* Internal logger */
@@ -103,6 +103,7 @@ enum exception_error_code {
 	err_icon_size = 35,
 	err_massive_audio = 36,
 	err_unknown = 37,
+	err_request_queue_already_set = 38,
 	err_bad_request = 400,
 	err_unauthorized = 401,
 	err_payment_required = 402,
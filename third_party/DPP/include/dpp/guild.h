@@ -435,6 +435,8 @@ protected:
 
 	friend void from_json(const nlohmann::json& j, guild_member& gm);
 
+	friend size_t owned_bytes(const guild_member& object);
+
 public:
 	/**
 	 * @brief Guild id
@@ -0,0 +1,112 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+#include <dpp/export.h>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace dpp {
+
+/**
+ * @brief Structural scanning of JSON text, for reading a few fields out of a document
+ * without building a json object from it.
+ *
+ * On x86 the scanner looks for quotes, escapes and brackets sixteen bytes at a time
+ * using SSE2. Other platforms, and x86 with the SIMD path switched off, use a plain
+ * byte loop. Both paths give identical results.
+ *
+ * Only the payload header is read this way. Event data for handled events is still
+ * decoded with nlohmann::json and each type's fill_from_json.
+ */
+namespace json_scan {
+
+/**
+ * @brief The top level fields of a gateway payload, read without parsing the event data
+ */
+struct DPP_EXPORT frame_header {
+	/**
+	 * @brief Gateway opcode, if present
+	 */
+	std::optional<uint32_t> op;
+
+	/**
+	 * @brief Sequence number, if present and not null
+	 */
+	std::optional<uint64_t> seq;
+
+	/**
+	 * @brief Event name for dispatches, or empty
+	 */
+	std::string_view event;
+};
+
+/**
+ * @brief Returns true if the running CPU can use the SIMD scanner
+ */
+bool DPP_EXPORT simd_supported();
+
+/**
+ * @brief Choose between the SIMD and scalar scanner for the whole process.
+ * Enabling it has no effect on a CPU without SIMD support.
+ *
+ * @param enable true to use SIMD where supported, false to force the scalar path
+ * @return true if the SIMD scanner is now in use
+ */
+bool DPP_EXPORT set_simd(bool enable);
+
+/**
+ * @brief Returns true if the SIMD scanner is currently in use
+ */
+bool DPP_EXPORT simd_enabled();
+
+/**
+ * @brief Skip whitespace in JSON text
+ *
+ * @param s JSON text
+ * @param pos position to start at
+ * @return position of the next non-whitespace character
+ */
+size_t DPP_EXPORT skip_space(std::string_view s, size_t pos);
+
+/**
+ * @brief Skip over a JSON value without decoding it
+ *
+ * @param s JSON text
+ * @param pos position of the first character of the value
+ * @return position after the value, or std::string_view::npos if it is malformed
+ */
+size_t DPP_EXPORT skip_value(std::string_view s, size_t pos);
+
+/**
+ * @brief Read op, s and t from a JSON gateway payload, skipping d without parsing it.
+ * Stops as soon as all three have been seen.
+ *
+ * @param s JSON text of the payload
+ * @param header receives the fields found. The event name points into s.
+ * @return false if the payload could not be scanned, in which case it should just be parsed
+ */
+bool DPP_EXPORT read_frame_header(std::string_view s, frame_header &header);
+
+} // namespace json_scan
+
+} // namespace dpp
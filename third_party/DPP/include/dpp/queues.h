@@ -25,8 +25,10 @@
 #include <string>
 #include <queue>
 #include <map>
+#include <utility>
 #include <thread>
 #include <shared_mutex>
+#include <mutex>
 #include <vector>
 #include <functional>
 #include <condition_variable>
@@ -206,6 +208,24 @@ enum http_method {
 	m_delete
 };
 
+/**
+ * @brief Scheduling priority of a HTTP request within its in_thread.
+ * Requests with a higher priority are sent before lower priority requests
+ * queued on the same thread, and will interrupt a batch of lower priority
+ * requests that is already being processed.
+ */
+enum http_priority : uint8_t {
+	/**
+	 * @brief Normal priority, used for most REST calls.
+	 */
+	p_normal = 0,
+
+	/**
+	 * @brief Urgent priority, for requests with a hard deadline such as interaction responses.
+	 */
+	p_urgent = 1,
+};
+
 /**
  * @brief A HTTP request.
  * 
@@ -294,6 +314,18 @@ public:
 	 */
 	std::string protocol;
 
+	/**
+	 * @brief Scheduling priority of this request, see dpp::http_priority.
+	 */
+	http_priority priority;
+
+	/**
+	 * @brief The cluster which made this request, used for its token, logging and rate limit buckets.
+	 * If nullptr, the cluster owning the request_queue is used. Must be set for requests posted to
+	 * a shared request_queue.
+	 */
+	class cluster* owner;
+
 	/**
 	 * @brief How many seconds before the connection is considered failed if not finished
 	 *
@@ -365,6 +397,21 @@ public:
 	bool is_completed();
 };
 
+/**
+ * @brief Function called with every HTTP request once it has been made, see dpp::set_rest_observer.
+ *
+ * @note Called on the thread which made the request, before the request's own completion event.
+ */
+typedef void (*rest_observer_t)(const http_request& request, const http_request_completion_t& result);
+
+/**
+ * @brief Set a function to be called with the outcome of every HTTP request made by any cluster,
+ * such as for counting status codes or timing requests.
+ *
+ * @param observer Function to call, or nullptr to remove it.
+ */
+void DPP_EXPORT set_rest_observer(rest_observer_t observer);
+
 /**
  * @brief A rate limit bucket. The library builds one of these for
  * each endpoint.
@@ -438,12 +485,41 @@ private:
 	std::condition_variable in_ready;
 
 	/**
-	 * @brief Rate-limit bucket counters.
+	 * @brief Mutex used with in_ready, guarding the wake-up flags below.
+	 */
+	std::mutex ready_mutex;
+
+	/**
+	 * @brief True when requests have been posted since the queue was last gathered.
+	 */
+	std::atomic<bool> pending;
+
+	/**
+	 * @brief True when a request above p_normal priority has been posted since the
+	 * queue was last gathered. Checked between requests to preempt the current batch.
+	 */
+	std::atomic<bool> urgent_pending;
+
+	/**
+	 * @brief The cluster whose request is currently being made, or nullptr when idle.
+	 * Used by detach() to wait for an in-flight request to finish.
+	 */
+	std::atomic<class cluster*> running_owner;
+
+	/**
+	 * @brief Rate-limit bucket counters, keyed by requesting cluster and endpoint,
+	 * so that clusters sharing a request_queue never share a bucket.
 	 */
-	std::map<std::string, bucket_t> buckets;
+	std::map<std::pair<const class cluster*, std::string>, bucket_t> buckets;
+
+	/**
+	 * @brief Mutex guarding buckets, which detach() purges from another thread
+	 */
+	std::mutex buckets_mutex;
 
 	/**
 	 * @brief Queue of requests to be made. Sorted by http_request::endpoint.
+	 * The in_loop processes a snapshot of this in http_request::priority order.
 	 */
 	std::vector<std::unique_ptr<http_request>> requests_in;
 
@@ -481,6 +557,20 @@ public:
 	 * been executed.
 	 */
 	void post_request(std::unique_ptr<http_request> req);
+
+	/**
+	 * @brief Wake the thread without posting a request, so it rechecks its queue
+	 * and keeps its connection warm if the request_queue asks for it.
+	 */
+	void wake();
+
+	/**
+	 * @brief Cancel all queued requests made by a cluster, and wait for any of its
+	 * requests currently in flight on this thread to finish.
+	 *
+	 * @param owner Cluster to detach
+	 */
+	void detach(class cluster* owner);
 };
 
 /**
@@ -498,6 +588,11 @@ public:
  * There are usually two request_queue objects in each dpp::cluster, one of which is used
  * internally for the various REST methods to Discord such as sending messages, and the other
  * used to support user REST calls via dpp::cluster::request().
+ *
+ * A request_queue constructed without an owning cluster is shared, and can be given to any
+ * number of clusters via dpp::cluster::set_request_queues(). Each request then carries its
+ * own cluster in http_request::owner, and rate limit buckets are kept separate per cluster.
+ * The global rate limit pause still applies to the whole queue.
  */
 class DPP_EXPORT request_queue {
 protected:
@@ -507,7 +602,7 @@ protected:
 	friend class in_thread;
 
 	/**
-	 * @brief The cluster that owns this request_queue
+	 * @brief The cluster that owns this request_queue, or nullptr if it is shared
 	 */
 	class cluster* creator;
 
@@ -551,6 +646,17 @@ protected:
 	 */
 	std::queue<completed_request> responses_out;
 
+	/**
+	 * @brief The cluster whose completion callback is currently being called, or nullptr.
+	 * Used by detach() to wait for a running callback to return.
+	 */
+	std::atomic<class cluster*> completing_owner;
+
+	/**
+	 * @brief True if each in_thread should keep a connection to Discord open while idle
+	 */
+	std::atomic<bool> keep_warm;
+
 	/**
 	 * @brief A vector of inbound request threads forming a pool.
 	 * There are a set number of these defined by a constant in queues.cpp. A request is always placed
@@ -626,7 +732,7 @@ public:
 
 	/**
 	 * @brief constructor
-	 * @param owner The creating cluster.
+	 * @param owner The creating cluster, or nullptr to create a queue that can be shared between clusters.
 	 * @param request_threads The number of http request threads to allocate to the threadpool.
 	 * By default eight threads are allocated.
 	 * Side effects: Creates threads for the queue
@@ -669,6 +775,31 @@ public:
 	 * @return true if globally rate limited
 	 */
 	bool is_globally_ratelimited() const;
+
+	/**
+	 * @brief Returns true if this queue is not owned by a cluster and may be shared between several
+	 * @return true if shared
+	 */
+	bool is_shared() const;
+
+	/**
+	 * @brief Keep a connection to Discord open on every request thread, so that requests
+	 * made after an idle period don't have to wait for DNS, TCP and TLS setup first.
+	 * Each thread opens its connection straight away and replaces it whenever it expires
+	 * from the keepalive cache, at the cost of a few idle connections. This is only done
+	 * while a thread has no requests queued, so it never delays one.
+	 * @param warm True to keep connections warm, false to let them expire
+	 * @return reference to self
+	 */
+	request_queue& set_keep_warm(bool warm = true);
+
+	/**
+	 * @brief Detach a cluster from a shared queue before it is destroyed.
+	 * Queued requests and pending callbacks belonging to the cluster are discarded, and
+	 * this waits for any of its requests or callbacks that are currently running.
+	 * @param owner Cluster to detach
+	 */
+	void detach(class cluster* owner);
 };
 
 }
@@ -0,0 +1,207 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+#include <dpp/export.h>
+#include <dpp/socket.h>
+#include <atomic>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace dpp {
+
+class ssl_client;
+
+/**
+ * @brief Called on the engine thread when a connection serviced by a socket_engine ends,
+ * after it has been removed from the engine. It is not called for connections removed
+ * with socket_engine::remove().
+ */
+typedef std::function<void()> socket_end_t;
+
+/**
+ * @brief Services many non-blocking ssl_client connections from a single thread using epoll,
+ * in place of a thread per connection each running ssl_client::read_loop(). The one second
+ * timer of every connection is called from the same thread.
+ *
+ * There is one engine per process, shared by the shards of every cluster. Data written to a
+ * connection from another thread is picked up on the engine's next pass, at most a second later;
+ * discord_client only writes from its timer, so this does not delay gateway traffic.
+ *
+ * @note Only available on Linux. Elsewhere available() returns false and shards keep a
+ * thread each.
+ */
+class DPP_EXPORT socket_engine {
+private:
+	/**
+	 * @brief A connection registered with the engine
+	 */
+	struct connection {
+		/**
+		 * @brief The connection being serviced
+		 */
+		ssl_client* client;
+
+		/**
+		 * @brief Called when the connection ends
+		 */
+		socket_end_t on_end;
+
+		/**
+		 * @brief True if epoll is currently watching for writeability
+		 */
+		bool want_write;
+
+		/**
+		 * @brief True once removed. Kept until the end of the engine pass, as
+		 * readiness events already taken from epoll may still point at it.
+		 */
+		bool ended;
+	};
+
+	/**
+	 * @brief epoll instance
+	 */
+	int epoll_fd;
+
+	/**
+	 * @brief eventfd used to wake the engine thread
+	 */
+	int wake_fd;
+
+	/**
+	 * @brief True when the engine thread should exit
+	 */
+	std::atomic<bool> terminating;
+
+	/**
+	 * @brief Held while the engine thread services connections, so that remove()
+	 * returns only once the engine is no longer using the connection
+	 */
+	std::recursive_mutex mutex;
+
+	/**
+	 * @brief Registered connections
+	 */
+	std::unordered_map<ssl_client*, std::unique_ptr<connection>> connections;
+
+	/**
+	 * @brief Removed connections, freed at the end of the current pass
+	 */
+	std::vector<std::unique_ptr<connection>> retired;
+
+	/**
+	 * @brief Time the one second timers were last called
+	 */
+	time_t last_tick;
+
+	/**
+	 * @brief Engine thread
+	 */
+	std::thread* runner;
+
+	/**
+	 * @brief Create the engine and start its thread
+	 * @throw dpp::connection_exception epoll is not available
+	 */
+	socket_engine();
+
+	/**
+	 * @brief Engine thread loop
+	 */
+	void thread_run();
+
+	/**
+	 * @brief Stop watching a connection and retire it
+	 * @param c connection to stop
+	 * @param notify true to call its on_end
+	 */
+	void end(connection* c, bool notify);
+
+	/**
+	 * @brief Read and write a connection which epoll reported ready
+	 * @param c connection to service
+	 * @param events epoll event flags
+	 */
+	void service(connection* c, uint32_t events);
+
+	/**
+	 * @brief Update epoll's interest in writeability to match the connection
+	 * @param c connection to update
+	 */
+	void update_interest(connection* c);
+
+public:
+	/**
+	 * @brief Returns true if the engine is supported on this platform
+	 */
+	static bool available();
+
+	/**
+	 * @brief Choose whether shards started from now on run on the engine.
+	 * Has no effect where the engine is not available.
+	 * @param enabled true to run shards on the engine, false for a thread per shard
+	 */
+	static void set_enabled(bool enabled);
+
+	/**
+	 * @brief Returns true if shards started from now on will run on the engine
+	 */
+	static bool is_enabled();
+
+	/**
+	 * @brief Get the process wide engine, starting it on first use
+	 * @throw dpp::connection_exception The engine is not available
+	 */
+	static socket_engine& get();
+
+	/**
+	 * @brief Start servicing a connected client. ssl_client::prepare_loop() must have been called.
+	 * @param client Client to service. It must be removed before it is destroyed.
+	 * @param on_end Called when the connection ends, e.g. to reconnect it
+	 * @throw dpp::connection_exception The socket could not be watched
+	 */
+	void add(ssl_client* client, socket_end_t on_end);
+
+	/**
+	 * @brief Stop servicing a client. Once this returns the engine thread is not using it.
+	 * Does nothing if the client is not registered.
+	 * @param client Client to remove
+	 */
+	void remove(ssl_client* client);
+
+	/**
+	 * @brief Get the number of connections being serviced
+	 */
+	size_t size();
+
+	/**
+	 * @brief Stop the engine thread
+	 */
+	~socket_engine();
+};
+
+} // namespace dpp
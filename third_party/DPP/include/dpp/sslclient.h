@@ -23,6 +23,7 @@
 #include <dpp/export.h>
 #include <dpp/misc-enum.h>
 #include <string>
+#include <deque>
 #include <functional>
 #include <ctime>
 #include <dpp/socket.h>
@@ -64,6 +65,38 @@ bool close_socket(dpp::socket sfd);
  */
 bool set_nonblocking(dpp::socket sockfd, bool non_blocking);
 
+/**
+ * @brief Counters for outbound connections made by all ssl_client instances in the process
+ */
+struct DPP_EXPORT connection_stats {
+	/**
+	 * @brief New TCP connections opened
+	 */
+	uint64_t opened = 0;
+
+	/**
+	 * @brief Connections taken from the keepalive cache instead of opening a new one
+	 */
+	uint64_t reused = 0;
+
+	/**
+	 * @brief TLS handshakes which resumed a previous session
+	 */
+	uint64_t tls_resumed = 0;
+
+	/**
+	 * @brief TLS handshakes which negotiated a new session
+	 */
+	uint64_t tls_full = 0;
+};
+
+/**
+ * @brief Get the connection counters for all ssl_client instances
+ *
+ * @return connection_stats counters since the process started
+ */
+DPP_EXPORT connection_stats get_connection_stats();
+
 /**
  * @brief Implements a simple non-blocking SSL stream client.
  * 
@@ -73,6 +106,11 @@ bool set_nonblocking(dpp::socket sockfd, bool non_blocking);
  */
 class DPP_EXPORT ssl_client
 {
+	/**
+	 * @brief Drives connections through prepare_loop() and handle_io() instead of read_loop()
+	 */
+	friend class socket_engine;
+
 private:
 	/**
 	 * @brief Clean up resources
@@ -85,9 +123,10 @@ protected:
 	std::string buffer;
 
 	/**
-	 * @brief Output buffer for sending to socket
+	 * @brief Output queue for sending to socket. Chunks are sent straight from the front
+	 * and dropped once fully written, so sending never moves the rest of the queue.
 	 */
-	std::string obuffer;
+	std::deque<std::string> obuffer;
 
 	/**
 	 * @brief True if in nonblocking mode. The socket switches to nonblocking mode
@@ -145,6 +184,47 @@ protected:
 	 */
 	bool make_new;
 
+	/**
+	 * @brief Bytes of the front output chunk currently being written
+	 */
+	size_t client_to_server_length;
+
+	/**
+	 * @brief Bytes of the front output chunk already written
+	 */
+	size_t client_to_server_offset;
+
+	/**
+	 * @brief True if a read must wait for the socket to become writeable
+	 */
+	bool read_blocked_on_write;
+
+	/**
+	 * @brief True if a write must wait for the socket to become readable
+	 */
+	bool write_blocked_on_read;
+
+	/**
+	 * @brief Switch the connected socket to non-blocking mode and reset the send state,
+	 * ready for read_loop() or a socket_engine to service it.
+	 * @throw dpp::connection_exception The socket is invalid or cannot be made non-blocking
+	 */
+	void prepare_loop();
+
+	/**
+	 * @brief Returns true if the socket should be polled for writeability
+	 */
+	bool wants_write() const;
+
+	/**
+	 * @brief Read and write whatever the socket is ready for
+	 * @param readable True if the socket is readable
+	 * @param writeable True if the socket is writeable
+	 * @return false if the connection has ended
+	 * @throw std::exception Any std::exception (or derivative) also ends the connection
+	 */
+	bool handle_io(bool readable, bool writeable);
+
 
 	/**
 	 * @brief Called every second
@@ -219,6 +299,16 @@ public:
 	 */
 	ssl_client(const std::string &_hostname, const std::string &_port = "443", bool plaintext_downgrade = false, bool reuse = false);
 
+	/**
+	 * @brief Make sure the calling thread has a live keepalive connection to a host,
+	 * so that the next reusable ssl_client for it does not have to connect and handshake.
+	 * Does nothing if the thread already has a keepalive connection which has not expired.
+	 * @param hostname The hostname to connect to
+	 * @param port the Port number to connect to
+	 * @throw dpp::exception Failed to initialise connection
+	 */
+	static void warm_up(const std::string &hostname, const std::string &port = "443");
+
 	/**
 	 * @brief Nonblocking I/O loop
 	 * @throw std::exception Any std::exception (or derivative) thrown from read_loop() causes reconnection of the shard
@@ -22,6 +22,7 @@
 #pragma once
 #include <dpp/export.h>
 #include <string>
+#include <string_view>
 #include <map>
 #include <dpp/sslclient.h>
 
@@ -129,11 +130,14 @@ class DPP_EXPORT websocket_client : public ssl_client {
 	std::map<std::string, std::string> http_headers;
 
 	/**
-	 * @brief Parse headers for a websocket frame from the buffer.
-	 * @param buffer The buffer to operate on. Will modify the string removing completed items from the head of the queue
-	 * @return true if a complete header has been received
+	 * @brief Parse one websocket frame from the head of the buffer and pass it up the stack.
+	 * The frame is handed over as a view into the buffer, without copying it.
+	 * @param buffer Unprocessed data, starting at a frame boundary
+	 * @param consumed Incremented by the size of the frame when one is processed. The caller
+	 * removes processed frames from its buffer once it has finished with all of them.
+	 * @return true if a complete frame was processed
 	 */
-	bool parseheader(std::string& buffer);
+	bool parseheader(std::string_view buffer, size_t& consumed);
 
 	/**
 	 * @brief Unpack a frame and pass completed frames up the stack.
@@ -157,7 +161,7 @@ class DPP_EXPORT websocket_client : public ssl_client {
 	 * @brief Handle ping requests.
 	 * @param payload The ping payload, to be returned as-is for a pong
 	 */
-	void handle_ping(const std::string& payload);
+	void handle_ping(std::string_view payload);
 
 protected:
 
@@ -212,11 +216,12 @@ public:
 	/**
 	 * @brief Receives raw frame content only without headers
 	 *
-	 * @param buffer The buffer contents
+	 * @param buffer The frame contents. This views the receive buffer and is only valid for the
+	 * duration of the call, so copy anything that must outlive it.
 	 * @param opcode Frame type, e.g. OP_TEXT, OP_BINARY
 	 * @return True if the frame was successfully handled. False if no valid frame is in the buffer.
 	 */
-	virtual bool handle_frame(const std::string& buffer, ws_opcode opcode);
+	virtual bool handle_frame(std::string_view buffer, ws_opcode opcode);
 
 	/**
 	 * @brief Called upon error frame.
@@ -231,10 +236,12 @@ public:
 	virtual void one_second_timer();
 
 	/**
-	 * @brief Send OP_CLOSE error code 1000 to the other side of the connection.
-	 * This indicates graceful close.
+	 * @brief Send OP_CLOSE to the other side of the connection.
+	 * The default code of 1000 indicates graceful close.
+	 *
+	 * @param code Close code to send
 	 */
-	void send_close_packet();
+	void send_close_packet(uint16_t code = 1000);
 };
 
 }
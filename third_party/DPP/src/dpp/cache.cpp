@@ -21,22 +21,117 @@
  ************************************************************************************/
 #include <dpp/export.h>
 #include <mutex>
+#include <chrono>
 #include <variant>
+#include <vector>
 #include <dpp/cache.h>
+#include <dpp/user.h>
+#include <dpp/guild.h>
+#include <dpp/role.h>
+#include <dpp/channel.h>
+#include <dpp/emoji.h>
 
 namespace dpp {
 
-std::unordered_map<managed*, time_t> deletion_queue;
+std::deque<std::pair<managed*, time_t>> deletion_queue;
 std::mutex deletion_mutex;
 
+static std::mutex gc_stats_mutex;
+static gc_stats gc_totals;
+
+static std::shared_mutex object_mutex;
+
+std::shared_mutex& get_object_mutex() {
+	return object_mutex;
+}
+
+namespace {
+
+/* Nothing for a string short enough to be stored inside the string object itself */
+size_t string_bytes(const std::string& str) {
+	const char* self = reinterpret_cast<const char*>(&str);
+	return str.data() >= self && str.data() < self + sizeof(str) ? 0 : str.capacity() + 1;
+}
+
+template <typename T>
+size_t vector_bytes(const std::vector<T>& vec) {
+	return vec.capacity() * sizeof(T);
+}
+
+size_t icon_bytes(const utility::icon& icon) {
+	return icon.is_image_data() ? icon.as_image_data().size : 0;
+}
+
+size_t emoji_variant_bytes(const std::variant<std::monostate, snowflake, std::string>& emoji) {
+	return std::holds_alternative<std::string>(emoji) ? string_bytes(std::get<std::string>(emoji)) : 0;
+}
+
+/* Map nodes hold the value and about two pointers for an unordered map, or four for a tree */
+template <typename Map>
+size_t unordered_map_bytes(const Map& map) {
+	return map.bucket_count() * sizeof(void*) + map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*));
+}
+
+template <typename Map>
+size_t map_bytes(const Map& map) {
+	return map.size() * (sizeof(typename Map::value_type) + 4 * sizeof(void*));
+}
+
+}
+
+size_t owned_bytes(const user& object) {
+	return string_bytes(object.username) + string_bytes(object.global_name);
+}
+
+size_t owned_bytes(const guild& object) {
+	size_t total = string_bytes(object.name) + string_bytes(object.description) + string_bytes(object.vanity_url_code);
+	total += vector_bytes(object.roles) + vector_bytes(object.channels) + vector_bytes(object.threads) + vector_bytes(object.emojis);
+	total += icon_bytes(object.icon) + icon_bytes(object.splash) + icon_bytes(object.discovery_splash) + icon_bytes(object.banner);
+	total += string_bytes(object.welcome_screen.description) + vector_bytes(object.welcome_screen.welcome_channels);
+	for (const welcome_channel& wc : object.welcome_screen.welcome_channels) {
+		total += string_bytes(wc.description) + string_bytes(wc.emoji_name);
+	}
+	total += map_bytes(object.voice_members);
+	for (const auto& [id, state] : object.voice_members) {
+		total += string_bytes(state.session_id);
+	}
+	/* Usually by far the largest part of a guild */
+	total += unordered_map_bytes(object.members);
+	for (const auto& [id, member] : object.members) {
+		total += owned_bytes(member);
+	}
+	return total;
+}
+
+size_t owned_bytes(const guild_member& object) {
+	return string_bytes(object.nickname) + vector_bytes(object.roles);
+}
+
+size_t owned_bytes(const role& object) {
+	return string_bytes(object.name) + string_bytes(object.unicode_emoji) + icon_bytes(object.icon);
+}
+
+size_t owned_bytes(const channel& object) {
+	size_t total = string_bytes(object.name) + string_bytes(object.topic) + string_bytes(object.rtc_region);
+	total += vector_bytes(object.recipients) + vector_bytes(object.permission_overwrites) + vector_bytes(object.available_tags);
+	for (const forum_tag& tag : object.available_tags) {
+		total += string_bytes(tag.name) + emoji_variant_bytes(tag.emoji);
+	}
+	return total + emoji_variant_bytes(object.default_reaction);
+}
+
+size_t owned_bytes(const emoji& object) {
+	return string_bytes(object.name) + vector_bytes(object.roles) + object.image_data.size;
+}
+
 #define cache_helper(type, cache_name, setter, getter, counter) \
-cache<type>* cache_name = nullptr; \
+sharded_cache<type>* cache_name = nullptr; \
 type * setter (snowflake id) { \
 		return cache_name ? ( type * ) cache_name ->find(id) : nullptr; \
 } \
-cache<type>* getter () { \
+sharded_cache<type>* getter () { \
 	if (! cache_name ) { \
-		cache_name = new cache<type>(); \
+		cache_name = new sharded_cache<type>(); \
 	} \
 	return cache_name ; \
 } \
@@ -47,35 +142,51 @@ uint64_t counter () { \
 
 /* Because other threads and systems may run for a short while after an event is received, we don't immediately
  * delete pointers when objects are replaced. We put them into a queue, and periodically delete pointers in the
- * queue. This also rehashes unordered_maps to ensure they free their memory.
+ * queue. This also rehashes unordered_maps that have become sparse, to ensure they free their memory.
  */
 void garbage_collection() {
+	auto start = std::chrono::steady_clock::now();
 	time_t now = time(nullptr);
-	bool repeat = false;
+	std::vector<managed*> expired;
 	{
 		std::lock_guard<std::mutex> delete_lock(deletion_mutex);
-		do {
-			repeat = false;
-			for (auto g = deletion_queue.begin(); g != deletion_queue.end(); ++g) {
-				if (now > g->second + 60) {
-					delete g->first;
-					deletion_queue.erase(g);
-					repeat = true;
-					break;
-				}
-			}
-		} while (repeat);
-		if (deletion_queue.size() == 0) {
-			deletion_queue = {};
+		/* The queue is in the order objects were removed, so everything expired is at the front */
+		while (!deletion_queue.empty() && now > deletion_queue.front().second + 60) {
+			expired.emplace_back(deletion_queue.front().first);
+			deletion_queue.pop_front();
+		}
+		if (deletion_queue.empty()) {
+			deletion_queue.shrink_to_fit();
 		}
 	}
-	dpp::get_user_cache()->rehash();
-	dpp::get_channel_cache()->rehash();
-	dpp::get_guild_cache()->rehash();
-	dpp::get_role_cache()->rehash();
-	dpp::get_emoji_cache()->rehash();
+	/* Deleted outside the lock, so caches storing objects meanwhile aren't held up */
+	for (managed* object : expired) {
+		delete object;
+	}
+	dpp::get_user_cache()->rehash_if_sparse();
+	dpp::get_channel_cache()->rehash_if_sparse();
+	dpp::get_guild_cache()->rehash_if_sparse();
+	dpp::get_role_cache()->rehash_if_sparse();
+	dpp::get_emoji_cache()->rehash_if_sparse();
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::lock_guard<std::mutex> stats_lock(gc_stats_mutex);
+	gc_totals.runs++;
+	gc_totals.deleted += expired.size();
+	gc_totals.total_time += elapsed;
+	gc_totals.last_time = elapsed;
 }
 
+gc_stats get_gc_stats() {
+	gc_stats stats;
+	{
+		std::lock_guard<std::mutex> stats_lock(gc_stats_mutex);
+		stats = gc_totals;
+	}
+	std::lock_guard<std::mutex> delete_lock(deletion_mutex);
+	stats.pending = deletion_queue.size();
+	return stats;
+}
 
 cache_helper(user, user_cache, find_user, get_user_cache, get_user_count);
 cache_helper(channel, channel_cache, find_channel, get_channel_cache, get_channel_count);
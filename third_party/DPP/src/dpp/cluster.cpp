@@ -27,6 +27,27 @@
 
 namespace dpp {
 
+/**
+ * @brief Sessions to resume on the next start(), keyed by cluster. Kept here rather than in the
+ * cluster so that the layout of the class is unchanged.
+ */
+static std::mutex resume_sessions_mutex;
+static std::map<const cluster*, std::vector<shard_session>> resume_sessions;
+
+/**
+ * @brief Take the sessions waiting to be resumed by a cluster
+ */
+static std::vector<shard_session> take_resume_sessions(const cluster* owner) {
+	std::lock_guard<std::mutex> lock(resume_sessions_mutex);
+	std::vector<shard_session> sessions;
+	auto i = resume_sessions.find(owner);
+	if (i != resume_sessions.end()) {
+		sessions = std::move(i->second);
+		resume_sessions.erase(i);
+	}
+	return sessions;
+}
+
 /**
  * @brief An audit reason for each thread. These are per-thread to make the cluster
  * methods like cluster::get_audit_reason and cluster::set_audit_reason thread safe across
@@ -88,10 +109,14 @@ cluster::cluster(const std::string &_token, uint32_t _intents, uint32_t _shards,
 	: default_gateway("gateway.discord.gg"), rest(nullptr), raw_rest(nullptr), compressed(comp), start_time(0), token(_token), last_identify(time(nullptr) - 5), intents(_intents),
 	numshards(_shards), cluster_id(_cluster_id), maxclusters(_maxclusters), rest_ping(0.0), cache_policy(policy), ws_mode(ws_json)
 {
-	/* Instantiate REST request queues */
+	/* Instantiate REST request queues, unless shared ones are to be given to us later */
 	try {
-		rest = new request_queue(this, request_threads);
-		raw_rest = new request_queue(this, request_threads_raw);
+		if (request_threads > 0) {
+			rest = new request_queue(this, request_threads);
+		}
+		if (request_threads_raw > 0) {
+			raw_rest = new request_queue(this, request_threads_raw);
+		}
 	}
 	catch (std::bad_alloc&) {
 		delete rest;
@@ -148,11 +173,23 @@ cluster::cluster(const std::string &_token, uint32_t _intents, uint32_t _shards,
 #endif
 }
 
+/**
+ * @brief Release a request queue, which is either owned by the cluster or shared with other clusters
+ */
+static void release_request_queue(request_queue* queue, cluster* owner) {
+	if (queue && queue->is_shared()) {
+		queue->detach(owner);
+	} else {
+		delete queue;
+	}
+}
+
 cluster::~cluster()
 {
 	this->shutdown();
-	delete rest;
-	delete raw_rest;
+	take_resume_sessions(this);
+	release_request_queue(rest, this);
+	release_request_queue(raw_rest, this);
 #ifdef _WIN32
 	WSACleanup();
 #endif
@@ -166,6 +203,20 @@ request_queue* cluster::get_raw_rest() {
 	return raw_rest;
 }
 
+cluster& cluster::set_request_queues(request_queue* shared_rest, request_queue* shared_raw_rest) {
+	if (start_time > 0) {
+		throw dpp::logic_exception(err_request_queue_already_set, "Cannot change request queues on a started cluster!");
+	}
+	if (!shared_rest || !shared_raw_rest || !shared_rest->is_shared() || !shared_raw_rest->is_shared()) {
+		throw dpp::logic_exception(err_request_queue_already_set, "Request queues given to a cluster must be shared queues with no owner");
+	}
+	release_request_queue(rest, this);
+	release_request_queue(raw_rest, this);
+	rest = shared_rest;
+	raw_rest = shared_raw_rest;
+	return *this;
+}
+
 cluster& cluster::set_websocket_protocol(websocket_protocol_t mode) {
 	if (start_time > 0) {
 		throw dpp::logic_exception(err_websocket_proto_already_set, "Cannot change websocket protocol on a started cluster!");
@@ -255,19 +306,35 @@ void cluster::start(bool return_after) {
 
 	start_time = time(nullptr);
 
+	std::map<uint32_t, shard_session> resumable;
+	for (auto& session : take_resume_sessions(this)) {
+		if (session.max_shards == numshards && !session.session_id.empty() && session.last_seq) {
+			resumable[session.shard_id] = std::move(session);
+		}
+	}
+
 	log(ll_debug, "Starting with " + std::to_string(numshards) + " shards...");
 
 	for (uint32_t s = 0; s < numshards; ++s) {
 		/* Filter out shards that aren't part of the current cluster, if the bot is clustered */
 		if (s % maxclusters == cluster_id) {
 			/* Each discord_client spawns its own thread in its run() */
+			auto session = resumable.find(s);
 			try {
 				this->shards[s] = new discord_client(this, s, numshards, token, intents, compressed, ws_mode);
+				if (session != resumable.end()) {
+					log(ll_debug, "Resuming session of shard " + std::to_string(s));
+					this->shards[s]->set_session(session->second);
+				}
 				this->shards[s]->run();
 			}
 			catch (const std::exception &e) {
 				log(dpp::ll_critical, "Could not start shard " + std::to_string(s) + ": " + std::string(e.what()));
 			}
+			/* Resuming does not count towards the identify rate limit, so there is no need to wait */
+			if (session != resumable.end()) {
+				continue;
+			}
 			/* Stagger the shard startups, pausing every 'session_start_max_concurrency' shards for 5 seconds.
 			 * This means that for bots that don't have large bot sharding, any number % 1 is always 0,
 			 * so it will pause after every shard. For any with non-zero concurrency it'll pause 5 seconds
@@ -327,6 +394,24 @@ void cluster::shutdown() {
 	shards.clear();
 }
 
+std::vector<shard_session> cluster::shutdown_resumable() {
+	std::vector<shard_session> sessions;
+	/* Stop every shard before closing any, so that each session is taken once it can no longer change */
+	for (const auto& sh : shards) {
+		sh.second->resumable_close = true;
+		sh.second->stop_loop();
+		sessions.emplace_back(sh.second->get_session());
+	}
+	shutdown();
+	return sessions;
+}
+
+cluster& cluster::set_resume_sessions(const std::vector<shard_session>& sessions) {
+	std::lock_guard<std::mutex> lock(resume_sessions_mutex);
+	resume_sessions[this] = sessions;
+	return *this;
+}
+
 snowflake cluster::get_dm_channel(snowflake user_id) {
 	std::lock_guard<std::mutex> lock(dm_list_lock);
 	auto i = dm_channels.find(user_id);
@@ -373,8 +458,8 @@ json error_response(const std::string& message, http_request_completion_t& rv)
 	return j;
 }
 
-void cluster::post_rest(const std::string &endpoint, const std::string &major_parameters, const std::string &parameters, http_method method, const std::string &postdata, json_encode_t callback, const std::string &filename, const std::string &filecontent, const std::string &filemimetype, const std::string &protocol) {
-	rest->post_request(std::make_unique<http_request>(endpoint + (!major_parameters.empty() ? "/" : "") + major_parameters, parameters, [endpoint, callback](http_request_completion_t rv) {
+void cluster::post_rest(const std::string &endpoint, const std::string &major_parameters, const std::string &parameters, http_method method, const std::string &postdata, json_encode_t callback, const std::string &filename, const std::string &filecontent, const std::string &filemimetype, const std::string &protocol, http_priority priority) {
+	auto req = std::make_unique<http_request>(endpoint + (!major_parameters.empty() ? "/" : "") + major_parameters, parameters, [endpoint, callback](http_request_completion_t rv) {
 		json j;
 		if (rv.error == h_success && !rv.body.empty()) {
 			try {
@@ -387,10 +472,13 @@ void cluster::post_rest(const std::string &endpoint, const std::string &major_pa
 		if (callback) {
 			callback(j, rv);
 		}
-	}, postdata, method, get_audit_reason(), filename, filecontent, filemimetype, protocol));
+	}, postdata, method, get_audit_reason(), filename, filecontent, filemimetype, protocol);
+	req->priority = priority;
+	req->owner = this;
+	rest->post_request(std::move(req));
 }
 
-void cluster::post_rest_multipart(const std::string &endpoint, const std::string &major_parameters, const std::string &parameters, http_method method, const std::string &postdata, json_encode_t callback, const std::vector<message_file_data> &file_data) {
+void cluster::post_rest_multipart(const std::string &endpoint, const std::string &major_parameters, const std::string &parameters, http_method method, const std::string &postdata, json_encode_t callback, const std::vector<message_file_data> &file_data, http_priority priority) {
 	std::vector<std::string> file_names{};
 	std::vector<std::string> file_contents{};
 	std::vector<std::string> file_mimetypes{};
@@ -401,7 +489,7 @@ void cluster::post_rest_multipart(const std::string &endpoint, const std::string
 		file_mimetypes.push_back(data.mimetype);
 	}
 
-	rest->post_request(std::make_unique<http_request>(endpoint + (!major_parameters.empty() ? "/" : "") + major_parameters, parameters, [endpoint, callback](http_request_completion_t rv) {
+	auto req = std::make_unique<http_request>(endpoint + (!major_parameters.empty() ? "/" : "") + major_parameters, parameters, [endpoint, callback](http_request_completion_t rv) {
 		json j;
 		if (rv.error == h_success && !rv.body.empty()) {
 			try {
@@ -414,12 +502,17 @@ void cluster::post_rest_multipart(const std::string &endpoint, const std::string
 		if (callback) {
 			callback(j, rv);
 		}
-	}, postdata, method, get_audit_reason(), file_names, file_contents, file_mimetypes));
+	}, postdata, method, get_audit_reason(), file_names, file_contents, file_mimetypes);
+	req->priority = priority;
+	req->owner = this;
+	rest->post_request(std::move(req));
 }
 
 
 void cluster::request(const std::string &url, http_method method, http_completion_event callback, const std::string &postdata, const std::string &mimetype, const std::multimap<std::string, std::string> &headers, const std::string &protocol, time_t request_timeout) {
-	raw_rest->post_request(std::make_unique<http_request>(url, callback, method, postdata, mimetype, headers, protocol, request_timeout));
+	auto req = std::make_unique<http_request>(url, callback, method, postdata, mimetype, headers, protocol, request_timeout);
+	req->owner = this;
+	raw_rest->post_request(std::move(req));
 }
 
 gateway::gateway() : shards(0), session_start_total(0), session_start_remaining(0), session_start_reset_after(0), session_start_max_concurrency(0) {
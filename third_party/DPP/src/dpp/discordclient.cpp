@@ -25,8 +25,10 @@
 #include <dpp/discordclient.h>
 #include <dpp/cache.h>
 #include <dpp/cluster.h>
+#include <dpp/socketengine.h>
 #include <thread>
 #include <dpp/json.h>
+#include <dpp/json_scan.h>
 #include <dpp/etf.h>
 #include <zlib.h>
 
@@ -45,6 +47,8 @@
 
 namespace dpp {
 
+static std::atomic<bool> frame_timing{false};
+
 /**
  * @brief This is an opaque class containing zlib library specific structures.
  * We define it this way so that the public facing D++ library doesn't require
@@ -58,21 +62,19 @@ public:
 	z_stream d_stream;
 };
 
-/**
- * @brief Stores the most recent ping message on this shard, which we check for to monitor latency
- */
-thread_local static std::string last_ping_message;
-
 discord_client::discord_client(dpp::cluster* _cluster, uint32_t _shard_id, uint32_t _max_shards, const std::string &_token, uint32_t _intents, bool comp, websocket_protocol_t ws_proto)
        : websocket_client(_cluster->default_gateway, "443", comp ? (ws_proto == ws_json ? PATH_COMPRESSED_JSON : PATH_COMPRESSED_ETF) : (ws_proto == ws_json ? PATH_UNCOMPRESSED_JSON : PATH_UNCOMPRESSED_ETF)),
         terminating(false),
         runner(nullptr),
+	uses_engine(false),
+	resumable_close(false),
+	identify_pending(false),
 	compressed(comp),
-	decomp_buffer(nullptr),
 	zlib(nullptr),
 	decompressed_total(0),
 	connect_time(0),
 	ping_start(0.0),
+	last_ping_message(),
 	etf(nullptr),
 	creator(_cluster),
 	heartbeat_interval(0),
@@ -85,6 +87,10 @@ discord_client::discord_client(dpp::cluster* _cluster, uint32_t _shard_id, uint3
 	resumes(0),
 	reconnects(0),
 	websocket_ping(0.0),
+	dispatch_count(0),
+	last_dispatch(0.0),
+	frame_received(0.0),
+	frame_parsed(0.0),
 	ready(false),
 	last_heartbeat_ack(time(nullptr)),
 	protocol(ws_proto),
@@ -109,12 +115,37 @@ discord_client::discord_client(dpp::cluster* _cluster, uint32_t _shard_id, uint3
 	}
 }
 
-void discord_client::cleanup()
+void discord_client::stop_loop()
 {
 	terminating = true;
+	if (uses_engine) {
+		/* A reconnection in progress can add the shard back before it notices it is terminating,
+		 * so remove it again once that has finished
+		 */
+		socket_engine::get().remove(this);
+	}
 	if (runner) {
 		runner->join();
 		delete runner;
+		runner = nullptr;
+	}
+	if (uses_engine) {
+		socket_engine::get().remove(this);
+	}
+}
+
+void discord_client::cleanup()
+{
+	stop_loop();
+	if (uses_engine) {
+		try {
+			graceful_close();
+		}
+		catch (const std::exception &e) {
+			log(dpp::ll_debug, std::string("Graceful shutdown of shard ") + std::to_string(this->shard_id) + " failed: " + e.what());
+		}
+		end_zlib();
+		uses_engine = false;
 	}
 	delete etf;
 	delete zlib;
@@ -130,6 +161,26 @@ uint64_t discord_client::get_decompressed_bytes_in()
 	return decompressed_total;
 }
 
+shard_session discord_client::get_session() const
+{
+	shard_session session;
+	session.shard_id = shard_id;
+	session.max_shards = max_shards;
+	session.session_id = sessionid;
+	session.resume_gateway_url = resume_gateway_url;
+	session.last_seq = last_seq;
+	return session;
+}
+
+void discord_client::set_session(const shard_session& session)
+{
+	sessionid = session.session_id;
+	last_seq = session.last_seq;
+	if (!session.resume_gateway_url.empty()) {
+		resume_gateway_url = session.resume_gateway_url;
+	}
+}
+
 void discord_client::setup_zlib()
 {
 	if (compressed) {
@@ -140,7 +191,6 @@ void discord_client::setup_zlib()
 		if (error != Z_OK) {
 			throw dpp::connection_exception((exception_error_code)error, "Can't initialise stream compression!");
 		}
-		this->decomp_buffer = new unsigned char[DECOMP_BUFFER_SIZE];
 	}
 
 }
@@ -149,8 +199,6 @@ void discord_client::end_zlib()
 {
 	if (compressed) {
 		inflateEnd(&(zlib->d_stream));
-		delete[] this->decomp_buffer;
-		this->decomp_buffer = nullptr;
 	}
 }
 
@@ -164,65 +212,174 @@ void discord_client::thread_run()
 	utility::set_thread_name(std::string("shard/") + std::to_string(shard_id));
 	setup_zlib();
 	do {
-		bool error = false;
 		ready = false;
 		message_queue.clear();
 		ssl_client::read_loop();
 		if (!terminating) {
-			ssl_client::close();
-			end_zlib();
-			setup_zlib();
-			do {
-				this->log(ll_debug, "Attempting reconnection of shard " + std::to_string(this->shard_id) + " to wss://" + resume_gateway_url);
-				error = false;
-				try {
-					set_resume_hostname();
-					ssl_client::connect();
-					websocket_client::connect();
-				}
-				catch (const std::exception &e) {
-					log(dpp::ll_error, std::string("Error establishing connection, retry in 5 seconds: ") + e.what());
-					ssl_client::close();
-					std::this_thread::sleep_for(std::chrono::seconds(5));
-					error = true;
-				}
-			} while (error);
+			reconnect();
 		}
 	} while(!terminating);
+	graceful_close();
+	end_zlib();
+}
+
+void discord_client::reconnect()
+{
+	bool error = false;
+	identify_pending = false;
+	ssl_client::close();
+	end_zlib();
+	setup_zlib();
+	do {
+		this->log(ll_debug, "Attempting reconnection of shard " + std::to_string(this->shard_id) + " to wss://" + resume_gateway_url);
+		error = false;
+		try {
+			set_resume_hostname();
+			ssl_client::connect();
+			websocket_client::connect();
+		}
+		catch (const std::exception &e) {
+			log(dpp::ll_error, std::string("Error establishing connection, retry in 5 seconds: ") + e.what());
+			ssl_client::close();
+			std::this_thread::sleep_for(std::chrono::seconds(5));
+			error = true;
+		}
+	} while (error && !terminating);
+}
+
+void discord_client::graceful_close()
+{
 	if (this->sfd != INVALID_SOCKET) {
 		/* Send a graceful termination */
 		this->log(ll_debug, "Graceful shutdown of shard " + std::to_string(this->shard_id) + " succeeded.");
 		this->nonblocking = false;
-		this->send_close_packet();
+		/* Any code other than 1000 and 1001 leaves the session open for a later resume */
+		this->send_close_packet(resumable_close ? 4000 : 1000);
 		ssl_client::close();
 	} else {
 		this->log(ll_debug, "Graceful shutdown of shard " + std::to_string(this->shard_id) + " not possible, socket already closed.");
 	}
-	end_zlib();
+}
+
+void discord_client::engine_add()
+{
+	ready = false;
+	message_queue.clear();
+	ssl_client::prepare_loop();
+	socket_engine::get().add(this, [this]() {
+		engine_end();
+	});
+}
+
+void discord_client::engine_end()
+{
+	/* Runs on the engine thread, so the blocking reconnection is handed to a thread of its own */
+	if (terminating) {
+		return;
+	}
+	if (runner) {
+		/* The previous reconnection added us back to the engine as its last act, so this is brief */
+		runner->join();
+		delete runner;
+	}
+	this->runner = new std::thread(&discord_client::engine_reconnect, this);
+	this->thread_id = runner->native_handle();
+}
+
+void discord_client::engine_reconnect()
+{
+	utility::set_thread_name(std::string("shard/") + std::to_string(shard_id));
+	while (!terminating) {
+		reconnect();
+		if (terminating) {
+			break;
+		}
+		try {
+			engine_add();
+			break;
+		}
+		catch (const std::exception &e) {
+			log(dpp::ll_error, std::string("Error resuming shard on socket engine: ") + e.what());
+		}
+	}
 }
 
 void discord_client::run()
 {
+	if (socket_engine::is_enabled()) {
+		/* Runs alongside every other shard in the process on the socket engine's thread */
+		uses_engine = true;
+		setup_zlib();
+		engine_add();
+		return;
+	}
 	this->runner = new std::thread(&discord_client::thread_run, this);
 	this->thread_id = runner->native_handle();
 }
 
-bool discord_client::handle_frame(const std::string &buffer, ws_opcode opcode)
+void discord_client::identify()
 {
-	std::string& data = (std::string&)buffer;
+	if (time(nullptr) < creator->last_identify + 5) {
+		identify_pending = true;
+		return;
+	}
+	identify_pending = false;
+	log(dpp::ll_debug, "Connecting new session...");
+	/* Without a member cache there is no use for member lists, so ask for the smallest Discord allows */
+	uint32_t large_threshold = creator->cache_policy.user_policy == cp_aggressive ? 250 : 50;
+	json obj = {
+		{ "op", 2 },
+		{
+			"d",
+			{
+				{ "token", this->token },
+				{ "properties",
+					{
+						{ "os", STRINGIFY(DPP_OS) },
+						{ "browser", "D++" },
+						{ "device", "D++" }
+					}
+				},
+				{ "shard", json::array({ shard_id, max_shards }) },
+				{ "compress", false },
+				{ "large_threshold", large_threshold },
+				{ "intents", this->intents }
+			}
+		}
+	};
+	this->write(jsonobj_to_string(obj), protocol == ws_etf ? OP_BINARY : OP_TEXT);
+	this->connect_time = creator->last_identify = time(nullptr);
+	reconnects++;
+}
+
+void discord_client::set_frame_timing(bool enabled)
+{
+	frame_timing = enabled;
+}
+
+bool discord_client::handle_frame(std::string_view buffer, ws_opcode opcode)
+{
+	std::string_view data = buffer;
+	const bool timed = frame_timing.load(std::memory_order_relaxed);
+	frame_received = timed ? utility::time_f() : 0.0;
 
 	/* gzip compression is a special case */
 	if (compressed) {
 		/* Check that we have a complete compressed frame */
 		if ((uint8_t)buffer[buffer.size() - 4] == 0x00 && (uint8_t)buffer[buffer.size() - 3] == 0x00 && (uint8_t)buffer[buffer.size() - 2] == 0xFF
 		&& (uint8_t)buffer[buffer.size() - 1] == 0xFF) {
-			/* Decompress buffer */
-			decompressed.clear();
-			zlib->d_stream.next_in = (Bytef *)buffer.c_str();
+			/* Decompress buffer. zlib writes straight into the reusable buffer, which is only grown
+			 * when a frame does not fit in what earlier frames already allocated.
+			 */
+			size_t length = 0;
+			zlib->d_stream.next_in = (Bytef *)buffer.data();
 			zlib->d_stream.avail_in = (uInt)buffer.size();
 			do {
 				int have = 0;
-				zlib->d_stream.next_out = (Bytef*)decomp_buffer;
+				if (decompressed.size() < length + DECOMP_BUFFER_SIZE) {
+					decompressed.resize(length + DECOMP_BUFFER_SIZE);
+				}
+				zlib->d_stream.next_out = (Bytef*)decompressed.data() + length;
 				zlib->d_stream.avail_out = DECOMP_BUFFER_SIZE;
 				int ret = inflate(&(zlib->d_stream), Z_NO_FLUSH);
 				have = DECOMP_BUFFER_SIZE - zlib->d_stream.avail_out;
@@ -245,7 +402,7 @@ bool discord_client::handle_frame(const std::string &buffer, ws_opcode opcode)
 						return true;
 					break;
 					case Z_OK:
-						this->decompressed.append((const char*)decomp_buffer, have);
+						length += have;
 						this->decompressed_total += have;
 					break;
 					default:
@@ -253,7 +410,7 @@ bool discord_client::handle_frame(const std::string &buffer, ws_opcode opcode)
 					break;
 				}
 			} while (zlib->d_stream.avail_out == 0);
-			data = decompressed;
+			data = std::string_view(decompressed.data(), length);
 		} else {
 			/* No complete compressed frame yet */
 			return false;
@@ -261,6 +418,20 @@ bool discord_client::handle_frame(const std::string &buffer, ws_opcode opcode)
 	}
 
 
+	if (protocol == ws_json) {
+		/* Dispatches that nothing acts on are dropped here, before paying for a full parse.
+		 * Their sequence number still counts, as a resume must acknowledge every event.
+		 */
+		json_scan::frame_header header;
+		if (json_scan::read_frame_header(data, header) && header.op == 0 && !header.event.empty() && !is_event_wanted(header.event)) {
+			count_dispatch(header.event);
+			if (header.seq) {
+				last_seq = *header.seq;
+			}
+			return true;
+		}
+	}
+
 	json j;
 	
 	/**
@@ -276,7 +447,7 @@ bool discord_client::handle_frame(const std::string &buffer, ws_opcode opcode)
 				j = json::parse(data);
 			}
 			catch (const std::exception &e) {
-				log(dpp::ll_error, "discord_client::handle_frame(JSON): " + std::string(e.what()) + " [" + data + "]");
+				log(dpp::ll_error, "discord_client::handle_frame(JSON): " + std::string(e.what()) + " [" + std::string(data) + "]");
 				return true;
 			}
 		break;
@@ -290,6 +461,7 @@ bool discord_client::handle_frame(const std::string &buffer, ws_opcode opcode)
 			}
 		break;
 	}
+	frame_parsed = timed ? utility::time_f() : 0.0;
 
 	auto seq = j.find("s");
 	if (seq != j.end() && !seq->is_null()) {
@@ -330,41 +502,17 @@ bool discord_client::handle_frame(const std::string &buffer, ws_opcode opcode)
 					this->write(jsonobj_to_string(obj), protocol == ws_etf ? OP_BINARY : OP_TEXT);
 					resumes++;
 				} else {
-					/* Full connect */
-					while (time(nullptr) < creator->last_identify + 5) {
-						time_t wait = (creator->last_identify + 5) - time(nullptr);
-						std::this_thread::sleep_for(std::chrono::seconds(wait));
-					}
-					log(dpp::ll_debug, "Connecting new session...");
-					json obj = {
-						{ "op", 2 },
-						{
-							"d",
-							{
-								{ "token", this->token },
-								{ "properties",
-									{
-										{ "os", STRINGIFY(DPP_OS) },
-										{ "browser", "D++" },
-										{ "device", "D++" }
-									}
-								},
-								{ "shard", json::array({ shard_id, max_shards }) },
-								{ "compress", false },
-								{ "large_threshold", 250 },
-								{ "intents", this->intents }
-							}
-						}
-					};
-					this->write(jsonobj_to_string(obj), protocol == ws_etf ? OP_BINARY : OP_TEXT);
-					this->connect_time = creator->last_identify = time(nullptr);
-					reconnects++;
+					/* Full connect. Never sleeps, as the socket engine thread serves every other shard too */
+					identify();
 				}
 				this->last_heartbeat_ack = time(nullptr);
 				websocket_ping = 0;
 			break;
 			case 0: {
 				std::string event = j["t"];
+				count_dispatch(event);
+				/* Handlers change cached objects in place, so readers on other threads are held off */
+				std::unique_lock object_lock(get_object_mutex());
 				handle_event(event, j, data);
 			}
 			break;
@@ -486,6 +634,12 @@ void discord_client::one_second_timer()
 
 	websocket_client::one_second_timer();
 
+	update_event_rates();
+
+	if (identify_pending) {
+		identify();
+	}
+
 	/* Every minute, rehash all containers from first shard.
 	 * We can't just get shard with the id 0 because this won't
 	 * work on a clustered environment
@@ -513,8 +667,8 @@ void discord_client::one_second_timer()
 		if ((time(nullptr) - this->last_heartbeat_ack) > heartbeat_interval * 2) {
 			log(dpp::ll_warning, "Missed heartbeat ACK, forcing reconnection to session " + sessionid);
 			message_queue.clear();
-			close_socket(sfd);
-			return;
+			/* Ends the read loop, which closes the socket and reconnects */
+			throw dpp::connection_exception(err_reconnection, "Missed heartbeat ACK");
 		}
 
 		/* Rate limit outbound messages, 1 every odd second, 2 every even second */
@@ -549,31 +703,55 @@ void discord_client::one_second_timer()
 	}
 }
 
+void discord_client::count_dispatch(std::string_view event)
+{
+	dispatch_count.fetch_add(1, std::memory_order_relaxed);
+	last_dispatch = utility::time_f();
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	auto i = event_counters.find(event);
+	if (i == event_counters.end()) {
+		i = event_counters.emplace(std::string(event), event_counter()).first;
+	}
+	i->second.stats.total++;
+	i->second.this_second++;
+}
+
+void discord_client::update_event_rates()
+{
+	/* An exponential moving average, in which a second's count has fallen to a third of its weight after ten seconds */
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	for (auto& counter : event_counters) {
+		counter.second.stats.per_second += (counter.second.this_second - counter.second.stats.per_second) * 0.1;
+		counter.second.this_second = 0;
+	}
+}
+
+std::map<std::string, event_stats> discord_client::get_event_stats()
+{
+	std::map<std::string, event_stats> stats;
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	for (const auto& counter : event_counters) {
+		stats.emplace(counter.first, counter.second.stats);
+	}
+	return stats;
+}
+
 uint64_t discord_client::get_guild_count() {
 	uint64_t total = 0;
-	dpp::cache<guild>* c = dpp::get_guild_cache();
-	/* IMPORTANT: We must lock the container to iterate it */
-	std::shared_lock l(c->get_mutex());
-	std::unordered_map<snowflake, guild*>& gc = c->get_container();
-	for (auto g = gc.begin(); g != gc.end(); ++g) {
-		dpp::guild* gp = (dpp::guild*)g->second;
+	dpp::get_guild_cache()->for_each([this, &total](dpp::guild* gp) {
 		if (gp->shard_id == this->shard_id) {
 			total++;
 		}
-	}
+	});
 	return total;
 }
 
 uint64_t discord_client::get_member_count() {
 	uint64_t total = 0;
-	dpp::cache<guild>* c = dpp::get_guild_cache();
-	/* IMPORTANT: We must lock the container to iterate it */
-	std::shared_lock l(c->get_mutex());
-	std::unordered_map<snowflake, guild*>& gc = c->get_container();
-	for (auto g = gc.begin(); g != gc.end(); ++g) {
-		dpp::guild* gp = (dpp::guild*)g->second;
+	bool full_members = creator->cache_policy.user_policy == dpp::cp_aggressive;
+	dpp::get_guild_cache()->for_each([this, &total, full_members](dpp::guild* gp) {
 		if (gp->shard_id == this->shard_id) {
-			if (creator->cache_policy.user_policy == dpp::cp_aggressive) {
+			if (full_members) {
 				/* We can use actual member count if we are using full user caching */
 				total += gp->members.size();
 			} else {
@@ -581,22 +759,17 @@ uint64_t discord_client::get_member_count() {
 				total += gp->member_count;
 			}
 		}
-	}
+	});
 	return total;
 }
 
 uint64_t discord_client::get_channel_count() {
 	uint64_t total = 0;
-	dpp::cache<guild>* c = dpp::get_guild_cache();
-	/* IMPORTANT: We must lock the container to iterate it */
-	std::shared_lock l(c->get_mutex());
-	std::unordered_map<snowflake, guild*>& gc = c->get_container();
-	for (auto g = gc.begin(); g != gc.end(); ++g) {
-		dpp::guild* gp = (dpp::guild*)g->second;
+	dpp::get_guild_cache()->for_each([this, &total](dpp::guild* gp) {
 		if (gp->shard_id == this->shard_id) {
 			total += gp->channels.size();
 		}
-	}
+	});
 	return total;
 }
 
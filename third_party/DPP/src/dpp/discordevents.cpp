@@ -35,6 +35,7 @@
 #include <stdlib.h>
 #include <dpp/discordevents.h>
 #include <dpp/discordclient.h>
+#include <dpp/cluster.h>
 #include <dpp/json.h>
 #include <iomanip>
 #include <sstream>
@@ -419,7 +420,60 @@ static const std::map<std::string, dpp::events::event*> event_map = {
 	{ "ENTITLEMENT_DELETE", make_static_event<dpp::events::entitlement_delete>() },
 };
 
-void discord_client::handle_event(const std::string &event, json &j, const std::string &raw)
+/**
+ * @brief Events whose handlers do nothing but fire a user event. Any event not listed here
+ * may update the cache or shard state, so it is always parsed.
+ */
+static const std::map<std::string_view, bool(*)(const cluster*)> notification_events = {
+	{ "AUTO_MODERATION_RULE_CREATE", [](const cluster* c) { return !c->on_automod_rule_create.empty(); } },
+	{ "AUTO_MODERATION_RULE_UPDATE", [](const cluster* c) { return !c->on_automod_rule_update.empty(); } },
+	{ "AUTO_MODERATION_RULE_DELETE", [](const cluster* c) { return !c->on_automod_rule_create.empty() || !c->on_automod_rule_delete.empty(); } },
+	{ "AUTO_MODERATION_ACTION_EXECUTION", [](const cluster* c) { return !c->on_automod_rule_execute.empty(); } },
+	{ "CHANNEL_PINS_UPDATE", [](const cluster* c) { return !c->on_channel_pins_update.empty(); } },
+	{ "ENTITLEMENT_CREATE", [](const cluster* c) { return !c->on_entitlement_create.empty(); } },
+	{ "ENTITLEMENT_UPDATE", [](const cluster* c) { return !c->on_entitlement_update.empty(); } },
+	{ "ENTITLEMENT_DELETE", [](const cluster* c) { return !c->on_entitlement_delete.empty(); } },
+	{ "GUILD_AUDIT_LOG_ENTRY_CREATE", [](const cluster* c) { return !c->on_guild_audit_log_entry_create.empty(); } },
+	{ "GUILD_BAN_ADD", [](const cluster* c) { return !c->on_guild_ban_add.empty(); } },
+	{ "GUILD_BAN_REMOVE", [](const cluster* c) { return !c->on_guild_ban_remove.empty(); } },
+	{ "GUILD_MEMBER_UPDATE", [](const cluster* c) { return c->cache_policy.user_policy != cp_none || !c->on_guild_member_update.empty(); } },
+	{ "GUILD_SCHEDULED_EVENT_CREATE", [](const cluster* c) { return !c->on_guild_scheduled_event_create.empty(); } },
+	{ "GUILD_SCHEDULED_EVENT_UPDATE", [](const cluster* c) { return !c->on_guild_scheduled_event_update.empty(); } },
+	{ "GUILD_SCHEDULED_EVENT_DELETE", [](const cluster* c) { return !c->on_guild_scheduled_event_delete.empty(); } },
+	{ "GUILD_SCHEDULED_EVENT_USER_ADD", [](const cluster* c) { return !c->on_guild_scheduled_event_user_add.empty(); } },
+	{ "GUILD_SCHEDULED_EVENT_USER_REMOVE", [](const cluster* c) { return !c->on_guild_scheduled_event_user_remove.empty(); } },
+	{ "GUILD_STICKERS_UPDATE", [](const cluster* c) { return !c->on_guild_stickers_update.empty(); } },
+	{ "INTEGRATION_CREATE", [](const cluster* c) { return !c->on_integration_create.empty(); } },
+	{ "INTEGRATION_UPDATE", [](const cluster* c) { return !c->on_integration_update.empty(); } },
+	{ "INTEGRATION_DELETE", [](const cluster* c) { return !c->on_integration_delete.empty(); } },
+	{ "INVITE_CREATE", [](const cluster* c) { return !c->on_invite_create.empty(); } },
+	{ "INVITE_DELETE", [](const cluster* c) { return !c->on_invite_delete.empty(); } },
+	{ "MESSAGE_CREATE", [](const cluster* c) { return !c->on_message_create.empty(); } },
+	{ "MESSAGE_UPDATE", [](const cluster* c) { return !c->on_message_update.empty(); } },
+	{ "MESSAGE_DELETE", [](const cluster* c) { return !c->on_message_delete.empty(); } },
+	{ "MESSAGE_DELETE_BULK", [](const cluster* c) { return !c->on_message_delete_bulk.empty(); } },
+	{ "MESSAGE_POLL_VOTE_ADD", [](const cluster* c) { return !c->on_message_poll_vote_add.empty(); } },
+	{ "MESSAGE_POLL_VOTE_REMOVE", [](const cluster* c) { return !c->on_message_poll_vote_add.empty() || !c->on_message_poll_vote_remove.empty(); } },
+	{ "MESSAGE_REACTION_ADD", [](const cluster* c) { return !c->on_message_reaction_add.empty(); } },
+	{ "MESSAGE_REACTION_REMOVE", [](const cluster* c) { return !c->on_message_reaction_remove.empty(); } },
+	{ "MESSAGE_REACTION_REMOVE_ALL", [](const cluster* c) { return !c->on_message_reaction_remove_all.empty(); } },
+	{ "MESSAGE_REACTION_REMOVE_EMOJI", [](const cluster* c) { return !c->on_message_reaction_remove_emoji.empty(); } },
+	{ "PRESENCE_UPDATE", [](const cluster* c) { return !c->on_presence_update.empty(); } },
+	{ "STAGE_INSTANCE_CREATE", [](const cluster* c) { return !c->on_stage_instance_create.empty(); } },
+	{ "STAGE_INSTANCE_UPDATE", [](const cluster* c) { return !c->on_stage_instance_update.empty(); } },
+	{ "STAGE_INSTANCE_DELETE", [](const cluster* c) { return !c->on_stage_instance_delete.empty(); } },
+	{ "THREAD_MEMBER_UPDATE", [](const cluster* c) { return !c->on_thread_member_update.empty(); } },
+	{ "TYPING_START", [](const cluster* c) { return !c->on_typing_start.empty(); } },
+	{ "WEBHOOKS_UPDATE", [](const cluster* c) { return !c->on_webhooks_update.empty(); } },
+};
+
+bool discord_client::is_event_wanted(std::string_view event) const
+{
+	auto ev_iter = notification_events.find(event);
+	return ev_iter == notification_events.end() || ev_iter->second(creator);
+}
+
+void discord_client::handle_event(const std::string &event, json &j, std::string_view raw)
 {
 	auto ev_iter = event_map.find(event);
 	if (ev_iter != event_map.end()) {
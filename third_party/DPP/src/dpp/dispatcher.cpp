@@ -31,7 +31,7 @@
 
 namespace dpp {
 
-event_dispatch_t::event_dispatch_t(discord_client* client, const std::string& raw) : raw_event(raw), from(client) {}
+event_dispatch_t::event_dispatch_t(discord_client* client, std::string_view raw) : raw_event(raw), from(client) {}
 
 event_dispatch_t::event_dispatch_t(discord_client* client, std::string&& raw) : raw_event(std::move(raw)), from(client) {}
 
@@ -628,7 +628,7 @@ json etf_parser::inner_parse() {
 	}
 }
 
-json etf_parser::parse(const std::string& in) {
+json etf_parser::parse(std::string_view in) {
 	/* Recursively decode multiple values from ETF to JSON */
 	offset = 0;
 	size = in.size();
@@ -685,18 +685,19 @@ void etf_parser::inner_build(const json* i, etf_buffer* b)
 		/* Array types (can contain any other type, recursively) */
 		const size_t length = i->size();
 		if (length == 0) {
+			/* An empty list is just NIL, without a list header or tail */
 			append_nil_ext(b);
 		} else {
 			if (length > std::numeric_limits<uint32_t>::max() - 1) {
 				throw dpp::parse_exception(err_etf, "ETF encode: List too large for ETF");
 			}
-		}
 
-		append_list_header(b, length);
-		for(size_t index = 0; index < length; ++index) {
-			inner_build(&((*i)[index]), b);
+			append_list_header(b, length);
+			for(size_t index = 0; index < length; ++index) {
+				inner_build(&((*i)[index]), b);
+			}
+			append_nil_ext(b);
 		}
-		append_nil_ext(b);
 	}
 	else if (i->is_object()) {
 		/* Object types (can contain any other type, recursively, but nlohmann::json only supports string keys) */
@@ -39,7 +39,7 @@ namespace dpp::events {
  * @param j JSON data for the event
  * @param raw Raw JSON string
  */
-void guild_emojis_update::handle(discord_client* client, json &j, const std::string &raw) {
+void guild_emojis_update::handle(discord_client* client, json &j, std::string_view raw) {
 	json& d = j["d"];
 	dpp::snowflake guild_id = snowflake_not_null(&d, "guild_id");
 	dpp::guild* g = dpp::find_guild(guild_id);
@@ -36,7 +36,7 @@ namespace dpp::events {
  * @param j JSON data for the event
  * @param raw Raw JSON string
  */
-void guild_scheduled_event_create::handle(discord_client* client, json &j, const std::string &raw) {
+void guild_scheduled_event_create::handle(discord_client* client, json &j, std::string_view raw) {
 	json& d = j["d"];
 	if (!client->creator->on_guild_scheduled_event_create.empty()) {
 		dpp::guild_scheduled_event_create_t ec(client, raw);
@@ -37,7 +37,7 @@ namespace dpp::events {
  * @param j JSON data for the event
  * @param raw Raw JSON string
  */
-void guild_scheduled_event_update::handle(discord_client* client, json &j, const std::string &raw) {
+void guild_scheduled_event_update::handle(discord_client* client, json &j, std::string_view raw) {
 	json& d = j["d"];
 	if (!client->creator->on_guild_scheduled_event_update.empty()) {
 		dpp::guild_scheduled_event_update_t eu(client, raw);
@@ -36,7 +36,7 @@ namespace dpp::events {
  * @param j JSON data for the event
  * @param raw Raw JSON string
  */
-void integration_delete::handle(discord_client* client, json &j, const std::string &raw) {
+void integration_delete::handle(discord_client* client, json &j, std::string_view raw) {
 	if (!client->creator->on_integration_delete.empty()) {
 		json& d = j["d"];
 		dpp::integration_delete_t id(client, raw);
@@ -36,7 +36,7 @@ namespace dpp::events {
  * @param j JSON data for the event
  * @param raw Raw JSON string
  */
-void invite_delete::handle(discord_client* client, json &j, const std::string &raw) {
+void invite_delete::handle(discord_client* client, json &j, std::string_view raw) {
 	if (!client->creator->on_invite_delete.empty()) {
 		json& d = j["d"];
 		dpp::invite_delete_t cd(client, raw);
@@ -35,10 +35,10 @@ namespace dpp::events {
  * @param j JSON data for the event
  * @param raw Raw JSON string
  */
-void logger::handle(discord_client* client, json &j, const std::string &raw) {
+void logger::handle(discord_client* client, json &j, std::string_view raw) {
 	if (!client->creator->on_log.empty()) {
 		dpp::log_t logmsg(client, raw);
-		logmsg.severity = (dpp::loglevel)from_string<uint32_t>(raw.substr(0, raw.find(';')));
+		logmsg.severity = (dpp::loglevel)from_string<uint32_t>(std::string(raw.substr(0, raw.find(';'))));
 		logmsg.message = raw.substr(raw.find(';') + 1, raw.length());
 		client->creator->on_log.call(logmsg);
 	}
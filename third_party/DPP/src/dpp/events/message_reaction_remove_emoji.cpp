@@ -36,7 +36,7 @@ namespace dpp::events {
  * @param j JSON data for the event
  * @param raw Raw JSON string
  */
-void message_reaction_remove_emoji::handle(discord_client* client, json &j, const std::string &raw) {
+void message_reaction_remove_emoji::handle(discord_client* client, json &j, std::string_view raw) {
 	if (!client->creator->on_message_reaction_remove_emoji.empty()) {
 		json &d = j["d"];
 		dpp::message_reaction_remove_emoji_t mrre(client, raw);
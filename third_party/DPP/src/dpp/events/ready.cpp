@@ -39,7 +39,7 @@ std::mutex protect_the_loot;
  * @param j JSON data for the event
  * @param raw Raw JSON string
  */
-void ready::handle(discord_client* client, json &j, const std::string &raw) {
+void ready::handle(discord_client* client, json &j, std::string_view raw) {
 	client->log(dpp::ll_info, "Shard id " + std::to_string(client->shard_id) + " (" + std::to_string(client->shard_id + 1) + "/" + std::to_string(client->max_shards) + ") ready!");
 	client->sessionid = j["d"]["session_id"].get<std::string>();
 	/* Session-specific gateway resume url
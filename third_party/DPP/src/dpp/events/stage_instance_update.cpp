@@ -36,7 +36,7 @@ namespace dpp::events {
  * @param j JSON data for the event
  * @param raw Raw JSON string
  */
-void stage_instance_update::handle(discord_client* client, json &j, const std::string &raw) {
+void stage_instance_update::handle(discord_client* client, json &j, std::string_view raw) {
 	if (!client->creator->on_stage_instance_update.empty()) {
 		json& d = j["d"];
 		dpp::stage_instance_update_t siu(client, raw);
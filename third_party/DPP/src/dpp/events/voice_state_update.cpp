@@ -37,7 +37,7 @@ namespace dpp::events {
  * @param j JSON data for the event
  * @param raw Raw JSON string
  */
-void voice_state_update::handle(discord_client* client, json &j, const std::string &raw) {
+void voice_state_update::handle(discord_client* client, json &j, std::string_view raw) {
 
 	json& d = j["d"];
 	dpp::voice_state_update_t vsu(client, raw);
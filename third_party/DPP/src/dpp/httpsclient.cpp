@@ -30,8 +30,17 @@
 
 namespace dpp {
 
+/**
+ * @brief POST and PATCH are not idempotent. The server may have acted on a request it never answered,
+ * so they are never sent on a pooled connection which the server could close under them, and never retried.
+ */
+static bool idempotent(const std::string &verb)
+{
+	return verb != "POST" && verb != "PATCH";
+}
+
 https_client::https_client(const std::string &hostname, uint16_t port,  const std::string &urlpath, const std::string &verb, const std::string &req_body, const http_headers& extra_headers, bool plaintext_connection, uint16_t request_timeout, const std::string &protocol)
-	: ssl_client(hostname, std::to_string(port), plaintext_connection, false),
+	: ssl_client(hostname, std::to_string(port), plaintext_connection, idempotent(verb)),
 	state(HTTPS_HEADERS),
 	request_type(verb),
 	path(urlpath),
@@ -45,6 +54,8 @@ https_client::https_client(const std::string &hostname, uint16_t port,  const st
 {
 	nonblocking = false;
 	timeout = time(nullptr) + request_timeout;
+	/* A new connection opened for POST or PATCH still goes back into the keepalive cache afterwards */
+	keepalive = true;
 	https_client::connect();
 }
 
@@ -56,7 +67,7 @@ void https_client::connect()
 		map_headers += k + ": " + v + "\r\n";
 	}
 	if (this->sfd != SOCKET_ERROR) {
-		this->socket_write(
+		const std::string request(
 			this->request_type + " " + this->path + " HTTP/" + http_protocol + "\r\n"
 			"Host: " + this->hostname + "\r\n"
 			"pragma: no-cache\r\n"
@@ -68,7 +79,29 @@ void https_client::connect()
 			"\r\n" +
 			this->request_body
 		);
-		read_loop();
+		/* Only idempotent requests are sent on a pooled connection */
+		bool retry = !make_new;
+		try {
+			this->socket_write(request);
+			read_loop();
+		}
+		catch (const std::exception&) {
+			if (!retry) {
+				throw;
+			}
+		}
+		if (retry && get_bytes_in() == 0 && !timed_out) {
+			/* The server closed the kept-alive connection before it could reply. Retry once on a new connection. */
+			keepalive = false;
+			ssl_client::close();
+			keepalive = true;
+			make_new = true;
+			nonblocking = false;
+			state = HTTPS_HEADERS;
+			ssl_client::connect();
+			this->socket_write(request);
+			read_loop();
+		}
 	}
 }
 
@@ -207,6 +240,10 @@ bool https_client::handle_buffer(std::string &buffer)
 									state_changed = true;
 								}
 							}
+							if (content_length == ULLONG_MAX && !chunked) {
+								/* The body ends when the server closes the connection, so it can't be reused */
+								keepalive = false;
+							}
 							status = atoi(req_status[1].c_str());
 							if (status == 204  || status < 200 || status == 304 || content_length == 0) {
 								return false;
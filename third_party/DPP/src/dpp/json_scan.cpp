@@ -0,0 +1,281 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/json_scan.h>
+#include <atomic>
+#include <cstdlib>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define DPP_JSON_SCAN_SSE2
+	#include <emmintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
+/* Lets the SSE2 path build on 32 bit targets compiled without -msse2; it is only called after a CPU check */
+#if defined(DPP_JSON_SCAN_SSE2) && (defined(__GNUC__) || defined(__clang__))
+	#define DPP_TARGET_SSE2 __attribute__((target("sse2")))
+#else
+	#define DPP_TARGET_SSE2
+#endif
+
+namespace dpp::json_scan {
+
+namespace {
+
+/**
+ * @brief Finds the next character of interest at or after pos.
+ * Inside a string that is '"' or '\\', outside of one it is '"' or a bracket.
+ * Returns len if there is none.
+ */
+using find_fn = size_t (*)(const char* p, size_t len, size_t pos, bool in_string);
+
+size_t find_scalar(const char* p, size_t len, size_t pos, bool in_string) {
+	if (in_string) {
+		for (; pos < len; ++pos) {
+			if (p[pos] == '"' || p[pos] == '\\') {
+				return pos;
+			}
+		}
+	} else {
+		for (; pos < len; ++pos) {
+			switch (p[pos]) {
+				case '"':
+				case '{':
+				case '}':
+				case '[':
+				case ']':
+					return pos;
+			}
+		}
+	}
+	return len;
+}
+
+#ifdef DPP_JSON_SCAN_SSE2
+
+inline unsigned lowest_bit(unsigned mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+DPP_TARGET_SSE2 size_t find_sse2(const char* p, size_t len, size_t pos, bool in_string) {
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	/* '[' and ']' are '{' and '}' with bit 5 clear, so or-ing in 0x20 folds all four into two compares */
+	const __m128i case_bit = _mm_set1_epi8(0x20);
+	const __m128i open = _mm_set1_epi8('{');
+	const __m128i close = _mm_set1_epi8('}');
+	while (pos + 16 <= len) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + pos));
+		__m128i hits;
+		if (in_string) {
+			hits = _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash));
+		} else {
+			__m128i folded = _mm_or_si128(block, case_bit);
+			hits = _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)));
+		}
+		unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+		if (mask) {
+			return pos + lowest_bit(mask);
+		}
+		pos += 16;
+	}
+	return find_scalar(p, len, pos, in_string);
+}
+
+bool detect_sse2() {
+#if defined(__x86_64__) || defined(_M_X64)
+	/* Part of the x86-64 baseline */
+	return true;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#else
+	/* Runs from a static initializer, possibly before libgcc has filled in the CPU model */
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+#endif
+}
+
+#else
+
+bool detect_sse2() {
+	return false;
+}
+
+#endif
+
+const bool sse2_supported = detect_sse2();
+
+std::atomic<bool> use_simd{sse2_supported};
+
+find_fn current_finder() {
+#ifdef DPP_JSON_SCAN_SSE2
+	if (use_simd.load(std::memory_order_relaxed)) {
+		return find_sse2;
+	}
+#endif
+	return find_scalar;
+}
+
+/**
+ * @brief Skip a string starting at the opening quote at pos
+ * @return position after the closing quote, or npos
+ */
+size_t skip_string(const char* p, size_t len, size_t pos, find_fn find) {
+	while (true) {
+		pos = find(p, len, pos + 1, true);
+		if (pos >= len) {
+			return std::string_view::npos;
+		}
+		if (p[pos] == '"') {
+			return pos + 1;
+		}
+		/* Skip the escaped character */
+		++pos;
+	}
+}
+
+}
+
+bool simd_supported() {
+	return sse2_supported;
+}
+
+bool set_simd(bool enable) {
+	use_simd = enable && sse2_supported;
+	return use_simd;
+}
+
+bool simd_enabled() {
+	return use_simd;
+}
+
+size_t skip_space(std::string_view s, size_t pos) {
+	while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\n' || s[pos] == '\r')) {
+		++pos;
+	}
+	return pos;
+}
+
+size_t skip_value(std::string_view s, size_t pos) {
+	const char* p = s.data();
+	const size_t len = s.size();
+	if (pos >= len) {
+		return std::string_view::npos;
+	}
+	find_fn find = current_finder();
+	if (p[pos] == '"') {
+		return skip_string(p, len, pos, find);
+	}
+	if (p[pos] == '{' || p[pos] == '[') {
+		size_t depth = 0;
+		while (true) {
+			pos = find(p, len, pos, false);
+			if (pos >= len) {
+				return std::string_view::npos;
+			}
+			switch (p[pos]) {
+				case '"':
+					pos = skip_string(p, len, pos, find);
+					if (pos == std::string_view::npos) {
+						return pos;
+					}
+					continue;
+				case '{':
+				case '[':
+					++depth;
+				break;
+				default:
+					if (--depth == 0) {
+						return pos + 1;
+					}
+				break;
+			}
+			++pos;
+		}
+	}
+	/* Number, true, false or null */
+	while (pos < len && p[pos] != ',' && p[pos] != '}' && p[pos] != ']' && p[pos] != ' ') {
+		++pos;
+	}
+	return pos;
+}
+
+bool read_frame_header(std::string_view s, frame_header &header) {
+	bool seen_seq = false, seen_event = false;
+	size_t pos = skip_space(s, 0);
+	if (pos >= s.size() || s[pos] != '{') {
+		return false;
+	}
+	pos = skip_space(s, pos + 1);
+	while (pos < s.size() && s[pos] != '}') {
+		size_t key_end = skip_value(s, pos);
+		if (s[pos] != '"' || key_end == std::string_view::npos) {
+			return false;
+		}
+		std::string_view key = s.substr(pos + 1, key_end - pos - 2);
+		pos = skip_space(s, key_end);
+		if (pos >= s.size() || s[pos] != ':') {
+			return false;
+		}
+		pos = skip_space(s, pos + 1);
+		size_t value_end = skip_value(s, pos);
+		if (value_end == std::string_view::npos) {
+			return false;
+		}
+		std::string_view value = s.substr(pos, value_end - pos);
+
+		if (key == "op") {
+			header.op = static_cast<uint32_t>(std::strtoul(std::string(value).c_str(), nullptr, 10));
+		} else if (key == "s") {
+			seen_seq = true;
+			if (value != "null") {
+				header.seq = std::strtoull(std::string(value).c_str(), nullptr, 10);
+			}
+		} else if (key == "t") {
+			seen_event = true;
+			if (value.size() >= 2 && value.front() == '"') {
+				header.event = value.substr(1, value.size() - 2);
+			}
+		}
+		if (header.op && seen_seq && seen_event) {
+			return true;
+		}
+
+		pos = skip_space(s, value_end);
+		if (pos < s.size() && s[pos] == ',') {
+			pos = skip_space(s, pos + 1);
+		}
+	}
+	return header.op.has_value();
+}
+
+} // namespace dpp::json_scan
@@ -28,11 +28,19 @@
 #include <dpp/queues.h>
 #include <dpp/cluster.h>
 #include <dpp/httpsclient.h>
+#include <optional>
 
 namespace dpp {
 
+/* Observer of all HTTP requests, read without a lock by every request thread */
+static std::atomic<rest_observer_t> rest_observer{nullptr};
+
+void set_rest_observer(rest_observer_t observer) {
+	rest_observer.store(observer);
+}
+
 http_request::http_request(const std::string &_endpoint, const std::string &_parameters, http_completion_event completion, const std::string &_postdata, http_method _method, const std::string &audit_reason, const std::string &filename, const std::string &filecontent, const std::string &filemimetype, const std::string &http_protocol)
- : complete_handler(completion), completed(false), non_discord(false), endpoint(_endpoint), parameters(_parameters), postdata(_postdata),  method(_method), reason(audit_reason), mimetype("application/json"), waiting(false), protocol(http_protocol), request_timeout(5)
+ : complete_handler(completion), completed(false), non_discord(false), endpoint(_endpoint), parameters(_parameters), postdata(_postdata),  method(_method), reason(audit_reason), mimetype("application/json"), waiting(false), protocol(http_protocol), priority(p_normal), owner(nullptr), request_timeout(5)
 {
 	if (!filename.empty()) {
 		file_name.push_back(filename);
@@ -46,13 +54,13 @@ http_request::http_request(const std::string &_endpoint, const std::string &_par
 }
 
 http_request::http_request(const std::string &_endpoint, const std::string &_parameters, http_completion_event completion, const std::string &_postdata, http_method method, const std::string &audit_reason, const std::vector<std::string> &filename, const std::vector<std::string> &filecontent, const std::vector<std::string> &filemimetypes, const std::string &http_protocol)
- : complete_handler(completion), completed(false), non_discord(false), endpoint(_endpoint), parameters(_parameters), postdata(_postdata),  method(method), reason(audit_reason), file_name(filename), file_content(filecontent), file_mimetypes(filemimetypes), mimetype("application/json"), waiting(false), protocol(http_protocol), request_timeout(5)
+ : complete_handler(completion), completed(false), non_discord(false), endpoint(_endpoint), parameters(_parameters), postdata(_postdata),  method(method), reason(audit_reason), file_name(filename), file_content(filecontent), file_mimetypes(filemimetypes), mimetype("application/json"), waiting(false), protocol(http_protocol), priority(p_normal), owner(nullptr), request_timeout(5)
 {
 }
 
 
 http_request::http_request(const std::string &_url, http_completion_event completion, http_method _method, const std::string &_postdata, const std::string &_mimetype, const std::multimap<std::string, std::string> &_headers, const std::string &http_protocol, time_t _request_timeout)
- : complete_handler(completion), completed(false), non_discord(true), endpoint(_url), postdata(_postdata), method(_method), mimetype(_mimetype), req_headers(_headers), waiting(false), protocol(http_protocol), request_timeout(_request_timeout)
+ : complete_handler(completion), completed(false), non_discord(true), endpoint(_url), postdata(_postdata), method(_method), mimetype(_mimetype), req_headers(_headers), waiting(false), protocol(http_protocol), priority(p_normal), owner(nullptr), request_timeout(_request_timeout)
 {
 }
 
@@ -192,12 +200,17 @@ http_request_completion_t http_request::run(cluster* owner) {
 		rv.error = h_connection;
 	}
 
+	rest_observer_t observer = rest_observer.load();
+	if (observer) {
+		observer(*this, rv);
+	}
+
 	/* Set completion flag */
 	completed = true;
 	return rv;
 }
 
-request_queue::request_queue(class cluster* owner, uint32_t request_threads) : creator(owner), terminating(false), globally_ratelimited(false), globally_limited_for(0), in_thread_pool_size(request_threads)
+request_queue::request_queue(class cluster* owner, uint32_t request_threads) : creator(owner), completing_owner(nullptr), keep_warm(false), terminating(false), globally_ratelimited(false), globally_limited_for(0), in_thread_pool_size(request_threads)
 {
 	for (uint32_t in_alloc = 0; in_alloc < in_thread_pool_size; ++in_alloc) {
 		requests_in.push_back(std::make_unique<in_thread>(owner, this, in_alloc));
@@ -219,7 +232,7 @@ uint32_t request_queue::get_request_thread_count() const
 	return in_thread_pool_size;
 }
 
-in_thread::in_thread(class cluster* owner, class request_queue* req_q, uint32_t index) : terminating(false), requests(req_q), creator(owner)
+in_thread::in_thread(class cluster* owner, class request_queue* req_q, uint32_t index) : terminating(false), requests(req_q), creator(owner), pending(false), urgent_pending(false), running_owner(nullptr)
 {
 	this->in_thr = new std::thread(&in_thread::in_loop, this, index);
 }
@@ -233,7 +246,10 @@ in_thread::~in_thread()
 
 void in_thread::terminate()
 {
-	terminating.store(true, std::memory_order_relaxed);
+	{
+		std::scoped_lock lock(ready_mutex);
+		terminating.store(true, std::memory_order_relaxed);
+	}
 	in_ready.notify_one();
 }
 
@@ -292,9 +308,16 @@ void in_thread::in_loop(uint32_t index)
 {
 	utility::set_thread_name(std::string("http_req/") + std::to_string(index));
 	while (!terminating.load(std::memory_order_relaxed)) {
-		std::mutex mtx;
-		std::unique_lock<std::mutex> lock{ mtx };
-		in_ready.wait_for(lock, std::chrono::seconds(1));
+		{
+			/* Wait for a post, or time out so that rate limited buckets are retried */
+			std::unique_lock<std::mutex> lock{ ready_mutex };
+			in_ready.wait_for(lock, std::chrono::seconds(1), [this] {
+				return pending.load() || terminating.load(std::memory_order_relaxed);
+			});
+			pending.store(false);
+			urgent_pending.store(false);
+		}
+
 		/* New request to be sent! */
 
 		if (!requests->globally_ratelimited) {
@@ -303,44 +326,107 @@ void in_thread::in_loop(uint32_t index)
 			{
 				/* Gather all the requests first within a mutex */
 				std::shared_lock lock(in_mutex);
-				if (requests_in.empty()) {
-					/* Nothing to copy, wait again */
-					continue;
-				}
 				requests_view.reserve(requests_in.size());
 				std::transform(requests_in.begin(), requests_in.end(), std::back_inserter(requests_view), [](const std::unique_ptr<http_request> &r) {
 					return r.get();
 				});
 			}
+			if (requests_view.empty()) {
+				/* Nothing to send. Only while idle, so that no request waits behind a handshake,
+				 * have a connection to Discord ready in this thread's keepalive cache for the next one.
+				 */
+				if (requests->keep_warm.load(std::memory_order_relaxed)) {
+					try {
+						http_connect_info hci = https_client::get_host_info(DISCORD_HOST);
+						ssl_client::warm_up(hci.hostname, std::to_string(hci.port));
+					}
+					catch (const std::exception&) {
+						/* The next request will connect by itself, and report any error */
+					}
+				}
+				/* Wait again */
+				continue;
+			}
+
+			/* Serve higher priority requests first, keeping endpoint order within each priority */
+			std::stable_sort(requests_view.begin(), requests_view.end(), [](const http_request* lhs, const http_request* rhs) {
+				return lhs->priority > rhs->priority;
+			});
 
 			for (auto& request_view : requests_view) {
+				if (urgent_pending.load() && request_view->priority == p_normal) {
+					/* An urgent request arrived while this batch was running, go back and gather it */
+					pending.store(true);
+					break;
+				}
 				const std::string &key = request_view->endpoint;
+
+				/* Remove a request from the incoming requests, to complete or discard it */
+				auto take_request = [this, &key, &request_view]() {
+					std::unique_ptr<http_request> request;
+					/* Find the owned pointer in requests_in */
+					std::scoped_lock lock1{in_mutex};
+
+					auto [begin, end] = std::equal_range(requests_in.begin(), requests_in.end(), key, compare_request{});
+					for (auto it = begin; it != end; ++it) {
+						if (it->get() == request_view) {
+							/* Grab and remove */
+							request = std::move(*it);
+							requests_in.erase(it);
+							break;
+						}
+					}
+					return request;
+				};
+
+				cluster* owner;
+				{
+					/* detach() clears the owner of queued requests under this lock */
+					std::shared_lock lock(in_mutex);
+					owner = request_view->owner ? request_view->owner : creator;
+					running_owner.store(owner);
+				}
+				if (!owner) {
+					/* The cluster which made this request has been detached from a shared queue */
+					take_request();
+					continue;
+				}
+
 				http_request_completion_t rv;
-				auto                      currbucket = buckets.find(key);
+				auto                      bucket_key = std::make_pair(static_cast<const cluster*>(owner), key);
+				std::optional<bucket_t>   currbucket;
+				{
+					std::scoped_lock lock(buckets_mutex);
+					auto found = buckets.find(bucket_key);
+					if (found != buckets.end()) {
+						currbucket = found->second;
+					}
+				}
 
-				if (currbucket != buckets.end()) {
+				if (currbucket) {
 					/* There's a bucket for this request. Check its status. If the bucket says to wait,
 					* skip all requests in this bucket till its ok.
 					*/
-					if (currbucket->second.remaining < 1) {
-						uint64_t wait = (currbucket->second.retry_after ? currbucket->second.retry_after : currbucket->second.reset_after);
-						if ((uint64_t)time(nullptr) > currbucket->second.timestamp + wait) {
+					if (currbucket->remaining < 1) {
+						uint64_t wait = (currbucket->retry_after ? currbucket->retry_after : currbucket->reset_after);
+						if ((uint64_t)time(nullptr) > currbucket->timestamp + wait) {
 							/* Time has passed, we can process this bucket again. send its request. */
-							rv = request_view->run(creator);
+							rv = request_view->run(owner);
 						} else {
 							if (!request_view->waiting) {
 								request_view->waiting = true;
 							}
 							/* Time not up yet, wait more */
+							running_owner.store(nullptr);
 							break;
 						}
 					} else {
 						/* There's limit remaining, we can just run the request */
-						rv = request_view->run(creator);
+						rv = request_view->run(owner);
 					}
 				} else {
 					/* No bucket for this endpoint yet. Just send it, and make one from its reply */
-					rv = request_view->run(creator);
+					rv = request_view->run(owner);
 				}
 
 				bucket_t newbucket;
@@ -353,24 +439,14 @@ void in_thread::in_loop(uint32_t index)
 				if (requests->globally_ratelimited) {
 					requests->globally_limited_for = (newbucket.retry_after ? newbucket.retry_after : newbucket.reset_after);
 				}
-				buckets[request_view->endpoint] = newbucket;
+				{
+					std::scoped_lock lock(buckets_mutex);
+					buckets[bucket_key] = newbucket;
+				}
 
 				/* Remove the request from the incoming requests to transfer it to completed requests */
-				std::unique_ptr<http_request> request;
-				{
-					/* Find the owned pointer in requests_in */
-					std::scoped_lock lock1{in_mutex};
+				std::unique_ptr<http_request> request = take_request();
 
-					auto [begin, end] = std::equal_range(requests_in.begin(), requests_in.end(), key, compare_request{});
-					for (auto it = begin; it != end; ++it) {
-						if (it->get() == request_view) {
-							/* Grab and remove */
-							request = std::move(*it);
-							requests_in.erase(it);
-							break;
-						}
-					}
-				}
 				/* Make a new entry in the completion list and notify */
 				auto hrc = std::make_unique<http_request_completion_t>();
 				*hrc = rv;
@@ -378,6 +454,7 @@ void in_thread::in_loop(uint32_t index)
 					std::scoped_lock lock1(requests->out_mutex);
 					requests->responses_out.push({std::move(request), std::move(hrc)});
 				}
+				running_owner.store(nullptr);
 				requests->out_ready.notify_one();
 			}
 
@@ -387,7 +464,7 @@ void in_thread::in_loop(uint32_t index)
 				requests->globally_limited_for = 0;
 			}
 			requests->globally_ratelimited = false;
-			in_ready.notify_one();
+			pending.store(true);
 		}
 	}
 }
@@ -411,22 +488,27 @@ void request_queue::out_loop()
 		out_ready.wait_for(lock, std::chrono::seconds(1));
 		time_t now = time(nullptr);
 
-		/* A request has been completed! */
-		completed_request queue_head = {};
-		{
-			std::scoped_lock lock1(out_mutex);
-			if (responses_out.size()) {
+		/* Requests have been completed! Drain all of them, a wake-up may cover several */
+		while (true) {
+			completed_request queue_head = {};
+			{
+				std::scoped_lock lock1(out_mutex);
+				if (responses_out.empty()) {
+					break;
+				}
 				queue_head = std::move(responses_out.front());
 				responses_out.pop();
+				completing_owner.store(queue_head.request ? queue_head.request->owner : nullptr);
 			}
-		}
 
-		if (queue_head.request && queue_head.response) {
-			queue_head.request->complete(*queue_head.response);
-			/* Queue deletions for 60 seconds from now */
-			auto when = now + 60;
-			auto where = std::lower_bound(responses_to_delete.begin(), responses_to_delete.end(), when);
-			responses_to_delete.insert(where, {when, std::move(queue_head)});
+			if (queue_head.request && queue_head.response) {
+				queue_head.request->complete(*queue_head.response);
+				/* Queue deletions for 60 seconds from now */
+				auto when = now + 60;
+				auto where = std::lower_bound(responses_to_delete.begin(), responses_to_delete.end(), when);
+				responses_to_delete.insert(where, {when, std::move(queue_head)});
+			}
+			completing_owner.store(nullptr);
 		}
 
 		/* Check for deletable items every second regardless of select status */
@@ -443,8 +525,15 @@ void in_thread::post_request(std::unique_ptr<http_request> req)
 	{
 		std::scoped_lock lock(in_mutex);
 
+		bool urgent = req->priority > p_normal;
 		auto where = std::lower_bound(requests_in.begin(), requests_in.end(), req->endpoint, compare_request{});
 		requests_in.emplace(where, std::move(req));
+
+		std::scoped_lock ready_lock(ready_mutex);
+		pending.store(true);
+		if (urgent) {
+			urgent_pending.store(true);
+		}
 	}
 	in_ready.notify_one();
 }
@@ -479,4 +568,76 @@ bool request_queue::is_globally_ratelimited() const
 	return this->globally_ratelimited;
 }
 
+bool request_queue::is_shared() const
+{
+	return this->creator == nullptr;
+}
+
+void in_thread::wake()
+{
+	{
+		std::scoped_lock lock(ready_mutex);
+		pending.store(true);
+	}
+	in_ready.notify_one();
+}
+
+request_queue& request_queue::set_keep_warm(bool warm)
+{
+	keep_warm.store(warm);
+	if (warm) {
+		for (auto& in_thr : requests_in) {
+			in_thr->wake();
+		}
+	}
+	return *this;
+}
+
+void in_thread::detach(cluster* owner)
+{
+	{
+		/* Queued requests are dropped by in_loop once they have no owner */
+		std::unique_lock lock(in_mutex);
+		for (auto& r : requests_in) {
+			if (r->owner == owner) {
+				r->owner = nullptr;
+			}
+		}
+	}
+	while (running_owner.load() == owner) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	/* The cluster is about to be freed, and a new one at the same address must not inherit its rate limits */
+	std::scoped_lock lock(buckets_mutex);
+	for (auto it = buckets.begin(); it != buckets.end();) {
+		if (it->first.first == owner) {
+			it = buckets.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void request_queue::detach(cluster* owner)
+{
+	for (auto& in_thr : requests_in) {
+		in_thr->detach(owner);
+	}
+	{
+		/* No in_thread can add to this now, throw away any callbacks still waiting for the cluster */
+		std::scoped_lock lock(out_mutex);
+		std::queue<completed_request> remaining;
+		while (!responses_out.empty()) {
+			if (responses_out.front().request && responses_out.front().request->owner != owner) {
+				remaining.push(std::move(responses_out.front()));
+			}
+			responses_out.pop();
+		}
+		responses_out.swap(remaining);
+	}
+	while (completing_owner.load() == owner) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
 }
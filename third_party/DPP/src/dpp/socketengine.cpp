@@ -0,0 +1,284 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/socketengine.h>
+#include <dpp/sslclient.h>
+#include <dpp/exception.h>
+#include <dpp/utility.h>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#ifdef __linux__
+	#include <sys/epoll.h>
+	#include <sys/eventfd.h>
+	#include <unistd.h>
+#endif
+
+namespace dpp {
+
+/* Most readiness events taken from epoll per pass */
+constexpr int ENGINE_MAX_EVENTS{64};
+
+static std::atomic<bool> engine_enabled{false};
+
+bool socket_engine::available()
+{
+#ifdef __linux__
+	return true;
+#else
+	return false;
+#endif
+}
+
+void socket_engine::set_enabled(bool enabled)
+{
+	engine_enabled = enabled && available();
+}
+
+bool socket_engine::is_enabled()
+{
+	return engine_enabled;
+}
+
+socket_engine& socket_engine::get()
+{
+	static socket_engine engine;
+	return engine;
+}
+
+#ifdef __linux__
+
+socket_engine::socket_engine() : epoll_fd(-1), wake_fd(-1), terminating(false), last_tick(time(nullptr)), runner(nullptr)
+{
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (epoll_fd < 0 || wake_fd < 0) {
+		int err = errno;
+		if (epoll_fd >= 0) {
+			::close(epoll_fd);
+		}
+		if (wake_fd >= 0) {
+			::close(wake_fd);
+		}
+		throw dpp::connection_exception(err_socket_error, std::string("Can't create socket engine: ") + strerror(err));
+	}
+	/* The wake fd is told apart from connections by its null pointer */
+	epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.ptr = nullptr;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+	runner = new std::thread(&socket_engine::thread_run, this);
+}
+
+socket_engine::~socket_engine()
+{
+	terminating = true;
+	uint64_t one = 1;
+	[[maybe_unused]] ssize_t r = ::write(wake_fd, &one, sizeof(one));
+	if (runner) {
+		runner->join();
+		delete runner;
+	}
+	::close(wake_fd);
+	::close(epoll_fd);
+}
+
+void socket_engine::add(ssl_client* client, socket_end_t on_end)
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+	auto c = std::make_unique<connection>();
+	c->client = client;
+	c->on_end = std::move(on_end);
+	c->want_write = client->wants_write();
+	c->ended = false;
+
+	epoll_event ev = {};
+	ev.events = static_cast<uint32_t>(EPOLLIN) | (c->want_write ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+	ev.data.ptr = c.get();
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client->sfd, &ev) != 0) {
+		throw dpp::connection_exception(err_socket_error, std::string("Can't add socket to socket engine: ") + strerror(errno));
+	}
+	connections[client] = std::move(c);
+}
+
+void socket_engine::remove(ssl_client* client)
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+	auto iter = connections.find(client);
+	if (iter != connections.end()) {
+		end(iter->second.get(), false);
+	}
+}
+
+size_t socket_engine::size()
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+	return connections.size();
+}
+
+void socket_engine::end(connection* c, bool notify)
+{
+	c->ended = true;
+	/* The socket may already be closed, in which case epoll dropped it itself */
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->client->sfd, nullptr);
+	auto iter = connections.find(c->client);
+	retired.emplace_back(std::move(iter->second));
+	connections.erase(iter);
+	if (notify && c->on_end) {
+		c->on_end();
+	}
+}
+
+void socket_engine::service(connection* c, uint32_t events)
+{
+	bool alive = false;
+	try {
+		if (events & EPOLLERR) {
+			throw dpp::connection_exception(err_socket_error, "Socket error");
+		}
+		/* A hangup is reported as readable, so the read sees the end of the stream */
+		alive = c->client->handle_io(events & (EPOLLIN | EPOLLHUP), events & EPOLLOUT);
+	}
+	catch (const std::exception &e) {
+		c->client->log(ll_warning, std::string("Read loop ended: ") + e.what());
+	}
+	if (!alive) {
+		end(c, true);
+	}
+}
+
+void socket_engine::update_interest(connection* c)
+{
+	bool want_write = c->client->wants_write();
+	if (want_write != c->want_write) {
+		epoll_event ev = {};
+		ev.events = static_cast<uint32_t>(EPOLLIN) | (want_write ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+		ev.data.ptr = c;
+		epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->client->sfd, &ev);
+		c->want_write = want_write;
+	}
+}
+
+void socket_engine::thread_run()
+{
+	utility::set_thread_name("sockets");
+	epoll_event events[ENGINE_MAX_EVENTS];
+	std::vector<connection*> pass;
+
+	while (!terminating) {
+		/* Wake at the next second boundary for the timers, or sooner for socket activity.
+		 * Level triggered, as ssl_client reads at most what OpenSSL has buffered per call.
+		 */
+		const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		int ready = epoll_wait(epoll_fd, events, ENGINE_MAX_EVENTS, static_cast<int>(1000 - (now % 1000)));
+		if (ready < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		for (int i = 0; i < ready; ++i) {
+			connection* c = static_cast<connection*>(events[i].data.ptr);
+			if (c == nullptr) {
+				uint64_t count;
+				[[maybe_unused]] ssize_t r = ::read(wake_fd, &count, sizeof(count));
+			} else if (!c->ended) {
+				service(c, events[i].events);
+			}
+		}
+
+		/* Take a copy, as ending a connection removes it from the map */
+		pass.clear();
+		for (auto& entry : connections) {
+			pass.emplace_back(entry.second.get());
+		}
+
+		if (last_tick != time(nullptr)) {
+			last_tick = time(nullptr);
+			for (connection* c : pass) {
+				if (c->ended) {
+					continue;
+				}
+				try {
+					c->client->one_second_timer();
+					c->client->last_tick = last_tick;
+				}
+				catch (const std::exception &e) {
+					c->client->log(ll_warning, std::string("Read loop ended: ") + e.what());
+					end(c, true);
+				}
+			}
+		}
+
+		/* Timers and handlers may have queued output, so writes are picked up in the same pass */
+		for (connection* c : pass) {
+			if (!c->ended) {
+				update_interest(c);
+			}
+		}
+
+		retired.clear();
+	}
+}
+
+#else
+
+socket_engine::socket_engine() : epoll_fd(-1), wake_fd(-1), terminating(false), last_tick(time(nullptr)), runner(nullptr)
+{
+	throw dpp::connection_exception(err_socket_error, "The socket engine is not available on this platform");
+}
+
+socket_engine::~socket_engine() = default;
+
+void socket_engine::add(ssl_client* client, socket_end_t on_end)
+{
+}
+
+void socket_engine::remove(ssl_client* client)
+{
+}
+
+size_t socket_engine::size()
+{
+	return 0;
+}
+
+void socket_engine::end(connection* c, bool notify)
+{
+}
+
+void socket_engine::service(connection* c, uint32_t events)
+{
+}
+
+void socket_engine::update_interest(connection* c)
+{
+}
+
+void socket_engine::thread_run()
+{
+}
+
+#endif
+
+} // namespace dpp
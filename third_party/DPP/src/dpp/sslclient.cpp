@@ -38,6 +38,7 @@
 	/* Anyting other than Windows (e.g. sane OSes) */
 	#include <poll.h>
 	#include <sys/socket.h>
+	#include <sys/uio.h>
 	#include <unistd.h>
 #endif
 #include <csignal>
@@ -56,10 +57,12 @@
 	#undef OCSP_RESPONSE
 #endif
 #include <exception>
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <unordered_map>
 #include <chrono>
+#include <atomic>
 #include <dpp/sslclient.h>
 #include <dpp/exception.h>
 #include <dpp/utility.h>
@@ -69,6 +72,12 @@
 /* Maximum allowed time in milliseconds for socket read/write timeouts and connect() */
 constexpr uint16_t SOCKET_OP_TIMEOUT{5000};
 
+/* Maximum time in seconds a connection may sit in the keepalive cache before it is discarded */
+constexpr time_t KEEPALIVE_TTL{60};
+
+/* Maximum time in milliseconds warm_up() waits for TLS 1.3 session tickets before parking a connection */
+constexpr int SESSION_TICKET_WAIT{1000};
+
 namespace dpp {
 
 /**
@@ -113,12 +122,85 @@ thread_local std::unique_ptr<SSL_CTX, openssl_context_deleter> openssl_context;
  */
 thread_local std::unordered_map<std::string, keepalive_cache_t> keepalives;
 
+/**
+ * @brief Custom deleter for SSL_SESSION
+ */
+class openssl_session_deleter {
+public:
+	void operator()(SSL_SESSION* session) const noexcept {
+		SSL_SESSION_free(session);
+	}
+};
+
+/**
+ * @brief Last resumable TLS session for each host, per-thread as they belong to the thread's SSL_CTX
+ */
+thread_local std::unordered_map<std::string, std::unique_ptr<SSL_SESSION, openssl_session_deleter>> tls_sessions;
+
+/**
+ * @brief Connection counters, shared by all threads
+ */
+std::atomic<uint64_t> stat_opened{0}, stat_reused{0}, stat_tls_resumed{0}, stat_tls_full{0};
+
+connection_stats get_connection_stats() {
+	connection_stats stats;
+	stats.opened = stat_opened.load(std::memory_order_relaxed);
+	stats.reused = stat_reused.load(std::memory_order_relaxed);
+	stats.tls_resumed = stat_tls_resumed.load(std::memory_order_relaxed);
+	stats.tls_full = stat_tls_full.load(std::memory_order_relaxed);
+	return stats;
+}
+
+/**
+ * @brief Key for the keepalive and session caches
+ */
+std::string connection_identifier(bool plaintext, const std::string &hostname, const std::string &port) {
+	return (!plaintext ? "ssl://" : "tcp://") + hostname + ":" + port;
+}
+
+/**
+ * @brief Keep the session of an SSL connection so that the next connection to the same host can resume it
+ * @return true if the session was resumable and has been kept
+ */
+bool remember_session(const std::string &identifier, SSL* ssl) {
+	if (!SSL_is_init_finished(ssl)) {
+		return false;
+	}
+	SSL_SESSION* session = SSL_get1_session(ssl);
+	if (session && SSL_SESSION_is_resumable(session)) {
+		tls_sessions[identifier].reset(session);
+		return true;
+	} else if (session) {
+		SSL_SESSION_free(session);
+	}
+	return false;
+}
+
+/**
+ * @brief Free an SSL connection, keeping its session so that the next connection to the same host can resume it
+ */
+void free_ssl_connection(const std::string &identifier, SSL* ssl) {
+	if (remember_session(identifier, ssl)) {
+		/* SSL_free() on a connection which was not shut down marks its session as not resumable */
+		SSL_set_shutdown(ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+	}
+	SSL_free(ssl);
+}
+
 /* You'd think that we would get better performance with a bigger buffer, but SSL frames are 16k each.
  * SSL_read in non-blocking mode will only read 16k at a time. There's no point in a bigger buffer as
  * it'd go unused.
  */
 constexpr uint16_t DPP_BUFSIZE{16 * 1024};
 
+/* Most bytes handed to a single SSL_write. Larger writes are still split into 16k records by OpenSSL,
+ * but doing several per call saves a trip round the poll loop for each one.
+ */
+constexpr size_t DPP_WRITE_CHUNK{256 * 1024};
+
+/* Most output queue chunks gathered into one write on a plaintext socket */
+constexpr size_t DPP_WRITE_IOVECS{16};
+
 /* Represents a failed socket system call, e.g. connect() failure */
 constexpr int ERROR_STATUS{-1};
 
@@ -218,6 +300,36 @@ int connect_with_timeout(dpp::socket sockfd, const struct sockaddr *addr, sockle
 #endif
 }
 
+/**
+ * @brief Check that an idle connection can still carry a request. Leaves the socket non-blocking.
+ *
+ * The server may send records on an idle TLS connection which are not a reply, such as TLS 1.3
+ * session tickets, so a readable socket alone does not mean it was closed. Those records are
+ * consumed here, and only end of stream, a close alert, an error or unexpected data count as dead.
+ *
+ * @param sfd socket of the connection
+ * @param ssl SSL connection, or nullptr for plaintext
+ * @return true if the connection is still usable
+ */
+bool idle_connection_alive(dpp::socket sfd, SSL* ssl) {
+	if (!set_nonblocking(sfd, true)) {
+		return false;
+	}
+	char peek;
+	if (!ssl) {
+		/* Anything an HTTP server sends between requests would be taken as part of the next reply */
+		const auto r = ::recv(sfd, &peek, 1, MSG_PEEK);
+#ifdef _WIN32
+		return r < 0 && WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+		return r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+#endif
+	}
+	ERR_clear_error();
+	const int r = SSL_peek(ssl, &peek, 1);
+	return r <= 0 && SSL_get_error(ssl, r) == SSL_ERROR_WANT_READ;
+}
+
 #ifndef _WIN32
 void set_signal_handler(int signal)
 {
@@ -241,6 +353,10 @@ ssl_client::ssl_client(const std::string &_hostname, const std::string &_port, b
 	bytes_in(0),
 	plaintext(plaintext_downgrade),
 	make_new(true),
+	client_to_server_length(0),
+	client_to_server_offset(0),
+	read_blocked_on_write(false),
+	write_blocked_on_read(false),
 	keepalive(reuse)
 {
 #ifndef WIN32
@@ -257,29 +373,28 @@ ssl_client::ssl_client(const std::string &_hostname, const std::string &_port, b
 	}
 #endif
 	if (keepalive) {
-		std::string identifier((!plaintext ? "ssl://" : "tcp://") + hostname + ":" + port);
+		std::string identifier(connection_identifier(plaintext, hostname, port));
 		auto iter = keepalives.find(identifier);
 		if (iter != keepalives.end()) {
-			/* Found a keepalive connection, check it is still connected/valid via poll() for error */
-			pollfd pfd = {};
-			pfd.fd = iter->second.sfd;
-			pfd.events = POLLOUT;
-			int r = ::poll(&pfd, 1, 1);
-			if (time(nullptr) > (iter->second.created + 60) || r < 0 || pfd.revents & POLLERR) {
+			/* Found a keepalive connection, check it has not expired and the server has not closed it */
+			SSL* idle_ssl = iter->second.ssl ? iter->second.ssl->ssl : nullptr;
+			if (time(nullptr) > (iter->second.created + KEEPALIVE_TTL) || !idle_connection_alive(iter->second.sfd, idle_ssl)) {
 				make_new = true;
 				/* This connection is dead, free its resources and make a new one */
-				if (iter->second.ssl->ssl) {
-					SSL_free(iter->second.ssl->ssl);
+				if (iter->second.ssl && iter->second.ssl->ssl) {
+					free_ssl_connection(identifier, iter->second.ssl->ssl);
 					iter->second.ssl->ssl = nullptr;
 				}
 				close_socket(iter->second.sfd);
 				iter->second.sfd = INVALID_SOCKET;
 				delete iter->second.ssl;
 			} else {
-				/* Connection is good, lets use it */
+				/* Connection is good, lets use it. The liveness check left it non-blocking */
 				this->sfd = iter->second.sfd;
 				this->ssl = iter->second.ssl;
 				make_new = false;
+				set_nonblocking(this->sfd, false);
+				stat_reused.fetch_add(1, std::memory_order_relaxed);
 			}
 			/* We don't keep in-flight connections in the keepalives list */
 			keepalives.erase(iter);
@@ -325,6 +440,7 @@ void ssl_client::connect()
 		if (sfd == ERROR_STATUS) {
 			throw dpp::connection_exception(err_connect_failure, strerror(err));
 		}
+		stat_opened.fetch_add(1, std::memory_order_relaxed);
 
 		if (!plaintext) {
 			/* Each thread needs a context, but we don't need to make a new one for each connection */
@@ -357,6 +473,12 @@ void ssl_client::connect()
 			/* Server name identification (SNI) */
 			SSL_set_tlsext_host_name(ssl->ssl, hostname.c_str());
 
+			/* Offer the last session for this host, so the server can skip the full handshake */
+			auto session = tls_sessions.find(connection_identifier(plaintext, hostname, port));
+			if (session != tls_sessions.end()) {
+				SSL_set_session(ssl->ssl, session->second.get());
+			}
+
 #ifndef _WIN32
 			/* On Linux, we can set socket timeouts so that SSL_connect eventually gives up */
 			timeval tv;
@@ -369,6 +491,12 @@ void ssl_client::connect()
 				throw dpp::connection_exception(err_ssl_connect, "SSL_connect error");
 			}
 
+			if (SSL_session_reused(ssl->ssl)) {
+				stat_tls_resumed.fetch_add(1, std::memory_order_relaxed);
+			} else {
+				stat_tls_full.fetch_add(1, std::memory_order_relaxed);
+			}
+
 			this->cipher = SSL_get_cipher(ssl->ssl);
 		}
 	}
@@ -383,7 +511,16 @@ void ssl_client::socket_write(const std::string_view data)
 	 * lock-step delivery e.g. for HTTP header negotiation
 	 */
 	if (nonblocking) {
-		obuffer += data;
+		/* Small writes, such as a websocket header followed by its payload, are merged so they go out
+		 * together. The front chunk is only appended to before any of it has been handed to a write,
+		 * as an SSL_write which would block must be retried with the same buffer.
+		 */
+		const bool back_unsent = obuffer.size() > 1 || (client_to_server_offset == 0 && client_to_server_length == 0);
+		if (!obuffer.empty() && back_unsent && obuffer.back().length() + data.length() <= DPP_BUFSIZE) {
+			obuffer.back().append(data);
+		} else {
+			obuffer.emplace_back(data);
+		}
 		return;
 	}
 
@@ -403,6 +540,29 @@ void ssl_client::one_second_timer()
 {
 }
 
+void ssl_client::warm_up(const std::string &hostname, const std::string &port)
+{
+	auto iter = keepalives.find(connection_identifier(false, hostname, port));
+	if (iter != keepalives.end() && time(nullptr) <= iter->second.created + KEEPALIVE_TTL) {
+		return;
+	}
+	/* Any expired connection is replaced by the constructor, and closing the client puts the new one in the keepalive cache */
+	ssl_client warm(hostname, port, false, true);
+
+	/* A TLS 1.3 server sends its session tickets after the handshake, and a connection which only
+	 * warmed up never reads a reply that would pick them up. Read them before parking it, so the
+	 * session can be resumed and the tickets do not sit unread on the idle socket.
+	 */
+	if (warm.make_new && SSL_version(warm.ssl->ssl) >= TLS1_3_VERSION) {
+		pollfd pfd = {};
+		pfd.fd = warm.sfd;
+		pfd.events = POLLIN;
+		if (::poll(&pfd, 1, SESSION_TICKET_WAIT) > 0 && idle_connection_alive(warm.sfd, warm.ssl->ssl)) {
+			remember_session(connection_identifier(false, hostname, port), warm.ssl->ssl);
+		}
+	}
+}
+
 std::string ssl_client::get_cipher() {
 	return cipher;
 }
@@ -411,33 +571,213 @@ void ssl_client::log(dpp::loglevel severity, const std::string &msg) const
 {
 }
 
-void ssl_client::read_loop()
+void ssl_client::prepare_loop()
 {
-	/* The read loop is non-blocking using poll(). This method
-	 * cannot read while it is waiting for write, or write while it is
+	if (sfd == INVALID_SOCKET)  {
+		throw dpp::connection_exception(err_invalid_socket, "Invalid file descriptor in read_loop()");
+	}
+
+	/* Make the socket nonblocking */
+	if (!set_nonblocking(sfd, true)) {
+		throw dpp::connection_exception(err_nonblocking_failure, "Can't switch socket to non-blocking mode!");
+	}
+	nonblocking = true;
+	client_to_server_length = 0;
+	client_to_server_offset = 0;
+	read_blocked_on_write = false;
+	write_blocked_on_read = false;
+}
+
+bool ssl_client::wants_write() const
+{
+	/* If we're waiting for a read on the socket don't try to write to the server */
+	return client_to_server_length || !obuffer.empty() || read_blocked_on_write;
+}
+
+bool ssl_client::handle_io(bool readable, bool writeable)
+{
+	/* This cannot read while it is waiting for write, or write while it is
 	 * waiting for read. This is a limitation of the openssl libraries,
 	 * as SSL is sent and received in low level ~16k frames which must
 	 * be synchronised and ordered correctly. Attempting to send while
 	 * we need another frame or receive while we are due to send a frame
 	 * would cause the protocol to break.
 	 */
-	int r = 0, sockets = 1;
-	size_t client_to_server_length = 0, client_to_server_offset = 0;
-	bool read_blocked_on_write =  false, write_blocked_on_read = false, read_blocked = false;
-	pollfd pfd[2] = {};
-	char client_to_server_buffer[DPP_BUFSIZE], server_to_client_buffer[DPP_BUFSIZE];
+	int r = 0;
+	bool read_blocked = false;
+	char server_to_client_buffer[DPP_BUFSIZE];
 
-	try {
+	/* Now check if there's data to read */
+	if ((readable && !write_blocked_on_read) || (read_blocked_on_write && writeable)) {
+		if (plaintext) {
+			read_blocked_on_write = false;
+			read_blocked = false;
+			r = (int) ::recv(sfd, server_to_client_buffer, DPP_BUFSIZE, 0);
+
+			if (r <= 0) {
+				/* error or EOF */
+				return false;
+			}
 
-		if (sfd == INVALID_SOCKET)  {
-			throw dpp::connection_exception(err_invalid_socket, "Invalid file descriptor in read_loop()");
+			buffer.append(server_to_client_buffer, r);
+			bytes_in += r;
+			if (!this->handle_buffer(buffer)) {
+				return false;
+			}
+		} else {
+			do {
+				read_blocked_on_write = false;
+				read_blocked = false;
+				
+				r = SSL_read(ssl->ssl,server_to_client_buffer,DPP_BUFSIZE);
+				int e = SSL_get_error(ssl->ssl,r);
+
+				switch (e) {
+					case SSL_ERROR_NONE:
+						/* Data received, add it to the buffer */
+						if (r > 0) {
+							buffer.append(server_to_client_buffer, r);
+							bytes_in += r;
+							if (!this->handle_buffer(buffer)) {
+								return false;
+							}
+						}
+					break;
+					case SSL_ERROR_ZERO_RETURN:
+						/* End of data */
+						SSL_shutdown(ssl->ssl);
+						return false;
+					break;
+					case SSL_ERROR_WANT_READ:
+						read_blocked = true;
+					break;
+							
+					/* We get a WANT_WRITE if we're trying to rehandshake and we block on a write during that rehandshake.
+					* We need to wait on the socket to be writeable but reinitiate the read when it is
+					*/
+					case SSL_ERROR_WANT_WRITE:
+						read_blocked_on_write = true;
+					break;
+					default:
+						return false;
+					break;
+				}
+
+				/* We need a check for read_blocked here because SSL_pending() doesn't work properly during the
+				* handshake. This check prevents a busy-wait loop around SSL_read()
+				*/
+			} while (SSL_pending(ssl->ssl) && !read_blocked);
 		}
+	}
+
+	/* Check for input on the sendq. Data is sent from the front chunk in place, which is dropped
+	 * once fully written.
+	 */
+	if (client_to_server_length == 0) {
+		while (!obuffer.empty() && client_to_server_offset >= obuffer.front().length()) {
+			obuffer.pop_front();
+			client_to_server_offset = 0;
+		}
+		if (!obuffer.empty()) {
+			client_to_server_length = std::min(obuffer.front().length() - client_to_server_offset, DPP_WRITE_CHUNK);
+		}
+	}
+
+	/* If the socket is writeable... */
+	if ((writeable && client_to_server_length) || (write_blocked_on_read && readable)) {
+		write_blocked_on_read = false;
+		/* Try to write */
+
+		if (plaintext) {
+			/* Gather as much of the queue as possible into one write */
+#ifdef _WIN32
+			WSABUF iov[DPP_WRITE_IOVECS];
+#else
+			iovec iov[DPP_WRITE_IOVECS];
+#endif
+			size_t iov_count = 0, offset = client_to_server_offset;
+			for (auto chunk = obuffer.begin(); chunk != obuffer.end() && iov_count < DPP_WRITE_IOVECS; ++chunk, offset = 0) {
+#ifdef _WIN32
+				iov[iov_count].buf = const_cast<char*>(chunk->data() + offset);
+				iov[iov_count].len = static_cast<ULONG>(chunk->length() - offset);
+#else
+				iov[iov_count].iov_base = const_cast<char*>(chunk->data() + offset);
+				iov[iov_count].iov_len = chunk->length() - offset;
+#endif
+				++iov_count;
+			}
+
+#ifdef _WIN32
+			DWORD sent = 0;
+			r = ::WSASend(sfd, iov, static_cast<DWORD>(iov_count), &sent, 0, nullptr, nullptr) == 0 ? static_cast<int>(sent) : -1;
+#else
+			r = (int) ::writev(sfd, iov, static_cast<int>(iov_count));
+#endif
+
+			if (r < 0) {
+				/* Write error */
+				return false;
+			}
+
+			/* Drop whatever was written, which may span several chunks */
+			size_t written = r;
+			while (written > 0 && !obuffer.empty()) {
+				size_t remaining = obuffer.front().length() - client_to_server_offset;
+				if (written < remaining) {
+					client_to_server_offset += written;
+					break;
+				}
+				written -= remaining;
+				obuffer.pop_front();
+				client_to_server_offset = 0;
+			}
+			client_to_server_length = 0;
+			bytes_out += r;
+		} else {
+			/* An SSL_write that would block must be retried with the same arguments. The front
+			 * chunk is never appended to or moved, so the pointer stays valid until then.
+			 */
+			r = SSL_write(ssl->ssl, obuffer.front().data() + client_to_server_offset, (int)client_to_server_length);
+
+			switch(SSL_get_error(ssl->ssl,r)) {
+				/* We wrote something */
+				case SSL_ERROR_NONE:
+					client_to_server_length -= r;
+					client_to_server_offset += r;
+					bytes_out += r;
+				break;
+					
+				/* We would have blocked */
+				case SSL_ERROR_WANT_WRITE:
+				break;
 		
-		/* Make the socket nonblocking */
-		if (!set_nonblocking(sfd, true)) {
-			throw dpp::connection_exception(err_nonblocking_failure, "Can't switch socket to non-blocking mode!");
+				/* We get a WANT_READ if we're trying to rehandshake and we block onwrite during the current connection.
+				* We need to wait on the socket to be readable but reinitiate our write when it is
+				*/
+				case SSL_ERROR_WANT_READ:
+					write_blocked_on_read = true;
+				break;
+						
+				/* Some other error */
+				default:
+					return false;
+				break;
+			}
 		}
-		nonblocking = true;
+	}
+	return true;
+}
+
+void ssl_client::read_loop()
+{
+	/* The read loop is non-blocking using poll(), and hands socket readiness to handle_io().
+	 * A socket_engine does the same for many connections on one thread.
+	 */
+	int r = 0, sockets = 1;
+	pollfd pfd[2] = {};
+
+	try {
+		prepare_loop();
 
 		/* Loop until there is a socket error */
 		while(true) {
@@ -469,8 +809,7 @@ void ssl_client::read_loop()
 				throw dpp::connection_exception(err_invalid_socket, "File descriptor invalidated, connection died");
 			}
 
-			/* If we're waiting for a read on the socket don't try to write to the server */
-			if (client_to_server_length || obuffer.length() || read_blocked_on_write) {
+			if (wants_write()) {
 				pfd[0].events |= POLLOUT;
 			}
 
@@ -493,121 +832,8 @@ void ssl_client::read_loop()
 				throw dpp::connection_exception(err_socket_error, strerror(errno));
 			}
 
-			/* Now check if there's data to read */
-			if (((pfd[0].revents & POLLIN) && !write_blocked_on_read) || (read_blocked_on_write && (pfd[0].revents & POLLOUT))) {
-				if (plaintext) {
-					read_blocked_on_write = false;
-					read_blocked = false;
-					r = (int) ::recv(sfd, server_to_client_buffer, DPP_BUFSIZE, 0);
-
-					if (r <= 0) {
-						/* error or EOF */
-						return;
-					}
-
-					buffer.append(server_to_client_buffer, r);
-					if (!this->handle_buffer(buffer)) {
-						return;
-					}
-					bytes_in += r;
-				} else {
-					do {
-						read_blocked_on_write = false;
-						read_blocked = false;
-						
-						r = SSL_read(ssl->ssl,server_to_client_buffer,DPP_BUFSIZE);
-						int e = SSL_get_error(ssl->ssl,r);
-
-						switch (e) {
-							case SSL_ERROR_NONE:
-								/* Data received, add it to the buffer */
-								if (r > 0) {
-									buffer.append(server_to_client_buffer, r);
-									if (!this->handle_buffer(buffer)) {
-										return;
-									}
-									bytes_in += r;
-								}
-							break;
-							case SSL_ERROR_ZERO_RETURN:
-								/* End of data */
-								SSL_shutdown(ssl->ssl);
-								return;
-							break;
-							case SSL_ERROR_WANT_READ:
-								read_blocked = true;
-							break;
-									
-							/* We get a WANT_WRITE if we're trying to rehandshake and we block on a write during that rehandshake.
-							* We need to wait on the socket to be writeable but reinitiate the read when it is
-							*/
-							case SSL_ERROR_WANT_WRITE:
-								read_blocked_on_write = true;
-							break;
-							default:
-								return;
-							break;
-						}
-
-						/* We need a check for read_blocked here because SSL_pending() doesn't work properly during the
-						* handshake. This check prevents a busy-wait loop around SSL_read()
-						*/
-					} while (SSL_pending(ssl->ssl) && !read_blocked);
-				}
-			}
-
-			/* Check for input on the sendq */
-			if (obuffer.length() && client_to_server_length == 0) {
-				memcpy(&client_to_server_buffer, obuffer.data(), obuffer.length() > DPP_BUFSIZE ? DPP_BUFSIZE : obuffer.length());
-				client_to_server_length = obuffer.length() > DPP_BUFSIZE ? DPP_BUFSIZE : obuffer.length();
-				obuffer = obuffer.substr(client_to_server_length, obuffer.length());
-				client_to_server_offset = 0;
-			}
-
-			/* If the socket is writeable... */
-			if (((pfd[0].revents & POLLOUT) && client_to_server_length) || (write_blocked_on_read && (pfd[0].revents & POLLIN))) {
-				write_blocked_on_read = false;
-				/* Try to write */
-
-				if (plaintext) {
-					r = (int) ::send(sfd, client_to_server_buffer + client_to_server_offset, (int)client_to_server_length, 0);
-
-					if (r < 0) {
-						/* Write error */
-						return;
-					}
-
-					client_to_server_length -= r;
-					client_to_server_offset += r;
-					bytes_out += r;
-				} else {
-					r = SSL_write(ssl->ssl, client_to_server_buffer + client_to_server_offset, (int)client_to_server_length);
-
-					switch(SSL_get_error(ssl->ssl,r)) {
-						/* We wrote something */
-						case SSL_ERROR_NONE:
-							client_to_server_length -= r;
-							client_to_server_offset += r;
-							bytes_out += r;
-						break;
-							
-						/* We would have blocked */
-						case SSL_ERROR_WANT_WRITE:
-						break;
-				
-						/* We get a WANT_READ if we're trying to rehandshake and we block onwrite during the current connection.
-						* We need to wait on the socket to be readable but reinitiate our write when it is
-						*/
-						case SSL_ERROR_WANT_READ:
-							write_blocked_on_read = true;
-						break;
-								
-						/* Some other error */
-						default:
-							return;
-						break;
-					}
-				}
+			if (!handle_io(pfd[0].revents & POLLIN, pfd[0].revents & POLLOUT)) {
+				return;
 			}
 		}
 	}
@@ -633,8 +859,8 @@ bool ssl_client::handle_buffer(std::string &buffer)
 
 void ssl_client::close()
 {
+	std::string identifier(connection_identifier(plaintext, hostname, port));
 	if (keepalive && this->sfd != INVALID_SOCKET) {
-		std::string identifier((!plaintext ? "ssl://" : "tcp://") + hostname + ":" + port);
 		auto iter = keepalives.find(identifier);
 		if (iter == keepalives.end()) {
 			keepalive_cache_t kc;
@@ -642,12 +868,14 @@ void ssl_client::close()
 			kc.sfd = this->sfd;
 			kc.ssl = this->ssl;
 			keepalives.emplace(identifier, kc);
+			return;
 		}
-		return;
+		/* There is already a connection kept alive for this host, so close this one. cleanup() must free it too. */
+		keepalive = false;
 	}
 
 	if (!plaintext && ssl->ssl) {
-		SSL_free(ssl->ssl);
+		free_ssl_connection(identifier, ssl->ssl);
 		ssl->ssl = nullptr;
 	}
 	close_socket(sfd);
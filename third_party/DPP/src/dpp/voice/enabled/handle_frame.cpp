@@ -88,7 +88,9 @@ void discord_voice_client::update_ratchets(bool force) {
 
 }
 
-bool discord_voice_client::handle_frame(const std::string &data, ws_opcode opcode) {
+bool discord_voice_client::handle_frame(std::string_view buffer, ws_opcode opcode) {
+	/* Voice frames are few and small, so they are simply copied out of the receive buffer */
+	const std::string data(buffer);
 	json j;
 
 	/**
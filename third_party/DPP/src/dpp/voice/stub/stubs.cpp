@@ -49,7 +49,7 @@ namespace dpp {
 		return false;
 	}
 
-	bool discord_voice_client::handle_frame(const std::string &data, ws_opcode opcode) {
+	bool discord_voice_client::handle_frame(std::string_view data, ws_opcode opcode) {
 		return false;
 	}
 
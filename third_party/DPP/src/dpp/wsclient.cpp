@@ -22,6 +22,7 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <dpp/wsclient.h>
 #include <dpp/utility.h>
 #include <dpp/httpsclient.h>
@@ -73,7 +74,7 @@ void websocket_client::connect()
 	);
 }
 
-bool websocket_client::handle_frame(const std::string& buffer, ws_opcode opcode)
+bool websocket_client::handle_frame(std::string_view buffer, ws_opcode opcode)
 {
 	/* This is a stub for classes that derive the websocket client */
 	return true;
@@ -179,8 +180,13 @@ bool websocket_client::handle_buffer(std::string& buffer)
 			return false;
 		}
 	} else if (state == CONNECTED) {
-		/* Process packets until we can't (buffer will erase data until parseheader returns false) */
-		while (this->parseheader(buffer)) { }
+		/* Process packets until we can't, then drop all the processed ones with one erase, rather than
+		 * shifting the rest of the buffer down once per frame. Handling a frame may close the connection,
+		 * which empties the buffer, so stop as soon as the state changes.
+		 */
+		size_t consumed = 0;
+		while (state == CONNECTED && consumed < buffer.length() && this->parseheader(std::string_view(buffer).substr(consumed), consumed)) { }
+		buffer.erase(0, std::min(consumed, buffer.length()));
 	}
 
 	return true;
@@ -191,7 +197,7 @@ ws_state websocket_client::get_state() const
 	return this->state;
 }
 
-bool websocket_client::parseheader(std::string& data)
+bool websocket_client::parseheader(std::string_view data, size_t& consumed)
 {
 	if (data.size() < 4) {
 		/* Not enough data to form a frame yet */
@@ -208,12 +214,9 @@ bool websocket_client::parseheader(std::string& data)
 			unsigned char len1 = data[1];
 			unsigned int payloadstartoffset = 2;
 
-			if (len1 & WS_MASKBIT) {
-				len1 &= ~WS_MASKBIT;
-				payloadstartoffset += 2;
-				/* We don't handle masked data, because discord doesn't send it */
-				return true;
-			}
+			/* We don't handle masked data, because discord doesn't send it, but it is still skipped */
+			bool masked = len1 & WS_MASKBIT;
+			len1 &= ~WS_MASKBIT;
 
 			/* 6 bit ("small") length frame */
 			uint64_t len = len1;
@@ -244,11 +247,23 @@ bool websocket_client::parseheader(std::string& data)
 				payloadstartoffset += 8;
 			}
 
+			if (masked) {
+				/* Four byte masking key */
+				payloadstartoffset += 4;
+			}
+
 			if (data.length() < payloadstartoffset + len) {
 				/* We don't have a complete frame yet */
 				return false;
 			}
 
+			/* Mark this frame as processed; the caller removes it from the input buffer */
+			consumed += payloadstartoffset + len;
+
+			if (masked) {
+				return true;
+			}
+
 			/* If we received a ping, we need to handle it. */
 			if ((opcode & ~WS_FINBIT) == OP_PING) {
 				handle_ping(data.substr(payloadstartoffset, len));
@@ -257,9 +272,6 @@ bool websocket_client::parseheader(std::string& data)
 				this->handle_frame(data.substr(payloadstartoffset, len), static_cast<ws_opcode>(opcode & ~WS_FINBIT));
 			}
 
-			/* Remove this frame from the input buffer */
-			data.erase(data.begin(), data.begin() + payloadstartoffset + len);
-
 			return true;
 		}
 		break;
@@ -296,7 +308,7 @@ void websocket_client::one_second_timer()
 	}
 }
 
-void websocket_client::handle_ping(const std::string &payload)
+void websocket_client::handle_ping(std::string_view payload)
 {
 	/* For receiving pings we echo back their payload with the type OP_PONG */
 	unsigned char out[MAXHEADERSIZE];
@@ -306,13 +318,15 @@ void websocket_client::handle_ping(const std::string &payload)
 	ssl_client::socket_write(payload);
 }
 
-void websocket_client::send_close_packet()
+void websocket_client::send_close_packet(uint16_t code)
 {
-	/* This is a 16 bit value representing 1000 in hex (0x03E8), network order.
+	/* The close code is a 16 bit value in network order, e.g. 1000 is 0x03E8.
 	 * For an error/close frame, this is all we need to send, just two bytes
 	 * and the header. We do this on shutdown of a websocket for graceful close.
 	 */
-	std::string payload = "\x03\xE8";
+	std::string payload;
+	payload += static_cast<char>(code >> 8);
+	payload += static_cast<char>(code & 0xFF);
 	unsigned char out[MAXHEADERSIZE];
 
 	size_t s = this->fill_header(out, payload.length(), OP_CLOSE);